@@ -47,6 +47,11 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
 #  define PROTECTED
 # endif
 # define WEAK		__attribute__((weak))
+/* ANDROID support update. */
+/* Keeps the compiler from moving memory accesses across it, which is
+   enough to share data with signal handlers of the same thread.  */
+# define COMPILER_BARRIER()	__asm__ __volatile__ ("" : : : "memory")
+/* End of ANDROID update. */
 # if (__GNUC__ >= 3)
 #  define likely(x)	__builtin_expect ((x), 1)
 #  define unlikely(x)	__builtin_expect ((x), 0)
@@ -65,6 +70,9 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
 # define HIDDEN
 # define PROTECTED
 # define WEAK
+/* ANDROID support update. */
+# define COMPILER_BARRIER()
+/* End of ANDROID update. */
 # define likely(x)	(x)
 # define unlikely(x)	(x)
 #endif
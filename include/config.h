@@ -7,6 +7,9 @@
 /* Enable Debug Frame */
 #define CONFIG_DEBUG_FRAME 1
 
+/* Collect statistics for unw_get_stats() */
+#define CONFIG_STATS /**/
+
 /* Support for Microsoft ABI extensions */
 /* This is required to understand floating point registers on x86-64 */
 #define CONFIG_MSABI_SUPPORT 1
@@ -254,16 +254,51 @@ typedef struct dwarf_reg_state
   {
     struct dwarf_reg_state *next;	/* for rs_stack */
     dwarf_save_loc_t reg[DWARF_NUM_PRESERVED_REGS + 2];
-    unw_word_t ip;		          /* ip this rs is for */
     unw_word_t ret_addr_column;           /* indicates which column in the rule table represents return address */
-    unsigned short lru_chain;	  /* used for least-recently-used chain */
-    unsigned short coll_chain;	/* used for hash collisions */
-    unsigned short hint;	      /* hint for next rs to try (or -1) */
-    unsigned short valid : 1;         /* optional machine-dependent signal info */
+    /* ANDROID support update. */
+    /* The rs cache fields moved to dwarf_compact_reg_state_t.  */
+    /* End of ANDROID update. */
     unsigned short signal_frame : 1;  /* optional machine-dependent signal info */
   }
 dwarf_reg_state_t;
 
+/* ANDROID support update. */
+/* Register state as kept in the rs cache: only the columns that aren't
+   DWARF_WHERE_SAME, which for most frames are the CFA, the return
+   address and a few callee-saved registers, with values that fit in
+   32 bits.  DWARF_WHERE_EXPR values are stored relative to IP.
+   States that don't fit are not cached.  22 entries cover a frame
+   that saves every callee-saved register on aarch64, and make an
+   entry three cache lines on 64-bit targets.  */
+#define DWARF_COMPACT_RS_MAX_REGS	22
+
+#if DWARF_NUM_PRESERVED_REGS + 2 > 256
+# error "register columns don't fit in dwarf_compact_save_loc_t"
+#endif
+
+typedef struct
+  {
+    uint8_t column;		/* register column */
+    uint8_t where;		/* dwarf_where_t */
+    int32_t val;		/* see dwarf_save_loc_t */
+  }
+dwarf_compact_save_loc_t;
+
+typedef struct dwarf_compact_reg_state
+  {
+    unw_word_t ip;		/* ip this rs is for */
+    unsigned short lru_chain;	/* used for least-recently-used chain */
+    unsigned short coll_chain;	/* used for hash collisions */
+    unsigned short hint;	/* hint for next rs to try (or -1) */
+    uint8_t ret_addr_column;	/* as in dwarf_reg_state_t */
+    uint8_t valid : 1;
+    uint8_t signal_frame : 1;	/* optional machine-dependent signal info */
+    uint8_t nregs : 6;		/* number of entries used in reg[] */
+    dwarf_compact_save_loc_t reg[DWARF_COMPACT_RS_MAX_REGS];
+  }
+dwarf_compact_reg_state_t;
+/* End of ANDROID update. */
+
 typedef struct dwarf_cie_info
   {
     unw_word_t cie_instr_start;	/* start addr. of CIE "initial_instructions" */
@@ -281,6 +316,11 @@ typedef struct dwarf_cie_info
     unsigned int sized_augmentation : 1;
     unsigned int have_abi_marker : 1;
     unsigned int signal_frame : 1;
+    /* ANDROID support update. */
+    /* Reference to the .debug_frame section the instructions are read
+       from, or NULL.  */
+    struct unw_debug_frame_file *debug_frame_file;
+    /* End of ANDROID update. */
   }
 dwarf_cie_info_t;
 
@@ -325,45 +365,205 @@ dwarf_cursor_t;
 #define DWARF_LOG_UNW_CACHE_SIZE	7
 #define DWARF_UNW_CACHE_SIZE	(1 << DWARF_LOG_UNW_CACHE_SIZE)
 
-#define DWARF_LOG_UNW_HASH_SIZE	(DWARF_LOG_UNW_CACHE_SIZE + 1)
-#define DWARF_UNW_HASH_SIZE	(1 << DWARF_LOG_UNW_HASH_SIZE)
+/* ANDROID support update. */
+/* The rs cache is split by IP hash into shards with a lock each, so
+   that threads unwinding through different code rarely contend.  A
+   shard starts out with DWARF_RS_SHARD_SIZE entries embedded in the
+   address space (DWARF_UNW_CACHE_SIZE in total) and is moved to
+   mmap'd storage when it is resized, either by unw_set_cache_size()
+   or because its miss rate stayed high.  */
+#define DWARF_LOG_RS_CACHE_SHARDS	2
+#define DWARF_RS_CACHE_SHARDS	(1 << DWARF_LOG_RS_CACHE_SHARDS)
+
+#define DWARF_LOG_RS_SHARD_SIZE	\
+  (DWARF_LOG_UNW_CACHE_SIZE - DWARF_LOG_RS_CACHE_SHARDS)
+#define DWARF_RS_SHARD_SIZE	(1 << DWARF_LOG_RS_SHARD_SIZE)
+#define DWARF_LOG_RS_SHARD_MAX_SIZE	12
+
+/* Cursor hints name a shard and an entry within it.  */
+#define DWARF_RS_HINT(shard, index) \
+  ((shard) << DWARF_LOG_RS_SHARD_MAX_SIZE | (index))
+#define DWARF_RS_HINT_SHARD(hint) \
+  ((unsigned int) (hint) >> DWARF_LOG_RS_SHARD_MAX_SIZE)
+#define DWARF_RS_HINT_INDEX(hint) \
+  ((unsigned int) (hint) & ((1 << DWARF_LOG_RS_SHARD_MAX_SIZE) - 1))
+
+typedef unsigned short unw_hash_index_t;
+
+struct dwarf_rs_cache_shard
+  {
+    pthread_mutex_t lock;
+    unsigned short lru_head;	/* index of lead-recently used rs */
+    unsigned short lru_tail;	/* index of most-recently used rs */
+    unsigned short log_size;	/* log2 of the number of buckets */
+    unsigned short mapped_log_size; /* log_size of mmap'd storage, or 0 */
+
+    uint32_t generation;	/* generation number */
+    uint32_t lookups;		/* lookups since the last resize check */
+    uint32_t misses;		/* ...and how many of them missed */
+
+    /* hash table that maps instruction pointer to rs index
+       (2 << log_size entries) and rs cache (1 << log_size entries);
+       both point to the arrays below unless the shard was resized: */
+    unsigned short *hash;
+    dwarf_compact_reg_state_t *buckets;
 
-typedef unsigned char unw_hash_index_t;
+    unsigned short default_hash[2 * DWARF_RS_SHARD_SIZE];
+    dwarf_compact_reg_state_t default_buckets[DWARF_RS_SHARD_SIZE];
+  };
 
 struct dwarf_rs_cache
+  {
+    int fixed;			/* size set by unw_set_cache_size: don't grow */
+    struct dwarf_rs_cache_shard shards[DWARF_RS_CACHE_SHARDS];
+  };
+/* End of ANDROID update. */
+
+/* ANDROID support update. */
+/* Parsed CIEs, see Gfde.c.  A module has only a few CIEs, shared by
+   all of its FDEs.  */
+#define DWARF_LOG_CIE_CACHE_SIZE	6
+#define DWARF_CIE_CACHE_SIZE		(1 << DWARF_LOG_CIE_CACHE_SIZE)
+
+struct dwarf_cie_cache
   {
     pthread_mutex_t lock;
-    unsigned short lru_head;	/* index of lead-recently used rs */
-    unsigned short lru_tail;	/* index of most-recently used rs */
+    uint32_t generation;	/* generation number */
+    struct
+      {
+	unw_word_t addr;	/* address of the CIE */
+	unw_word_t gp;		/* global pointer it was parsed with */
+	dwarf_cie_info_t *dci;	/* from dwarf_cie_info_pool, or NULL */
+      }
+    entries[DWARF_CIE_CACHE_SIZE];
+  };
+
+/* FDEs found by recent table searches, see Gfind_proc_info-lsb.c.
+   Successive lookups mostly land in a few procedures.  */
+#define DWARF_FDE_CACHE_SIZE		8
+
+struct dwarf_fde_cache
+  {
+    pthread_mutex_t lock;
+    uint32_t generation;	/* generation number */
+    unsigned int next;		/* entry to replace next */
+    struct
+      {
+	unw_word_t table;	/* search table the FDE was found in */
+	unw_word_t segbase;
+	unw_word_t start_ip;	/* range described by the FDE */
+	unw_word_t end_ip;
+	unw_word_t fde_addr;
+      }
+    entries[DWARF_FDE_CACHE_SIZE];
+  };
 
-    /* hash table that maps instruction pointer to rs index: */
-    unsigned short hash[DWARF_UNW_HASH_SIZE];
+/* Location expressions in a form that is evaluated without reading
+   the expression, see Gexpr.c.  */
+typedef enum
+  {
+    DWARF_EXPR_GENERIC,		/* needs the stack machine */
+    DWARF_EXPR_REG,		/* DW_OP_reg: register REG1 */
+    DWARF_EXPR_BREG,		/* REG1 + OFF1, optionally dereferenced
+				   and then incremented by OFF2 */
+    DWARF_EXPR_PLT		/* REG1 + OFF1
+				   + ((((REG2 + OFF2) & MASK) >= THRESHOLD)
+				      << SHIFT) */
+  }
+dwarf_expr_kind_t;
+
+struct dwarf_compiled_expr
+  {
+    unw_word_t addr;		/* address of the expression, 0 if unused */
+    unw_word_t len;		/* its length */
+    unw_word_t off1, off2;
+    uint16_t reg1, reg2;	/* DWARF register numbers */
+    uint8_t kind;		/* dwarf_expr_kind_t */
+    uint8_t deref;
+    uint8_t mask, threshold, shift;
+  };
 
+#define DWARF_LOG_EXPR_CACHE_SIZE	5
+#define DWARF_EXPR_CACHE_SIZE		(1 << DWARF_LOG_EXPR_CACHE_SIZE)
+
+struct dwarf_expr_cache
+  {
+    pthread_mutex_t lock;
     uint32_t generation;	/* generation number */
+    struct dwarf_compiled_expr entries[DWARF_EXPR_CACHE_SIZE];
+  };
+/* End of ANDROID update. */
 
-    /* rs cache: */
-    dwarf_reg_state_t buckets[DWARF_UNW_CACHE_SIZE];
+/* ANDROID support update. */
+/* An entry of a binary-search table (.eh_frame_hdr or the index built
+   for .debug_frame).  */
+struct table_entry
+  {
+    int32_t start_ip_offset;
+    int32_t fde_offset;
   };
+/* End of ANDROID update. */
 
-/* A list of descriptors for loaded .debug_frame sections.  */
+/* ANDROID support update. */
+/* A loaded .debug_frame section.  One is shared by every region, in
+   every address space, that maps the same file.  */
 
-struct unw_debug_frame_list
+struct unw_debug_frame_file
   {
-    /* The start (inclusive) and end (exclusive) of the described region.  */
-    unw_word_t start;
-    unw_word_t end;
+    /* Identity of the file the section was loaded for.  */
+    dev_t dev;
+    ino_t ino;
+    off_t file_size;
+    time_t file_mtime;
+    /* Number of regions, and of searches and unwind infos, using this
+       section.  */
+    unsigned int refs;
     /* The debug frame itself.  */
     char *debug_frame;
     size_t debug_frame_size;
     /* Relocation amount since debug_frame was compressed. */
     unw_word_t segbase_bias;
+    /* Mapping of the file that debug_frame points into, or NULL.  */
+    void *map;
+    size_t map_size;
+    /* .gnu_debugdata that debug_frame was copied from, or NULL.  */
+    void *mini_debug_info;
     /* Index (for binary search).  */
     struct table_entry *index;
     size_t index_size;
+    /* Pointer to next section.  */
+    struct unw_debug_frame_file *next;
+  };
+/* End of ANDROID update. */
+
+/* A list of descriptors for loaded .debug_frame sections.  */
+
+struct unw_debug_frame_list
+  {
+    /* The start (inclusive) and end (exclusive) of the described region.  */
+    unw_word_t start;
+    unw_word_t end;
+    /* ANDROID support update. */
+    /* The debug frame of the region and its index.  */
+    struct unw_debug_frame_file *file;
+    /* End of ANDROID update. */
     /* Pointer to next descriptor.  */
     struct unw_debug_frame_list *next;
   };
 
+/* ANDROID support update. */
+/* The descriptors of an address space sorted by start address, so the
+   one covering an address is found with a binary search.  The list
+   above owns them.  */
+
+struct unw_debug_frame_index
+  {
+    struct unw_debug_frame_list **ranges;
+    unsigned int num_ranges;
+    unsigned int max_ranges;
+  };
+/* End of ANDROID update. */
+
 struct dwarf_callback_data
   {
     /* in: */
@@ -388,6 +588,17 @@ struct dwarf_callback_data
 #define dwarf_eval_expr			UNW_OBJ (dwarf_eval_expr)
 #define dwarf_extract_proc_info_from_fde \
 		UNW_OBJ (dwarf_extract_proc_info_from_fde)
+/* ANDROID support update. */
+#define dwarf_flush_cie_cache		UNW_OBJ (dwarf_flush_cie_cache)
+#define dwarf_set_rs_cache_size		UNW_OBJ (dwarf_set_rs_cache_size)
+#define dwarf_free_rs_cache		UNW_OBJ (dwarf_free_rs_cache)
+#define dwarf_get_debug_frame_file	UNW_ARCH_OBJ (dwarf_get_debug_frame_file)
+#define dwarf_add_debug_frame_file	UNW_ARCH_OBJ (dwarf_add_debug_frame_file)
+#define dwarf_hold_debug_frame_file	UNW_ARCH_OBJ (dwarf_hold_debug_frame_file)
+#define dwarf_put_debug_frame_file	UNW_ARCH_OBJ (dwarf_put_debug_frame_file)
+#define dwarf_debug_frame_lock		UNW_ARCH_OBJ (dwarf_debug_frame_lock)
+#define dwarf_flush_debug_frames	UNW_ARCH_OBJ (dwarf_flush_debug_frames)
+/* End of ANDROID update. */
 #define dwarf_find_save_locs		UNW_OBJ (dwarf_find_save_locs)
 #define dwarf_create_state_record	UNW_OBJ (dwarf_create_state_record)
 #define dwarf_make_proc_info		UNW_OBJ (dwarf_make_proc_info)
@@ -428,6 +639,21 @@ extern int dwarf_extract_proc_info_from_fde (unw_addr_space_t as,
 					     int need_unwind_info,
 					     unw_word_t base,
 					     void *arg);
+/* ANDROID support update. */
+extern void dwarf_flush_cie_cache (struct dwarf_cie_cache *cache);
+extern int dwarf_set_rs_cache_size (struct dwarf_rs_cache *cache,
+				    unsigned short log_size, int fixed);
+extern void dwarf_free_rs_cache (struct dwarf_rs_cache *cache);
+extern struct unw_debug_frame_file *dwarf_get_debug_frame_file (
+				    dev_t dev, ino_t ino, off_t file_size,
+				    time_t file_mtime);
+extern struct unw_debug_frame_file *dwarf_add_debug_frame_file (
+				    struct unw_debug_frame_file *file);
+extern void dwarf_hold_debug_frame_file (struct unw_debug_frame_file *file);
+extern void dwarf_put_debug_frame_file (struct unw_debug_frame_file *file);
+extern pthread_mutex_t dwarf_debug_frame_lock;
+extern void dwarf_flush_debug_frames (unw_addr_space_t as);
+/* End of ANDROID update. */
 extern int dwarf_find_save_locs (struct dwarf_cursor *c);
 extern int dwarf_create_state_record (struct dwarf_cursor *c,
 				      dwarf_state_record_t *sr);
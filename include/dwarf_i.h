@@ -23,11 +23,7 @@ extern const uint8_t dwarf_to_unw_regnum_map[DWARF_REGNUM_MAP_LENGTH];
   (((reg) <= DWARF_REGNUM_MAP_LENGTH) ? dwarf_to_unw_regnum_map[reg] : 0)
 #endif
 
-#ifdef UNW_LOCAL_ONLY
-
-/* In the local-only case, we can let the compiler directly access
-   memory and don't need to worry about differing byte-order.  */
-
+/* ANDROID support update. */
 typedef union __attribute__ ((packed))
   {
     int8_t s8;
@@ -41,6 +37,12 @@ typedef union __attribute__ ((packed))
     void *ptr;
   }
 dwarf_misaligned_value_t;
+/* End of ANDROID update. */
+
+#ifdef UNW_LOCAL_ONLY
+
+/* In the local-only case, we can let the compiler directly access
+   memory and don't need to worry about differing byte-order.  */
 
 static inline int
 dwarf_reads8 (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
@@ -130,11 +132,44 @@ dwarf_readu64 (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
   return 0;
 }
 
+/* ANDROID support update. */
+# define dwarf_mem_readu8	dwarf_readu8
+# define dwarf_mem_readu16	dwarf_readu16
+# define dwarf_mem_readu32	dwarf_readu32
+# define dwarf_mem_readu64	dwarf_readu64
+/* End of ANDROID update. */
+
 #else /* !UNW_LOCAL_ONLY */
 
+/* ANDROID support update. */
+/* The generic library unwinds the local address space too.  Read its
+   unwind info directly, as the local-only library does, instead of
+   with an indirect access_mem() call per byte.  Other memory, such as
+   the stack slots read by DW_OP_deref, may not be mapped and has to be
+   read with dwarf_mem_read*(), which always use access_mem().  */
+#ifndef UNW_REMOTE_ONLY
+# define dwarf_is_local_as(as)	((as) == unw_local_addr_space)
+#else
+# define dwarf_is_local_as(as)	0
+#endif
+
+#define DWARF_READ_LOCAL(as, addr, valp, field)				\
+  do {									\
+    if (dwarf_is_local_as (as))						\
+      {									\
+	dwarf_misaligned_value_t *mvp = (void *) (uintptr_t) *(addr);	\
+									\
+	*(valp) = mvp->field;						\
+	*(addr) += sizeof (mvp->field);					\
+	return 0;							\
+      }									\
+  } while (0)
+/* End of ANDROID update. */
+
+/* ANDROID support update. */
 static inline int
-dwarf_readu8 (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
-	      uint8_t *valp, void *arg)
+dwarf_mem_readu8 (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
+		  uint8_t *valp, void *arg)
 {
   unw_word_t val, aligned_addr = *addr & -sizeof (unw_word_t);
   unw_word_t off = *addr - aligned_addr;
@@ -152,14 +187,24 @@ dwarf_readu8 (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
 }
 
 static inline int
-dwarf_readu16 (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
-	       uint16_t *val, void *arg)
+dwarf_readu8 (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
+	      uint8_t *valp, void *arg)
+{
+  DWARF_READ_LOCAL (as, addr, valp, u8);
+  return dwarf_mem_readu8 (as, a, addr, valp, arg);
+}
+/* End of ANDROID update. */
+
+/* ANDROID support update. */
+static inline int
+dwarf_mem_readu16 (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
+		   uint16_t *val, void *arg)
 {
   uint8_t v0, v1;
   int ret;
 
-  if ((ret = dwarf_readu8 (as, a, addr, &v0, arg)) < 0
-      || (ret = dwarf_readu8 (as, a, addr, &v1, arg)) < 0)
+  if ((ret = dwarf_mem_readu8 (as, a, addr, &v0, arg)) < 0
+      || (ret = dwarf_mem_readu8 (as, a, addr, &v1, arg)) < 0)
     return ret;
 
   if (tdep_big_endian (as))
@@ -170,14 +215,24 @@ dwarf_readu16 (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
 }
 
 static inline int
-dwarf_readu32 (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
-	       uint32_t *val, void *arg)
+dwarf_readu16 (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
+	       uint16_t *val, void *arg)
+{
+  DWARF_READ_LOCAL (as, addr, val, u16);
+  return dwarf_mem_readu16 (as, a, addr, val, arg);
+}
+/* End of ANDROID update. */
+
+/* ANDROID support update. */
+static inline int
+dwarf_mem_readu32 (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
+		   uint32_t *val, void *arg)
 {
   uint16_t v0, v1;
   int ret;
 
-  if ((ret = dwarf_readu16 (as, a, addr, &v0, arg)) < 0
-      || (ret = dwarf_readu16 (as, a, addr, &v1, arg)) < 0)
+  if ((ret = dwarf_mem_readu16 (as, a, addr, &v0, arg)) < 0
+      || (ret = dwarf_mem_readu16 (as, a, addr, &v1, arg)) < 0)
     return ret;
 
   if (tdep_big_endian (as))
@@ -188,14 +243,24 @@ dwarf_readu32 (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
 }
 
 static inline int
-dwarf_readu64 (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
-	       uint64_t *val, void *arg)
+dwarf_readu32 (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
+	       uint32_t *val, void *arg)
+{
+  DWARF_READ_LOCAL (as, addr, val, u32);
+  return dwarf_mem_readu32 (as, a, addr, val, arg);
+}
+/* End of ANDROID update. */
+
+/* ANDROID support update. */
+static inline int
+dwarf_mem_readu64 (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
+		   uint64_t *val, void *arg)
 {
   uint32_t v0, v1;
   int ret;
 
-  if ((ret = dwarf_readu32 (as, a, addr, &v0, arg)) < 0
-      || (ret = dwarf_readu32 (as, a, addr, &v1, arg)) < 0)
+  if ((ret = dwarf_mem_readu32 (as, a, addr, &v0, arg)) < 0
+      || (ret = dwarf_mem_readu32 (as, a, addr, &v1, arg)) < 0)
     return ret;
 
   if (tdep_big_endian (as))
@@ -205,6 +270,15 @@ dwarf_readu64 (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
   return 0;
 }
 
+static inline int
+dwarf_readu64 (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
+	       uint64_t *val, void *arg)
+{
+  DWARF_READ_LOCAL (as, addr, val, u64);
+  return dwarf_mem_readu64 (as, a, addr, val, arg);
+}
+/* End of ANDROID update. */
+
 static inline int
 dwarf_reads8 (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
 	      int8_t *val, void *arg)
@@ -288,6 +362,37 @@ dwarf_readw (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
     }
 }
 
+/* ANDROID support update. */
+static inline int
+dwarf_mem_readw (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
+		 unw_word_t *val, void *arg)
+{
+  uint32_t u32;
+  uint64_t u64;
+  int ret;
+
+  switch (dwarf_addr_size (as))
+    {
+    case 4:
+      ret = dwarf_mem_readu32 (as, a, addr, &u32, arg);
+      if (ret < 0)
+	return ret;
+      *val = u32;
+      return ret;
+
+    case 8:
+      ret = dwarf_mem_readu64 (as, a, addr, &u64, arg);
+      if (ret < 0)
+	return ret;
+      *val = u64;
+      return ret;
+
+    default:
+      abort ();
+    }
+}
+/* End of ANDROID update. */
+
 /* Read an unsigned "little-endian base 128" value.  See Chapter 7.6
    of DWARF spec v3.  */
 
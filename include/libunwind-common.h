@@ -98,6 +98,24 @@ typedef enum
   }
 unw_caching_policy_t;
 
+/* Statistics on the work done by the unwinder, see unw_get_stats(3).  */
+typedef struct unw_stats
+  {
+    unsigned long long rs_cache_lookups;	/* register-state cache */
+    unsigned long long rs_cache_misses;
+    unsigned long long trace_cache_expansions;	/* unw_backtrace() cache */
+    unsigned long long map_rebuilds;		/* local map list rebuilds */
+    unsigned long long dl_iterate_phdr_calls;
+    unsigned long long fde_linear_searches;
+    unsigned long long table_probes;		/* search-table entries read */
+    unsigned long long access_mem_bytes;	/* read through access_mem */
+    unsigned long long internal_mapped_bytes;	/* not affected by reset */
+    unsigned long long internal_in_use_bytes;	/* not affected by reset */
+    unsigned long long mini_debug_info_bytes;	/* not affected by reset */
+    unsigned long long mini_debug_info_derived_bytes; /* ditto */
+  }
+unw_stats_t;
+
 typedef int unw_regnum_t;
 
 /* The unwind cursor starts at the youngest (most deeply nested) frame
@@ -259,9 +277,13 @@ unw_map_t;
 #define unw_get_proc_name	UNW_OBJ(get_proc_name)
 #define unw_get_proc_name_by_ip	UNW_OBJ(get_proc_name_by_ip)
 #define unw_set_caching_policy	UNW_OBJ(set_caching_policy)
+#define unw_set_cache_size	UNW_OBJ(set_cache_size)
 #define unw_regname		UNW_ARCH_OBJ(regname)
 #define unw_flush_cache		UNW_ARCH_OBJ(flush_cache)
 #define unw_strerror		UNW_ARCH_OBJ(strerror)
+#define unw_get_stats		UNW_ARCH_OBJ(get_stats)
+#define unw_reset_stats		UNW_ARCH_OBJ(reset_stats)
+#define unw_set_mini_debug_info_budget	UNW_ARCH_OBJ(set_mini_debug_info_budget)
 
 extern void unw_local_access_addr_space_init (unw_addr_space_t);
 extern unw_addr_space_t unw_create_addr_space (unw_accessors_t *, int);
@@ -269,6 +291,7 @@ extern void unw_destroy_addr_space (unw_addr_space_t);
 extern unw_accessors_t *unw_get_accessors (unw_addr_space_t);
 extern void unw_flush_cache (unw_addr_space_t, unw_word_t, unw_word_t);
 extern int unw_set_caching_policy (unw_addr_space_t, unw_caching_policy_t);
+extern int unw_set_cache_size (unw_addr_space_t, size_t, int);
 extern const char *unw_regname (unw_regnum_t);
 
 extern int unw_init_local (unw_cursor_t *, unw_context_t *);
@@ -289,6 +312,9 @@ extern int unw_get_proc_name (unw_cursor_t *, char *, size_t, unw_word_t *);
 extern int unw_get_proc_name_by_ip (unw_addr_space_t, unw_word_t, char *,
 				    size_t, unw_word_t *, void *);
 extern const char *unw_strerror (int);
+extern int unw_get_stats (unw_stats_t *);
+extern void unw_reset_stats (void);
+extern int unw_set_mini_debug_info_budget (size_t);
 extern int unw_backtrace (void **, int);
 
 /* ANDROID support update. */
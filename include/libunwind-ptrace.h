@@ -53,6 +53,25 @@ extern int _UPT_access_fpreg (unw_addr_space_t, unw_regnum_t, unw_fpreg_t *,
 extern int _UPT_get_proc_name (unw_addr_space_t, unw_word_t, char *, size_t,
 			       unw_word_t *, void *);
 extern int _UPT_resume (unw_addr_space_t, unw_cursor_t *, void *);
+/* ANDROID support update. */
+extern int _UPT_snapshot_regs (void *);
+extern int _UPT_flush_regs (void *);
+
+/* Frames of one thread, as returned by _UPT_unwind_threads().  */
+typedef struct
+  {
+    pid_t tid;
+    int error;			/* 0 or a negative UNW_E* value */
+    size_t num_frames;
+    unw_word_t *ips;		/* instruction pointer of each frame */
+    unw_word_t *sps;		/* stack pointer of each frame */
+  }
+_UPT_thread_frames_t;
+
+extern int _UPT_unwind_threads (pid_t, size_t, unsigned int,
+				_UPT_thread_frames_t **, size_t *);
+extern void _UPT_free_thread_frames (_UPT_thread_frames_t *, size_t);
+/* End of ANDROID update. */
 extern unw_accessors_t _UPT_accessors;
 
 
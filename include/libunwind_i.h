@@ -108,6 +108,9 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
 #pragma weak pthread_mutex_init
 #pragma weak pthread_mutex_lock
 #pragma weak pthread_mutex_unlock
+/* ANDROID support update. */
+#pragma weak pthread_mutex_trylock
+/* End of ANDROID update. */
 
 #define mutex_init(l)							\
 	(pthread_mutex_init != NULL ? pthread_mutex_init ((l), NULL) : 0)
@@ -115,6 +118,10 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
 	(pthread_mutex_lock != NULL ? pthread_mutex_lock (l) : 0)
 #define mutex_unlock(l)							\
 	(pthread_mutex_unlock != NULL ? pthread_mutex_unlock (l) : 0)
+/* ANDROID support update. */
+#define mutex_trylock(l)						\
+	(pthread_mutex_trylock != NULL ? pthread_mutex_trylock (l) : 0)
+/* End of ANDROID update. */
 
 #ifdef HAVE_ATOMIC_OPS_H
 # include <atomic_ops.h>
@@ -221,6 +228,9 @@ do {							\
 /* End of ANDROID update. */
 
 #define SOS_MEMORY_SIZE 16384	/* see src/mi/mempool.c */
+/* ANDROID support update. */
+#define SOS_CHUNK_SIZE	65536	/* see src/mi/mempool.c */
+/* End of ANDROID update. */
 
 #ifndef MAP_ANONYMOUS
 # define MAP_ANONYMOUS MAP_ANON
@@ -240,6 +250,9 @@ do {									    \
 #define unwi_dyn_remote_find_proc_info	UNWI_OBJ(dyn_remote_find_proc_info)
 #define unwi_dyn_remote_put_unwind_info	UNWI_OBJ(dyn_remote_put_unwind_info)
 #define unwi_dyn_validate_cache		UNWI_OBJ(dyn_validate_cache)
+/* ANDROID support update. */
+#define unwi_dyn_remote_free_cache	UNWI_OBJ(dyn_remote_free_cache)
+/* End of ANDROID update. */
 
 extern int unwi_find_dynamic_proc_info (unw_addr_space_t as,
 					unw_word_t ip,
@@ -266,6 +279,9 @@ extern void unwi_dyn_remote_put_unwind_info (unw_addr_space_t as,
 					     unw_proc_info_t *pi,
 					     void *arg);
 extern int unwi_dyn_validate_cache (unw_addr_space_t as, void *arg);
+/* ANDROID support update. */
+extern void unwi_dyn_remote_free_cache (unw_addr_space_t as);
+/* End of ANDROID update. */
 
 extern unw_dyn_info_list_t _U_dyn_info_list;
 extern pthread_mutex_t _U_dyn_info_list_lock;
@@ -322,6 +338,54 @@ print_error (const char *string)
 extern void mi_init (void);	/* machine-independent initializations */
 extern unw_word_t _U_dyn_info_list_addr (void);
 
+/* ANDROID support update. */
+/* Statistics for unw_get_stats(), see src/mi/stats.c.  UNWI_STAT_ADD()
+   counts for the calling thread and compiles to nothing unless the
+   library is configured with statistics.  */
+enum unwi_stat
+  {
+    UNWI_STAT_RS_CACHE_LOOKUPS,
+    UNWI_STAT_RS_CACHE_MISSES,
+    UNWI_STAT_TRACE_CACHE_EXPANSIONS,
+    UNWI_STAT_MAP_REBUILDS,
+    UNWI_STAT_DL_ITERATE_PHDR_CALLS,
+    UNWI_STAT_FDE_LINEAR_SEARCHES,
+    UNWI_STAT_TABLE_PROBES,
+    UNWI_STAT_ACCESS_MEM_BYTES,
+    UNWI_STAT_COUNT
+  };
+
+#ifdef CONFIG_STATS
+# define unwi_stats_add		UNWI_ARCH_OBJ(stats_add)
+
+extern void unwi_stats_add (enum unwi_stat stat, unsigned long n);
+
+# define UNWI_STAT_ADD(stat, n)	unwi_stats_add ((stat), (n))
+#else
+# define UNWI_STAT_ADD(stat, n)	do { (void) (n); } while (0)
+#endif
+#define UNWI_STAT_INC(stat)	UNWI_STAT_ADD (stat, 1)
+/* End of ANDROID update. */
+
+/* ANDROID support update. */
+/* Reads of local memory that let the kernel check the address, see
+   src/os-linux.c.  unwi_local_read_mem() returns 1 if the word was
+   read, 0 if the address is not readable and -1 if the kernel cannot
+   do the check, in which case the caller must validate the address
+   itself.  unwi_local_mem_flush() drops what the calling thread has
+   buffered and must be called whenever the memory may have changed.  */
+#ifdef __linux__
+# define unwi_local_read_mem	UNWI_ARCH_OBJ(local_read_mem)
+# define unwi_local_mem_flush	UNWI_ARCH_OBJ(local_mem_flush)
+
+extern int unwi_local_read_mem (unw_word_t addr, unw_word_t *val);
+extern void unwi_local_mem_flush (void);
+#else
+# define unwi_local_read_mem(addr, val)	(-1)
+# define unwi_local_mem_flush()		do { } while (0)
+#endif
+/* End of ANDROID update. */
+
 /* This is needed/used by ELF targets only.  */
 
 /* This structure should contain memory that will not change during local
@@ -336,8 +400,7 @@ struct elf_image
     bool valid;			/* true if the image is a valid elf image */
     bool load_attempted;	/* true if we've already attempted to load the elf */
     bool mapped;		/* true if the elf image was mmap'd in */
-    void* mini_debug_info_data;  /* decompressed .gnu_debugdata section */
-    size_t mini_debug_info_size;
+    void* mini_debug_info;	/* .gnu_debugdata section, see elfxx.c */
     union
       {
         struct
@@ -387,6 +450,47 @@ static inline void invalidate_edi (struct elf_dyn_info *edi)
 #endif
 }
 
+/* ANDROID support update. */
+/* Unwind tables of the ELF images of an address space, sorted by
+   start address.  See mi/Gedi_cache.c.  */
+struct elf_dyn_info_cache_entry
+  {
+    unw_word_t start_ip;
+    unw_word_t end_ip;
+    struct elf_dyn_info edi;
+  };
+
+struct elf_dyn_info_cache
+  {
+    lock_rdwr_var (lock);
+    unw_word_t generation;	/* unwi_edi_cache_generation() of the entries */
+    unsigned int num_entries;
+    unsigned int max_entries;
+    struct elf_dyn_info_cache_entry *entries;
+  };
+
+#define unwi_edi_cache_generation	UNWI_OBJ(edi_cache_generation)
+#define unwi_edi_cache_init		UNWI_OBJ(edi_cache_init)
+#define unwi_edi_cache_fini		UNWI_OBJ(edi_cache_fini)
+#define unwi_edi_cache_lookup		UNWI_OBJ(edi_cache_lookup)
+#define unwi_edi_cache_insert		UNWI_OBJ(edi_cache_insert)
+#define unwi_edi_cache_get		UNWI_OBJ(edi_cache_get)
+#define unwi_edi_cache_free		UNWI_OBJ(edi_cache_free)
+
+extern unw_word_t unwi_edi_cache_generation (unw_addr_space_t as);
+extern void unwi_edi_cache_init (struct elf_dyn_info_cache *cache);
+extern void unwi_edi_cache_fini (struct elf_dyn_info_cache *cache);
+extern int unwi_edi_cache_lookup (unw_addr_space_t as,
+				  struct elf_dyn_info_cache *cache,
+				  unw_word_t ip, struct elf_dyn_info *edi);
+extern void unwi_edi_cache_insert (unw_addr_space_t as,
+				   struct elf_dyn_info_cache *cache,
+				   const struct elf_dyn_info *edi,
+				   unw_word_t generation);
+extern struct elf_dyn_info_cache *unwi_edi_cache_get (unw_addr_space_t as);
+extern void unwi_edi_cache_free (unw_addr_space_t as);
+/* End of ANDROID update. */
+
 
 /* Provide a place holder for architecture to override for fast access
    to memory when known not to need to validate and know the access
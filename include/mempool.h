@@ -47,11 +47,26 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
     no absolute guarantee that unwinding will always work, but in
     practice, this should not be a serious problem.  */
 
+/* ANDROID support update. */
+/* Each thread also keeps a small magazine of free objects for each
+   pool, so that allocating and freeing does not take the pool lock
+   in the common case.  Magazines are refilled from the pool and
+   drained back into it a batch at a time, and are returned to the
+   pool when the thread exits.  The per-thread memory is itself
+   carved out of the SOS arena with sos_alloc(), which starts with a
+   static chunk, when a thread first uses a pool, and is given back
+   with sos_free() when the thread exits.  */
+/* End of ANDROID update. */
+
 #include <sys/types.h>
 
 #include "libunwind_i.h"
 
 #define sos_alloc(s)		UNWI_ARCH_OBJ(_sos_alloc)(s)
+/* ANDROID support update. */
+#define sos_free(m,s)		UNWI_ARCH_OBJ(_sos_free)(m,s)
+#define sos_get_usage(m,u)	UNWI_ARCH_OBJ(_sos_get_usage)(m,u)
+/* End of ANDROID update. */
 #define mempool_init(p,s,r)	UNWI_ARCH_OBJ(_mempool_init)(p,s,r)
 #define mempool_alloc(p)	UNWI_ARCH_OBJ(_mempool_alloc)(p)
 #define mempool_free(p,o)	UNWI_ARCH_OBJ(_mempool_free)(p,o)
@@ -65,6 +80,9 @@ struct mempool
     size_t chunk_size;		/* allocation granularity */
     unsigned int reserve;	/* minimum (desired) size of the free-list */
     unsigned int num_free;	/* number of objects on the free-list */
+    /* ANDROID support update. */
+    unsigned int magazine;	/* 1 + index of the per-thread magazine, or 0 */
+    /* End of ANDROID update. */
     struct object
       {
 	struct object *next;
@@ -72,10 +90,18 @@ struct mempool
     *free_list;
   };
 
-/* Emergency allocation for one-time stuff that doesn't fit the memory
-   pool model.  A limited amount of memory is available in this
-   fashion and once allocated, there is no way to free it.  */
+/* ANDROID support update. */
+/* Allocation for stuff that doesn't fit the memory pool model.  The
+   memory comes from a static area first and then from chunks mapped
+   in large steps; NULL is returned only once mmap() fails.  Memory
+   that is no longer needed can be given back with sos_free(), with
+   the size it was allocated with, and chunks with nothing left in use
+   are unmapped.  sos_get_usage() reports the bytes mapped for the
+   arena (including the static area) and the bytes in use.  */
 extern void *sos_alloc (size_t size);
+extern void sos_free (void *mem, size_t size);
+extern void sos_get_usage (size_t *mapped, size_t *in_use);
+/* End of ANDROID update. */
 
 /* Initialize POOL for an object size of OBJECT_SIZE bytes.  RESERVE
    is the number of objects that should be reserved for use under
@@ -72,9 +72,19 @@ struct unw_addr_space
 #endif
     unw_word_t dyn_generation;          /* see dyn-common.h */
     unw_word_t dyn_info_list_addr;	/* (cached) dyn_info_list_addr */
+    /* ANDROID support update. */
+    struct unw_dyn_remote_cache *dyn_remote_cache;	/* see Gdyn-remote.c */
+    struct elf_dyn_info_cache *edi_cache;		/* see Gedi_cache.c */
+    /* End of ANDROID update. */
     struct dwarf_rs_cache global_cache;
+    /* ANDROID support update. */
+    struct dwarf_cie_cache cie_cache;	/* see Gfde.c */
+    struct dwarf_fde_cache fde_cache;	/* see Gfind_proc_info-lsb.c */
+    struct dwarf_expr_cache expr_cache;	/* see Gexpr.c */
+    /* End of ANDROID update. */
     struct unw_debug_frame_list *debug_frames;
     /* ANDROID support update. */
+    struct unw_debug_frame_index debug_frame_index;	/* see Gfind_proc_info-lsb.c */
     struct map_info *map_list;
     /* End of ANDROID update. */
    };
@@ -44,12 +44,61 @@ struct arm_exbuf_data
   uint32_t data;
 };
 
+/* ANDROID support update. */
+/* Decoded unwind instructions of exidx entries, see Gex_tables.c.  */
+#define ARM_EXIDX_LOG_CACHE_SIZE	8
+#define ARM_EXIDX_CACHE_SIZE		(1 << ARM_EXIDX_LOG_CACHE_SIZE)
+#define ARM_EXIDX_CACHE_CMDS		6
+
+struct arm_exidx_cache
+{
+  pthread_mutex_t lock;
+  uint32_t generation;		/* generation number */
+  struct
+    {
+      unw_word_t entry;		/* address of the exidx entry, or 0 */
+      int8_t ncmds;		/* -1 if the entry is EXIDX_CANTUNWIND */
+      struct arm_exbuf_data cmds[ARM_EXIDX_CACHE_CMDS];
+    }
+  entries[ARM_EXIDX_CACHE_SIZE];
+};
+
+/* Local copies of the .ARM.exidx tables of a remote address space,
+   sorted by address, see Gex_tables.c.  */
+struct arm_exidx_copy
+{
+  unw_word_t table_data;	/* address of the table in the target */
+  unw_word_t table_len;
+  uint32_t *words;
+};
+
+struct arm_exidx_copies
+{
+  pthread_mutex_t lock;
+  uint32_t generation;		/* generation number */
+  unsigned int num_tables;
+  unsigned int max_tables;
+  struct arm_exidx_copy *tables;
+};
+/* End of ANDROID update. */
+
 #define arm_exidx_extract	UNW_OBJ(arm_exidx_extract)
 #define arm_exidx_decode	UNW_OBJ(arm_exidx_decode)
 #define arm_exidx_apply_cmd	UNW_OBJ(arm_exidx_apply_cmd)
+/* ANDROID support update. */
+#define arm_exidx_unwind	UNW_OBJ(arm_exidx_unwind)
+#define arm_exidx_copy_table	UNW_OBJ(arm_exidx_copy_table)
+#define arm_exidx_free_copies	UNW_OBJ(arm_exidx_free_copies)
+/* End of ANDROID update. */
 
 int arm_exidx_extract (struct dwarf_cursor *c, uint8_t *buf);
 int arm_exidx_decode (const uint8_t *buf, uint8_t len, struct dwarf_cursor *c);
 int arm_exidx_apply_cmd (struct arm_exbuf_data *edata, struct dwarf_cursor *c);
+/* ANDROID support update. */
+int arm_exidx_unwind (struct dwarf_cursor *c);
+void arm_exidx_copy_table (unw_addr_space_t as, const unw_dyn_info_t *di,
+			   const void *image);
+void arm_exidx_free_copies (unw_addr_space_t as);
+/* End of ANDROID update. */
 
 #endif // ARM_EX_TABLES_H
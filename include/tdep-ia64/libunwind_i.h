@@ -107,6 +107,10 @@ struct unw_addr_space
 #endif
     unw_word_t dyn_generation;
     unw_word_t dyn_info_list_addr;	/* (cached) dyn_info_list_addr */
+    /* ANDROID support update. */
+    struct unw_dyn_remote_cache *dyn_remote_cache;	/* see Gdyn-remote.c */
+    struct elf_dyn_info_cache *edi_cache;		/* see Gedi_cache.c */
+    /* End of ANDROID update. */
 #ifndef UNW_REMOTE_ONLY
     unsigned long long shared_object_removals;
 #endif
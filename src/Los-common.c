@@ -69,8 +69,7 @@ move_cached_elf_data (struct map_info *old_list, struct map_info *new_list)
               /* If it was mapped before, make sure to mark it unmapped now. */
               old_list->ei.mapped = false;
               /* Clear the old mini debug info so we do not try to free it twice */
-              old_list->ei.mini_debug_info_data = NULL;
-              old_list->ei.mini_debug_info_size = 0;
+              old_list->ei.mini_debug_info = NULL;
               /* Don't bother breaking out of the loop, the next while check
                  is guaranteed to fail, causing us to break out of the loop
                  after advancing to the next map element. */
@@ -95,6 +94,9 @@ rebuild_if_necessary (unw_word_t addr, int expected_flags, size_t bytes)
   int ret_value = -1;
   intrmask_t saved_mask;
 
+  /* ANDROID support update. */
+  UNWI_STAT_INC (UNWI_STAT_MAP_REBUILDS);
+  /* End of ANDROID update. */
   new_list = map_create_list (UNW_MAP_CREATE_LOCAL, getpid());
   map = map_find_from_addr (new_list, addr);
   if (map && (map->end - addr >= bytes) && (expected_flags == 0 || (map->flags & expected_flags)))
@@ -88,6 +88,7 @@ access_mem (unw_addr_space_t as, unw_word_t addr, unw_word_t *val, int write,
     {
       /* ANDROID support update. */
 #ifdef UNW_LOCAL_ONLY
+      unwi_local_mem_flush ();
       if (map_local_is_writable (addr, sizeof(unw_word_t)))
         {
 #endif
@@ -105,12 +106,33 @@ access_mem (unw_addr_space_t as, unw_word_t addr, unw_word_t *val, int write,
     }
   else
     {
+      /* ANDROID support update. */
+#ifdef UNW_LOCAL_ONLY
+      int ret = unwi_local_read_mem (addr, val);
+
+      if (ret > 0)
+        {
+          UNWI_STAT_ADD (UNWI_STAT_ACCESS_MEM_BYTES, sizeof (unw_word_t));
+          Debug (16, "mem[%lx] -> %lx\n", addr, *val);
+          return 0;
+        }
+      else if (ret == 0)
+        {
+          Debug (16, "Unreadable memory mem[%lx] -> XXX\n", addr);
+          return -1;
+        }
+#endif
+      /* End of ANDROID update. */
+
       /* ANDROID support update. */
 #ifdef UNW_LOCAL_ONLY
       if (map_local_is_readable (addr, sizeof(unw_word_t)))
         {
 #endif
           *val = *(unw_word_t *) addr;
+          /* ANDROID support update. */
+          UNWI_STAT_ADD (UNWI_STAT_ACCESS_MEM_BYTES, sizeof (unw_word_t));
+          /* End of ANDROID update. */
           Debug (16, "mem[%lx] -> %lx\n", addr, *val);
 #ifdef UNW_LOCAL_ONLY
         }
@@ -68,6 +68,246 @@ prel31_to_addr (unw_addr_space_t as, void *arg, unw_word_t prel31,
   return 0;
 }
 
+/* ANDROID support update. */
+#ifndef UNW_LOCAL_ONLY
+/* In a remote address space each prel31_to_addr() is an access_mem()
+   call, a system call for ptrace, and a binary search of .ARM.exidx
+   makes a dozen of them.  When dwarf_find_unwind_table() finds the
+   table in an ELF file that it has mapped, the table is copied, and
+   later searches and entry reads are served from the copy.  Copies are
+   not made with UNW_CACHE_NONE and are dropped when the cache
+   generation of the address space changes.  */
+
+static inline unw_word_t
+prel31_value (unw_word_t addr, uint32_t word)
+{
+  return addr + (unw_word_t) ((int32_t) (word << 1) >> 1);
+}
+
+static void
+free_copies (struct arm_exidx_copies *copies)
+{
+  unsigned int i;
+
+  for (i = 0; i < copies->num_tables; ++i)
+    free (copies->tables[i].words);
+  copies->num_tables = 0;
+}
+
+HIDDEN void
+arm_exidx_free_copies (unw_addr_space_t as)
+{
+  struct arm_exidx_copies *copies = &as->exidx_copies;
+
+  free_copies (copies);
+  free (copies->tables);
+  copies->tables = NULL;
+  copies->max_tables = 0;
+}
+
+static inline struct arm_exidx_copies *
+get_copies (unw_addr_space_t as, intrmask_t *saved_maskp)
+{
+  struct arm_exidx_copies *copies = &as->exidx_copies;
+
+  if (as == unw_local_addr_space || as->caching_policy == UNW_CACHE_NONE)
+    return NULL;
+
+  lock_acquire (&copies->lock, *saved_maskp);
+
+  if (atomic_read (&as->cache_generation) != atomic_read (&copies->generation))
+    {
+      free_copies (copies);
+      copies->generation = as->cache_generation;
+    }
+  return copies;
+}
+
+/* Return the index of the first copy that ends above ADDR.  */
+static unsigned int
+search_copies (struct arm_exidx_copies *copies, unw_word_t addr)
+{
+  unsigned int lo = 0, hi = copies->num_tables, mid;
+
+  while (lo < hi)
+    {
+      mid = (lo + hi) / 2;
+      if (copies->tables[mid].table_data + copies->tables[mid].table_len
+	  <= addr)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  return lo;
+}
+
+/* Return the copy that holds ADDR, with the lock held.  Returns NULL,
+   without the lock, if there is none.  */
+static struct arm_exidx_copy *
+find_copy (unw_addr_space_t as, unw_word_t addr, intrmask_t *saved_maskp)
+{
+  struct arm_exidx_copies *copies;
+  unsigned int i;
+
+  if (!(copies = get_copies (as, saved_maskp)))
+    return NULL;
+
+  i = search_copies (copies, addr);
+  if (i < copies->num_tables && copies->tables[i].table_data <= addr)
+    return copies->tables + i;
+
+  lock_release (&copies->lock, *saved_maskp);
+  return NULL;
+}
+
+/* Copy the table DI, which starts at IMAGE in a local mapping of its
+   ELF file.  Copies that overlap it are stale and are dropped.  Failure
+   to allocate the copy is not an error.  */
+HIDDEN void
+arm_exidx_copy_table (unw_addr_space_t as, const unw_dyn_info_t *di,
+		      const void *image)
+{
+  unw_word_t table_data = di->u.rti.table_data;
+  unw_word_t table_len = di->u.rti.table_len & ~(unw_word_t) 7;
+  struct arm_exidx_copies *copies;
+  struct arm_exidx_copy *t;
+  intrmask_t saved_mask;
+  unsigned int i, j, max;
+  uint32_t *words;
+
+  if (table_len == 0 || !(copies = get_copies (as, &saved_mask)))
+    return;
+
+  i = search_copies (copies, table_data);
+  if (i < copies->num_tables && copies->tables[i].table_data == table_data
+      && copies->tables[i].table_len == table_len)
+    goto out;
+
+  for (j = i; j < copies->num_tables
+	      && copies->tables[j].table_data < table_data + table_len; ++j)
+    free (copies->tables[j].words);
+  if (j > i)
+    {
+      memmove (copies->tables + i, copies->tables + j,
+	       (copies->num_tables - j) * sizeof (*t));
+      copies->num_tables -= j - i;
+    }
+
+  if (copies->num_tables == copies->max_tables)
+    {
+      max = copies->max_tables ? 2 * copies->max_tables : 16;
+      t = realloc (copies->tables, max * sizeof (*t));
+      if (!t)
+	goto out;
+      copies->tables = t;
+      copies->max_tables = max;
+    }
+
+  if (!(words = malloc (table_len)))
+    goto out;
+  memcpy (words, image, table_len);
+
+  t = copies->tables + i;
+  memmove (t + 1, t, (copies->num_tables - i) * sizeof (*t));
+  ++copies->num_tables;
+
+  t->table_data = table_data;
+  t->table_len = table_len;
+  t->words = words;
+
+ out:
+  lock_release (&copies->lock, saved_mask);
+}
+
+/* The binary search of tdep_search_unwind_table(), on the copy of the
+   table DI.  Returns 1 if the table has not been copied.  */
+static int
+search_copied_table (unw_addr_space_t as, unw_word_t ip, unw_dyn_info_t *di,
+		     unw_proc_info_t *pi, int need_unwind_info)
+{
+  struct arm_exidx_copy *t;
+  intrmask_t saved_mask;
+  unw_word_t base, first, last, mid;
+  const uint32_t *w;
+  int ret = 0;
+
+  if (!(t = find_copy (as, di->u.rti.table_data, &saved_mask)))
+    return 1;
+  if (t->table_data != di->u.rti.table_data)
+    {
+      lock_release (&as->exidx_copies.lock, saved_mask);
+      return 1;
+    }
+
+  base = t->table_data;
+  w = t->words;
+  last = t->table_len / 8 - 1;
+
+  if (ip < prel31_value (base, w[0]))
+    ret = -UNW_ENOINFO;
+  else
+    {
+      if (ip >= prel31_value (base + 8 * last, w[2 * last]))
+	{
+	  first = last;
+	  pi->start_ip = prel31_value (base + 8 * last, w[2 * last]);
+	  pi->end_ip = di->end_ip - 1;
+	}
+      else
+	{
+	  first = 0;
+	  while (first < last - 1)
+	    {
+	      mid = first + ((last - first + 1) >> 1);
+	      if (ip < prel31_value (base + 8 * mid, w[2 * mid]))
+		last = mid;
+	      else
+		first = mid;
+	    }
+	  pi->start_ip = prel31_value (base + 8 * first, w[2 * first]);
+	  pi->end_ip = prel31_value (base + 8 * (first + 1),
+				     w[2 * (first + 1)]) - 1;
+	}
+
+      if (need_unwind_info)
+	{
+	  pi->unwind_info_size = 8;
+	  pi->unwind_info = (void *) (base + 8 * first);
+	  pi->format = UNW_INFO_FORMAT_ARM_EXIDX;
+	}
+    }
+
+  lock_release (&as->exidx_copies.lock, saved_mask);
+  return ret;
+}
+
+/* Read the function address and the data word of the exidx entry at
+   ENTRY from its copy.  Returns -1 if the table has not been copied.  */
+static int
+read_copied_entry (unw_addr_space_t as, unw_word_t entry, unw_word_t *addr,
+		   uint32_t *data)
+{
+  struct arm_exidx_copy *t;
+  intrmask_t saved_mask;
+  int ret = -1;
+
+  if (!(t = find_copy (as, entry, &saved_mask)))
+    return -1;
+
+  if ((entry - t->table_data) % 8 == 0
+      && entry + 8 <= t->table_data + t->table_len)
+    {
+      *addr = prel31_value (entry, t->words[(entry - t->table_data) / 4]);
+      *data = t->words[(entry - t->table_data) / 4 + 1];
+      ret = 0;
+    }
+
+  lock_release (&as->exidx_copies.lock, saved_mask);
+  return ret;
+}
+#endif /* !UNW_LOCAL_ONLY */
+/* End of ANDROID update. */
+
 /**
  * Applies the given command onto the new state to the given dwarf_cursor.
  */
@@ -138,17 +378,19 @@ arm_exidx_apply_cmd (struct arm_exbuf_data *edata, struct dwarf_cursor *c)
   return ret;
 }
 
+/* ANDROID support update. */
 /**
- * Decodes the given unwind instructions into arm_exbuf_data and calls
- * arm_exidx_apply_cmd that applies the command onto the dwarf_cursor.
+ * Decodes the given unwind instructions into CMDS, which must have room
+ * for LEN commands.  Returns the number of commands.
  */
-HIDDEN int
-arm_exidx_decode (const uint8_t *buf, uint8_t len, struct dwarf_cursor *c)
+static int
+arm_exidx_parse (const uint8_t *buf, uint8_t len, struct arm_exbuf_data *cmds)
 {
 #define READ_OP() *buf++
   const uint8_t *end = buf + len;
-  int ret;
+  int ncmds = 0;
   struct arm_exbuf_data edata;
+/* End of ANDROID update. */
 
   assert(buf != NULL);
   assert(len > 0);
@@ -267,12 +509,36 @@ arm_exidx_decode (const uint8_t *buf, uint8_t len, struct dwarf_cursor *c)
       else
 	edata.cmd = ARM_EXIDX_CMD_RESERVED;
 
-      ret = arm_exidx_apply_cmd (&edata, c);
+      /* ANDROID support update. */
+      cmds[ncmds++] = edata;
+      /* End of ANDROID update. */
+    }
+  /* ANDROID support update. */
+  return ncmds;
+  /* End of ANDROID update. */
+}
+
+/* ANDROID support update. */
+/**
+ * Decodes the given unwind instructions into arm_exbuf_data and calls
+ * arm_exidx_apply_cmd that applies the command onto the dwarf_cursor.
+ */
+HIDDEN int
+arm_exidx_decode (const uint8_t *buf, uint8_t len, struct dwarf_cursor *c)
+{
+  struct arm_exbuf_data cmds[len];
+  int ncmds, i, ret;
+
+  ncmds = arm_exidx_parse (buf, len, cmds);
+  for (i = 0; i < ncmds; i++)
+    {
+      ret = arm_exidx_apply_cmd (&cmds[i], c);
       if (ret < 0)
 	return ret;
     }
   return 0;
 }
+/* End of ANDROID update. */
 
 /**
  * Reads the entry from the given cursor and extracts the unwind instructions
@@ -294,11 +560,19 @@ arm_exidx_extract (struct dwarf_cursor *c, uint8_t *buf)
        * if bit 31 is one: this is a table entry itself (ARM_EXIDX_COMPACT)
        * if bit 31 is zero: this is a prel31 offset of the start of the
 	 table entry for this function  */
-  if (prel31_to_addr(c->as, c->as_arg, entry, &addr) < 0)
-    return -UNW_EINVAL;
+  /* ANDROID support update. */
+#ifndef UNW_LOCAL_ONLY
+  if (read_copied_entry (c->as, entry, &addr, &data) < 0)
+#endif
+    {
+      if (prel31_to_addr(c->as, c->as_arg, entry, &addr) < 0)
+	return -UNW_EINVAL;
 
-  if ((*c->as->acc.access_mem)(c->as, entry + 4, &data, 0, c->as_arg) < 0)
-    return -UNW_EINVAL;
+      if ((*c->as->acc.access_mem)(c->as, entry + 4, &data, 0,
+				   c->as_arg) < 0)
+	return -UNW_EINVAL;
+    }
+  /* End of ANDROID update. */
 
   if (data == ARM_EXIDX_CANT_UNWIND)
     {
@@ -375,6 +649,111 @@ arm_exidx_extract (struct dwarf_cursor *c, uint8_t *buf)
   return nbuf;
 }
 
+/* ANDROID support update. */
+/* Every step through an exidx entry used to read the entry and its
+   table words again and decode the bytecode.  The decoded commands
+   depend only on the entry, so they are remembered per address space,
+   keyed by the address of the entry.  Entries with more than
+   ARM_EXIDX_CACHE_CMDS commands are rare and are not cached.  Like the
+   CIE cache of Gfde.c, it is bypassed with UNW_CACHE_NONE and emptied
+   by unw_flush_cache().  */
+
+static inline unsigned int
+exidx_cache_hash (unw_word_t entry)
+{
+  /* Entries are 8 bytes apart.  */
+  return ((uint32_t) (entry >> 3) * 0x9e3779b9U)
+	 >> (32 - ARM_EXIDX_LOG_CACHE_SIZE);
+}
+
+static inline struct arm_exidx_cache *
+get_exidx_cache (unw_addr_space_t as, intrmask_t *saved_maskp)
+{
+  struct arm_exidx_cache *cache = &as->exidx_cache;
+  unsigned int i;
+
+  if (as->caching_policy == UNW_CACHE_NONE)
+    return NULL;
+
+  lock_acquire (&cache->lock, *saved_maskp);
+
+  if (atomic_read (&as->cache_generation) != atomic_read (&cache->generation))
+    {
+      for (i = 0; i < ARM_EXIDX_CACHE_SIZE; ++i)
+	cache->entries[i].entry = 0;
+      cache->generation = as->cache_generation;
+    }
+  return cache;
+}
+
+/**
+ * Applies the unwind instructions of the exidx entry c->pi.unwind_info
+ * onto the dwarf_cursor.  Returns -UNW_ESTOPUNWIND if the entry is
+ * EXIDX_CANTUNWIND.
+ */
+HIDDEN int
+arm_exidx_unwind (struct dwarf_cursor *c)
+{
+  unw_word_t entry = (unw_word_t) c->pi.unwind_info;
+  struct arm_exbuf_data cmds[32];
+  struct arm_exidx_cache *cache;
+  uint32_t generation = 0;
+  intrmask_t saved_mask;
+  uint8_t buf[32];
+  int ncmds = -1, hit = 0, i, ret;
+  unsigned int h = exidx_cache_hash (entry);
+
+  if ((cache = get_exidx_cache (c->as, &saved_mask)))
+    {
+      if (cache->entries[h].entry == entry)
+	{
+	  ncmds = cache->entries[h].ncmds;
+	  if (ncmds > 0)
+	    memcpy (cmds, cache->entries[h].cmds, ncmds * sizeof (cmds[0]));
+	  hit = 1;
+	}
+      generation = cache->generation;
+      lock_release (&cache->lock, saved_mask);
+    }
+
+  if (!hit)
+    {
+      /* The memory reads are done without the lock.  */
+      ret = arm_exidx_extract (c, buf);
+      if (ret >= 0)
+	ncmds = arm_exidx_parse (buf, ret, cmds);
+      else if (ret != -UNW_ESTOPUNWIND)
+	return ret;
+
+      if (cache && ncmds <= ARM_EXIDX_CACHE_CMDS
+	  && (cache = get_exidx_cache (c->as, &saved_mask)))
+	{
+	  /* After a flush, ENTRY may belong to another object by now.  */
+	  if (cache->generation == generation)
+	    {
+	      cache->entries[h].entry = entry;
+	      cache->entries[h].ncmds = ncmds;
+	      if (ncmds > 0)
+		memcpy (cache->entries[h].cmds, cmds,
+			ncmds * sizeof (cmds[0]));
+	    }
+	  lock_release (&cache->lock, saved_mask);
+	}
+    }
+
+  if (ncmds < 0)
+    return -UNW_ESTOPUNWIND;
+
+  for (i = 0; i < ncmds; i++)
+    {
+      ret = arm_exidx_apply_cmd (&cmds[i], c);
+      if (ret < 0)
+	return ret;
+    }
+  return 0;
+}
+/* End of ANDROID update. */
+
 PROTECTED int
 tdep_search_unwind_table (unw_addr_space_t as, unw_word_t ip,
 			     unw_dyn_info_t *di, unw_proc_info_t *pi,
@@ -390,6 +769,14 @@ tdep_search_unwind_table (unw_addr_space_t as, unw_word_t ip,
       unw_word_t first = di->u.rti.table_data;
       unw_word_t last = di->u.rti.table_data + di->u.rti.table_len - 8;
       unw_word_t entry, val;
+      /* ANDROID support update. */
+#ifndef UNW_LOCAL_ONLY
+      int ret;
+
+      if ((ret = search_copied_table (as, ip, di, pi, need_unwind_info)) <= 0)
+	return ret;
+#endif
+      /* End of ANDROID update. */
 
       if (prel31_to_addr (as, arg, first, &val) < 0 || ip < val)
 	return -UNW_ENOINFO;
@@ -493,6 +880,197 @@ arm_phdr_cb (struct dl_phdr_info *info, size_t size, void *data)
   return 0;
 }
 
+/* ANDROID support update. */
+/* Finding the exidx table of an IP walks every loaded object with
+   dl_iterate_phdr() and signals masked.  The tables found are kept in
+   an array sorted by start address, so that a lookup is a binary
+   search.  Tables go stale when an object is unloaded; the count of
+   removed objects is read from the first object that dl_iterate_phdr()
+   reports, and when it changes the tables and the decoded entries are
+   dropped.  Without that count, nothing is cached.  */
+
+struct arm_exidx_table
+  {
+    unw_word_t start_ip;
+    unw_word_t end_ip;
+    unw_word_t table_data;
+    unw_word_t table_len;
+  };
+
+static struct
+  {
+    uint32_t generation;	/* as->cache_generation of the tables */
+    unsigned long long removals;
+    unsigned int num_tables;
+    unsigned int max_tables;
+    struct arm_exidx_table *tables;
+  }
+exidx_tables;
+static define_lock (exidx_tables_lock);
+
+#ifdef HAVE_STRUCT_DL_PHDR_INFO_DLPI_SUBS
+static int
+arm_removals_cb (struct dl_phdr_info *info, size_t size, void *data)
+{
+  if (size <
+      offsetof (struct dl_phdr_info, dlpi_subs) + sizeof (info->dlpi_subs))
+    return -1;
+
+  *(unsigned long long *) data = info->dlpi_subs;
+  return 1;
+}
+
+/* Drop the decoded entries of AS, some may be of unloaded objects.  */
+static void
+flush_exidx_cache (unw_addr_space_t as)
+{
+  struct arm_exidx_cache *cache;
+  intrmask_t saved_mask;
+  unsigned int i;
+
+  if (!(cache = get_exidx_cache (as, &saved_mask)))
+    return;
+  for (i = 0; i < ARM_EXIDX_CACHE_SIZE; ++i)
+    cache->entries[i].entry = 0;
+  lock_release (&cache->lock, saved_mask);
+}
+#endif
+
+/* Return 1 if the cached tables can be used, after dropping them and
+   the decoded entries of AS if objects were unloaded since the last
+   call.  The other caches of AS are left alone: other threads may be
+   unwinding with them, and they check for unloaded objects
+   themselves.  */
+static int
+validate_exidx_tables (unw_addr_space_t as)
+{
+#ifdef HAVE_STRUCT_DL_PHDR_INFO_DLPI_SUBS
+  unsigned long long removals;
+  intrmask_t saved_mask;
+  int ret, changed;
+
+  if (as->caching_policy == UNW_CACHE_NONE)
+    return 0;
+
+  SIGPROCMASK (SIG_SETMASK, &unwi_full_mask, &saved_mask);
+  ret = dl_iterate_phdr (arm_removals_cb, &removals);
+  SIGPROCMASK (SIG_SETMASK, &saved_mask, NULL);
+  if (ret != 1)
+    return 0;
+
+  lock_acquire (&exidx_tables_lock, saved_mask);
+  changed = removals != exidx_tables.removals;
+  exidx_tables.removals = removals;
+  if (changed)
+    exidx_tables.num_tables = 0;
+  lock_release (&exidx_tables_lock, saved_mask);
+
+  if (changed)
+    flush_exidx_cache (as);
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+/* Return the index of the first table that ends above IP.  */
+static unsigned int
+search_exidx_tables (unw_word_t ip)
+{
+  unsigned int lo = 0, hi = exidx_tables.num_tables, mid;
+
+  while (lo < hi)
+    {
+      mid = (lo + hi) / 2;
+      if (exidx_tables.tables[mid].end_ip <= ip)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  return lo;
+}
+
+static int
+lookup_exidx_table (unw_addr_space_t as, unw_word_t ip, unw_dyn_info_t *di)
+{
+  struct arm_exidx_table *t;
+  intrmask_t saved_mask;
+  unsigned int i;
+  int ret = 0;
+
+  lock_acquire (&exidx_tables_lock, saved_mask);
+  if (exidx_tables.generation == atomic_read (&as->cache_generation))
+    {
+      i = search_exidx_tables (ip);
+      t = exidx_tables.tables + i;
+      if (i < exidx_tables.num_tables && t->start_ip <= ip)
+	{
+	  di->format = UNW_INFO_FORMAT_ARM_EXIDX;
+	  di->start_ip = t->start_ip;
+	  di->end_ip = t->end_ip;
+	  di->u.rti.table_data = t->table_data;
+	  di->u.rti.table_len = t->table_len;
+	  ret = 1;
+	}
+    }
+  lock_release (&exidx_tables_lock, saved_mask);
+  return ret;
+}
+
+/* Add the table DI to the cache.  Tables that overlap it are stale and
+   are dropped.  Failure to grow the cache is not an error.  */
+static void
+insert_exidx_table (unw_addr_space_t as, const unw_dyn_info_t *di)
+{
+  struct arm_exidx_table *t;
+  intrmask_t saved_mask;
+  uint32_t generation;
+  unsigned int i, j, max;
+
+  lock_acquire (&exidx_tables_lock, saved_mask);
+
+  generation = atomic_read (&as->cache_generation);
+  if (exidx_tables.generation != generation)
+    {
+      exidx_tables.num_tables = 0;
+      exidx_tables.generation = generation;
+    }
+
+  i = search_exidx_tables (di->start_ip);
+  for (j = i; j < exidx_tables.num_tables
+	      && exidx_tables.tables[j].start_ip < di->end_ip; ++j)
+    ;
+  if (j > i)
+    {
+      memmove (exidx_tables.tables + i, exidx_tables.tables + j,
+	       (exidx_tables.num_tables - j) * sizeof (*t));
+      exidx_tables.num_tables -= j - i;
+    }
+
+  if (exidx_tables.num_tables == exidx_tables.max_tables)
+    {
+      max = exidx_tables.max_tables ? 2 * exidx_tables.max_tables : 16;
+      t = realloc (exidx_tables.tables, max * sizeof (*t));
+      if (!t)
+	goto out;
+      exidx_tables.tables = t;
+      exidx_tables.max_tables = max;
+    }
+
+  t = exidx_tables.tables + i;
+  memmove (t + 1, t, (exidx_tables.num_tables - i) * sizeof (*t));
+  ++exidx_tables.num_tables;
+
+  t->start_ip = di->start_ip;
+  t->end_ip = di->end_ip;
+  t->table_data = di->u.rti.table_data;
+  t->table_len = di->u.rti.table_len;
+
+ out:
+  lock_release (&exidx_tables_lock, saved_mask);
+}
+/* End of ANDROID update. */
+
 HIDDEN int
 arm_find_proc_info (unw_addr_space_t as, unw_word_t ip,
 		    unw_proc_info_t *pi, int need_unwind_info, void *arg)
@@ -510,15 +1088,28 @@ arm_find_proc_info (unw_addr_space_t as, unw_word_t ip,
   if (ret < 0 && UNW_TRY_METHOD (UNW_ARM_METHOD_EXIDX))
     {
       struct arm_cb_data cb_data;
+      /* ANDROID support update. */
+      int cached;
+      /* End of ANDROID update. */
 
       memset (&cb_data, 0, sizeof (cb_data));
       cb_data.ip = ip;
       cb_data.pi = pi;
       cb_data.di.format = -1;
 
-      SIGPROCMASK (SIG_SETMASK, &unwi_full_mask, &saved_mask);
-      ret = dl_iterate_phdr (arm_phdr_cb, &cb_data);
-      SIGPROCMASK (SIG_SETMASK, &saved_mask, NULL);
+      /* ANDROID support update. */
+      cached = validate_exidx_tables (as);
+      if (!cached || !lookup_exidx_table (as, ip, &cb_data.di))
+	{
+	  UNWI_STAT_INC (UNWI_STAT_DL_ITERATE_PHDR_CALLS);
+	  SIGPROCMASK (SIG_SETMASK, &unwi_full_mask, &saved_mask);
+	  ret = dl_iterate_phdr (arm_phdr_cb, &cb_data);
+	  SIGPROCMASK (SIG_SETMASK, &saved_mask, NULL);
+
+	  if (cached && cb_data.di.format != -1)
+	    insert_exidx_table (as, &cb_data.di);
+	}
+      /* End of ANDROID update. */
 
       if (cb_data.di.format != -1)
 	ret = tdep_search_unwind_table (as, ip, &cb_data.di, pi,
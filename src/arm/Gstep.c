@@ -35,7 +35,9 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
 static inline int
 arm_exidx_step (struct cursor *c)
 {
-  uint8_t buf[32];
+  /* ANDROID support update. */
+  /* Removed: uint8_t buf[32]; */
+  /* End of ANDROID update. */
   int ret;
 
   /* mark PC unsaved */
@@ -47,15 +49,13 @@ arm_exidx_step (struct cursor *c)
   if (c->dwarf.pi.format != UNW_INFO_FORMAT_ARM_EXIDX)
     return -UNW_ENOINFO;
 
-  ret = arm_exidx_extract (&c->dwarf, buf);
+  /* ANDROID support update. */
+  ret = arm_exidx_unwind (&c->dwarf);
   if (ret == -UNW_ESTOPUNWIND)
     return 0;
   else if (ret < 0)
     return ret;
-
-  ret = arm_exidx_decode (buf, ret, &c->dwarf);
-  if (ret < 0)
-    return ret;
+  /* End of ANDROID update. */
 
   c->dwarf.pi_valid = 0;
 
@@ -90,6 +90,12 @@ _UCD_create(const char *filename)
 #if UNW_TARGET_IA64
   ui->edi.ktab.format = -1;
 #endif
+  /* ANDROID support update. */
+#if UNW_TARGET_ARM
+  ui->edi.di_arm.format = -1;
+#endif
+  unwi_edi_cache_init (&ui->edi_cache);
+  /* End of ANDROID update. */
 
   int fd = ui->coredump_fd = open(filename, O_RDONLY);
   if (fd < 0)
@@ -34,6 +34,9 @@ _UCD_destroy (struct UCD_info *ui)
   free(ui->coredump_filename);
 
   invalidate_edi (&ui->edi);
+  /* ANDROID support update. */
+  unwi_edi_cache_fini (&ui->edi_cache);
+  /* End of ANDROID update. */
 
   unsigned i;
   for (i = 0; i < ui->phdrs_count; i++)
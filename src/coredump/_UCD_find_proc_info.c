@@ -30,6 +30,9 @@ static int
 get_unwind_info(struct UCD_info *ui, unw_addr_space_t as, unw_word_t ip)
 {
   unsigned long segbase, mapoff;
+  /* ANDROID support update. */
+  unw_word_t generation;
+  /* End of ANDROID update. */
 
 #if UNW_TARGET_IA64 && defined(__linux)
   if (!ui->edi.ktab.start_ip && _Uia64_get_kernel_table (&ui->edi.ktab) < 0)
@@ -39,17 +42,29 @@ get_unwind_info(struct UCD_info *ui, unw_addr_space_t as, unw_word_t ip)
     return 0;
 #endif
 
-  if ((ui->edi.di_cache.format != -1
-       && ip >= ui->edi.di_cache.start_ip && ip < ui->edi.di_cache.end_ip)
+  /* ANDROID support update. */
+  generation = unwi_edi_cache_generation (as);
+  if (ui->edi_generation == generation
+      && ((ui->edi.di_cache.format != -1
+	   && ip >= ui->edi.di_cache.start_ip && ip < ui->edi.di_cache.end_ip)
 #if UNW_TARGET_ARM
-      || (ui->edi.di_debug.format != -1
-       && ip >= ui->edi.di_arm.start_ip && ip < ui->edi.di_arm.end_ip)
+	  || (ui->edi.di_arm.format != -1
+	      && ip >= ui->edi.di_arm.start_ip && ip < ui->edi.di_arm.end_ip)
 #endif
-      || (ui->edi.di_debug.format != -1
-       && ip >= ui->edi.di_debug.start_ip && ip < ui->edi.di_debug.end_ip))
+	  || (ui->edi.di_debug.format != -1
+	      && ip >= ui->edi.di_debug.start_ip && ip < ui->edi.di_debug.end_ip)))
     return 0;
 
   invalidate_edi (&ui->edi);
+  ui->edi_generation = generation;
+
+  /* Consecutive frames often alternate between a few images, and the
+     other threads of the core run through the same images.  Locating
+     the tables again means many small reads of the core and the
+     backing files.  */
+  if (unwi_edi_cache_lookup (as, &ui->edi_cache, ip, &ui->edi) == 0)
+    return 0;
+  /* End of ANDROID update. */
 
   /* Used to be tdep_get_elf_image() in ptrace unwinding code */
   coredump_phdr_t *phdr = _UCD_get_elf_image(ui, ip);
@@ -96,6 +111,10 @@ get_unwind_info(struct UCD_info *ui, unw_addr_space_t as, unw_word_t ip)
     return -UNW_ENOINFO;
   }
 
+  /* ANDROID support update. */
+  unwi_edi_cache_insert (as, &ui->edi_cache, &ui->edi, generation);
+  /* End of ANDROID update. */
+
   Debug(1, "returns success\n");
   return 0;
 }
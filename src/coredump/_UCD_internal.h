@@ -95,6 +95,12 @@ struct UCD_info
     struct PRSTATUS_STRUCT **threads;
 
     struct elf_dyn_info edi;
+    /* ANDROID support update. */
+    /* Tables of all images seen so far.  All threads of the core share
+       the same memory image, so this survives _UCD_select_thread().  */
+    struct elf_dyn_info_cache edi_cache;
+    unw_word_t edi_generation;	/* unwi_edi_cache_generation() for edi */
+    /* End of ANDROID update. */
   };
 
 extern coredump_phdr_t * _UCD_get_elf_image(struct UCD_info *ui, unw_word_t ip);
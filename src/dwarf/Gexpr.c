@@ -186,6 +186,233 @@ read_operand (unw_addr_space_t as, unw_accessors_t *a,
   return ret;
 }
 
+/* ANDROID support update. */
+/* Compilers emit only a few kinds of location expressions in practice:
+   register-relative addresses with an optional dereference (DW_CFA_
+   expression rules, signal frames), register locations, and the CFA
+   rule of the x86 and x86-64 PLT, which depends on whether the IP is
+   in the first or second half of a PLT entry.  These are recognized
+   once and remembered per expression address, so that evaluating them
+   again reads neither opcodes nor operands.  */
+
+#define MAX_COMPILED_EXPR_LEN	32
+
+static inline unsigned int
+expr_cache_hash (unw_word_t addr)
+{
+  /* based on (sqrt(5)/2-1)*2^64 */
+  return (addr * (unw_word_t) 0x9e3779b97f4a7c16ULL)
+	 >> (sizeof (unw_word_t) * 8 - DWARF_LOG_EXPR_CACHE_SIZE);
+}
+
+static inline struct dwarf_expr_cache *
+get_expr_cache (unw_addr_space_t as, intrmask_t *saved_maskp)
+{
+  struct dwarf_expr_cache *cache = &as->expr_cache;
+
+  if (as->caching_policy == UNW_CACHE_NONE)
+    return NULL;
+
+  lock_acquire (&cache->lock, *saved_maskp);
+
+  if (atomic_read (&as->cache_generation) != atomic_read (&cache->generation))
+    {
+      memset (cache->entries, 0, sizeof (cache->entries));
+      cache->generation = as->cache_generation;
+    }
+  return cache;
+}
+
+static inline int
+read_lit (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
+	  uint8_t *litp, void *arg)
+{
+  uint8_t opcode;
+  int ret;
+
+  if ((ret = dwarf_readu8 (as, a, addr, &opcode, arg)) < 0)
+    return ret;
+  if (opcode < DW_OP_lit0 || opcode > DW_OP_lit31)
+    return -UNW_EINVAL;
+  *litp = opcode - DW_OP_lit0;
+  return 0;
+}
+
+static inline int
+expect_op (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
+	   uint8_t expected, void *arg)
+{
+  uint8_t opcode;
+  int ret;
+
+  if ((ret = dwarf_readu8 (as, a, addr, &opcode, arg)) < 0)
+    return ret;
+  return opcode == expected ? 0 : -UNW_EINVAL;
+}
+
+/* Fill in E for the expression of LEN bytes at ADDR.  Anything that
+   isn't one of the forms above, or can't be read, is left to the stack
+   machine.  */
+static void
+compile_expr (unw_addr_space_t as, unw_accessors_t *a, unw_word_t addr,
+	      unw_word_t len, struct dwarf_compiled_expr *e, void *arg)
+{
+  unw_word_t end_addr = addr + len, operand;
+  uint8_t opcode;
+
+  memset (e, 0, sizeof (*e));
+  e->kind = DWARF_EXPR_GENERIC;
+
+  if (len == 0 || len > MAX_COMPILED_EXPR_LEN
+      || dwarf_readu8 (as, a, &addr, &opcode, arg) < 0)
+    return;
+
+  if (opcode >= DW_OP_reg0 && opcode <= DW_OP_reg31)
+    {
+      if (addr == end_addr)
+	{
+	  e->reg1 = opcode - DW_OP_reg0;
+	  e->kind = DWARF_EXPR_REG;
+	}
+      return;
+    }
+
+  if (opcode == DW_OP_regx)
+    {
+      if (dwarf_read_uleb128 (as, a, &addr, &operand, arg) < 0
+	  || addr != end_addr || operand > 0xffff)
+	return;
+      e->reg1 = operand;
+      e->kind = DWARF_EXPR_REG;
+      return;
+    }
+
+  if (opcode < DW_OP_breg0 || opcode > DW_OP_breg31
+      || dwarf_read_sleb128 (as, a, &addr, &e->off1, arg) < 0)
+    return;
+  e->reg1 = opcode - DW_OP_breg0;
+
+  if (addr == end_addr)
+    {
+      e->kind = DWARF_EXPR_BREG;
+      return;
+    }
+
+  if (dwarf_readu8 (as, a, &addr, &opcode, arg) < 0)
+    return;
+
+  if (opcode == DW_OP_deref)
+    {
+      e->deref = 1;
+      if (addr != end_addr
+	  && (expect_op (as, a, &addr, DW_OP_plus_uconst, arg) < 0
+	      || dwarf_read_uleb128 (as, a, &addr, &e->off2, arg) < 0
+	      || addr != end_addr))
+	return;
+      e->kind = DWARF_EXPR_BREG;
+      return;
+    }
+
+  /* DW_OP_bregA a; DW_OP_bregB b; DW_OP_litM; DW_OP_and; DW_OP_litT;
+     DW_OP_ge; DW_OP_litS; DW_OP_shl; DW_OP_plus */
+  if (opcode < DW_OP_breg0 || opcode > DW_OP_breg31
+      || dwarf_read_sleb128 (as, a, &addr, &e->off2, arg) < 0
+      || read_lit (as, a, &addr, &e->mask, arg) < 0
+      || expect_op (as, a, &addr, DW_OP_and, arg) < 0
+      || read_lit (as, a, &addr, &e->threshold, arg) < 0
+      || expect_op (as, a, &addr, DW_OP_ge, arg) < 0
+      || read_lit (as, a, &addr, &e->shift, arg) < 0
+      || expect_op (as, a, &addr, DW_OP_shl, arg) < 0
+      || expect_op (as, a, &addr, DW_OP_plus, arg) < 0
+      || addr != end_addr)
+    return;
+  e->reg2 = opcode - DW_OP_breg0;
+  e->kind = DWARF_EXPR_PLT;
+}
+
+static void
+get_compiled_expr (unw_addr_space_t as, unw_accessors_t *a, unw_word_t addr,
+		   unw_word_t len, struct dwarf_compiled_expr *e, void *arg)
+{
+  struct dwarf_expr_cache *cache;
+  intrmask_t saved_mask;
+  uint32_t generation;
+  unsigned int i;
+
+  if (!(cache = get_expr_cache (as, &saved_mask)))
+    {
+      e->kind = DWARF_EXPR_GENERIC;
+      return;
+    }
+
+  i = expr_cache_hash (addr);
+  if (cache->entries[i].addr == addr && cache->entries[i].len == len)
+    {
+      *e = cache->entries[i];
+      lock_release (&cache->lock, saved_mask);
+      return;
+    }
+  generation = cache->generation;
+  lock_release (&cache->lock, saved_mask);
+
+  compile_expr (as, a, addr, len, e, arg);
+  e->addr = addr;
+  e->len = len;
+
+  if ((cache = get_expr_cache (as, &saved_mask)))
+    {
+      /* After a flush, ADDR may belong to another object by now.  */
+      if (cache->generation == generation)
+	cache->entries[i] = *e;
+      lock_release (&cache->lock, saved_mask);
+    }
+}
+
+static int
+eval_compiled_expr (struct dwarf_cursor *c, unw_addr_space_t as,
+		    unw_accessors_t *a, const struct dwarf_compiled_expr *e,
+		    unw_word_t *valp, int *is_register, void *arg)
+{
+  unw_word_t val1, val2;
+  int ret;
+  if (e->kind == DWARF_EXPR_REG)
+    {
+      Debug (15, "compiled OP_reg(r%d)\n", (int) e->reg1);
+      *valp = dwarf_to_unw_regnum (e->reg1);
+      *is_register = 1;
+      return 0;
+    }
+
+  if ((ret = unw_get_reg (dwarf_to_cursor (c),
+			  dwarf_to_unw_regnum (e->reg1), &val1)) < 0)
+    return ret;
+  val1 += e->off1;
+
+  if (e->kind == DWARF_EXPR_PLT)
+    {
+      if ((ret = unw_get_reg (dwarf_to_cursor (c),
+			      dwarf_to_unw_regnum (e->reg2), &val2)) < 0)
+	return ret;
+      val2 = (val2 + e->off2) & e->mask;
+      *valp = val1 + ((unw_word_t) (val2 >= e->threshold) << e->shift);
+    }
+  else if (e->deref)
+    {
+      /* ANDROID support update. */
+      if ((ret = dwarf_mem_readw (as, a, &val1, &val2, arg)) < 0)
+	return ret;
+      /* End of ANDROID update. */
+      *valp = val2 + e->off2;
+    }
+  else
+    *valp = val1;
+
+  Debug (14, "compiled expression, final value = 0x%lx\n",
+	 (unsigned long) *valp);
+  return 0;
+}
+/* End of ANDROID update. */
+
 HIDDEN int
 dwarf_eval_expr (struct dwarf_cursor *c, unw_word_t *addr, unw_word_t len,
 		 unw_word_t *valp, int *is_register)
@@ -201,6 +428,9 @@ dwarf_eval_expr (struct dwarf_cursor *c, unw_word_t *addr, unw_word_t len,
   uint32_t u32;
   uint64_t u64;
   int ret;
+  /* ANDROID support update. */
+  struct dwarf_compiled_expr e;
+  /* End of ANDROID update. */
 # define pop()					\
 ({						\
   if ((tos - 1) >= MAX_EXPR_STACK_SIZE)		\
@@ -236,6 +466,15 @@ do {						\
   end_addr = *addr + len;
   *is_register = 0;
 
+  /* ANDROID support update. */
+  get_compiled_expr (as, a, *addr, len, &e, arg);
+  if (e.kind != DWARF_EXPR_GENERIC)
+    {
+      *addr = end_addr;
+      return eval_compiled_expr (c, as, a, &e, valp, is_register, arg);
+    }
+  /* End of ANDROID update. */
+
   Debug (14, "len=%lu, pushing cfa=0x%lx\n",
 	 (unsigned long) len, (unsigned long) c->cfa);
 
@@ -362,10 +601,12 @@ do {						\
 	  push (operand1);
 	  break;
 
+	/* ANDROID support update. */
+	/* The operand is target memory, not unwind info.  */
 	case DW_OP_deref:
 	  Debug (15, "OP_deref\n");
 	  tmp1 = pop ();
-	  if ((ret = dwarf_readw (as, a, &tmp1, &tmp2, arg)) < 0)
+	  if ((ret = dwarf_mem_readw (as, a, &tmp1, &tmp2, arg)) < 0)
 	    return ret;
 	  push (tmp2);
 	  break;
@@ -381,20 +622,20 @@ do {						\
 	      return -UNW_EINVAL;
 
 	    case 1:
-	      if ((ret = dwarf_readu8 (as, a, &tmp1, &u8, arg)) < 0)
+	      if ((ret = dwarf_mem_readu8 (as, a, &tmp1, &u8, arg)) < 0)
 		return ret;
 	      tmp2 = u8;
 	      break;
 
 	    case 2:
-	      if ((ret = dwarf_readu16 (as, a, &tmp1, &u16, arg)) < 0)
+	      if ((ret = dwarf_mem_readu16 (as, a, &tmp1, &u16, arg)) < 0)
 		return ret;
 	      tmp2 = u16;
 	      break;
 
 	    case 3:
 	    case 4:
-	      if ((ret = dwarf_readu32 (as, a, &tmp1, &u32, arg)) < 0)
+	      if ((ret = dwarf_mem_readu32 (as, a, &tmp1, &u32, arg)) < 0)
 		return ret;
 	      tmp2 = u32;
 	      if (operand1 == 3)
@@ -409,7 +650,7 @@ do {						\
 	    case 6:
 	    case 7:
 	    case 8:
-	      if ((ret = dwarf_readu64 (as, a, &tmp1, &u64, arg)) < 0)
+	      if ((ret = dwarf_mem_readu64 (as, a, &tmp1, &u64, arg)) < 0)
 		return ret;
 	      tmp2 = u64;
 	      if (operand1 != 8)
@@ -423,6 +664,7 @@ do {						\
 	    }
 	  push (tmp2);
 	  break;
+	/* End of ANDROID update. */
 
 	case DW_OP_dup:
 	  Debug (15, "OP_dup\n");
@@ -230,6 +230,104 @@ parse_cie (unw_addr_space_t as, unw_accessors_t *a, unw_word_t addr,
   return 0;
 }
 
+/* ANDROID support update. */
+/* Every FDE names its CIE, and a module has only a handful of CIEs
+   shared by thousands of FDEs.  Remember the parsed CIEs per address
+   space, so that decoding an FDE does not read its CIE again; for
+   remote and coredump unwinding every byte read is a system call or a
+   file read.  The result of parse_cie() depends only on the CIE bytes
+   and on the global pointer (for data-relative personality pointers),
+   so those are the key.  The cache is subject to the caching policy
+   and is flushed along with the other caches of the address space.  */
+
+static inline unsigned int
+cie_cache_hash (unw_word_t addr)
+{
+  /* based on (sqrt(5)/2-1)*2^64 */
+  return (addr * (unw_word_t) 0x9e3779b97f4a7c16ULL)
+	 >> (sizeof (unw_word_t) * 8 - DWARF_LOG_CIE_CACHE_SIZE);
+}
+
+HIDDEN void
+dwarf_flush_cie_cache (struct dwarf_cie_cache *cache)
+{
+  unsigned int i;
+
+  for (i = 0; i < DWARF_CIE_CACHE_SIZE; ++i)
+    if (cache->entries[i].dci)
+      {
+	mempool_free (&dwarf_cie_info_pool, cache->entries[i].dci);
+	cache->entries[i].dci = NULL;
+      }
+}
+
+static inline struct dwarf_cie_cache *
+get_cie_cache (unw_addr_space_t as, intrmask_t *saved_maskp)
+{
+  struct dwarf_cie_cache *cache = &as->cie_cache;
+
+  if (as->caching_policy == UNW_CACHE_NONE)
+    return NULL;
+
+  lock_acquire (&cache->lock, *saved_maskp);
+
+  if (atomic_read (&as->cache_generation) != atomic_read (&cache->generation))
+    {
+      dwarf_flush_cie_cache (cache);
+      cache->generation = as->cache_generation;
+    }
+  return cache;
+}
+
+static int
+get_cie_info (unw_addr_space_t as, unw_accessors_t *a, unw_word_t addr,
+	      const unw_proc_info_t *pi, struct dwarf_cie_info *dci,
+	      unw_word_t base, void *arg)
+{
+  struct dwarf_cie_cache *cache;
+  uint32_t generation;
+  intrmask_t saved_mask;
+  unsigned int i;
+  int ret;
+
+  if (!(cache = get_cie_cache (as, &saved_mask)))
+    return parse_cie (as, a, addr, pi, dci, base, arg);
+
+  i = cie_cache_hash (addr);
+  if (cache->entries[i].dci && cache->entries[i].addr == addr
+      && cache->entries[i].gp == pi->gp)
+    {
+      *dci = *cache->entries[i].dci;
+      lock_release (&cache->lock, saved_mask);
+      return 0;
+    }
+  generation = cache->generation;
+  lock_release (&cache->lock, saved_mask);
+
+  /* Don't hold the lock while reading the CIE, the accessors may be
+     slow.  */
+  if ((ret = parse_cie (as, a, addr, pi, dci, base, arg)) < 0)
+    return ret;
+
+  if (!(cache = get_cie_cache (as, &saved_mask)))
+    return 0;
+  /* After a flush, ADDR may belong to another object by now.  */
+  if (cache->generation == generation)
+    {
+      if (!cache->entries[i].dci)
+	cache->entries[i].dci = mempool_alloc (&dwarf_cie_info_pool);
+      if (cache->entries[i].dci)
+	{
+	  cache->entries[i].addr = addr;
+	  cache->entries[i].gp = pi->gp;
+	  *cache->entries[i].dci = *dci;
+	}
+    }
+  lock_release (&cache->lock, saved_mask);
+  return 0;
+}
+/* End of ANDROID update. */
+
 /* Extract proc-info from the FDE starting at adress ADDR.
    
    Pass BASE as zero for eh_frame behaviour, or a pointer to
@@ -316,8 +414,10 @@ dwarf_extract_proc_info_from_fde (unw_addr_space_t as, unw_accessors_t *a,
 
   Debug (15, "looking for CIE at address %lx\n", (long) cie_addr);
 
-  if ((ret = parse_cie (as, a, cie_addr, pi, &dci, base, arg)) < 0)
+  /* ANDROID support update. */
+  if ((ret = get_cie_info (as, a, cie_addr, pi, &dci, base, arg)) < 0)
     return ret;
+  /* End of ANDROID update. */
 
   /* IP-range has same encoding as FDE pointers, except that it's
      always an absolute value: */
@@ -368,6 +468,10 @@ dwarf_extract_proc_info_from_fde (unw_addr_space_t as, unw_accessors_t *a,
       else
 	dci.fde_instr_start = addr;
       dci.fde_instr_end = fde_end_addr;
+      /* ANDROID support update. */
+      /* dwarf_search_unwind_table() sets it for .debug_frame.  */
+      dci.debug_frame_file = NULL;
+      /* End of ANDROID update. */
 
       memcpy (pi->unwind_info, &dci, sizeof (dci));
     }
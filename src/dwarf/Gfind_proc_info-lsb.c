@@ -34,11 +34,9 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
 #include "dwarf-eh.h"
 #include "libunwind_i.h"
 
-struct table_entry
-  {
-    int32_t start_ip_offset;
-    int32_t fde_offset;
-  };
+/* ANDROID support update. */
+/* struct table_entry moved to dwarf.h. */
+/* End of ANDROID update. */
 
 #ifndef UNW_REMOTE_ONLY
 
@@ -56,6 +54,9 @@ linear_search (unw_addr_space_t as, unw_word_t ip,
   unw_word_t i = 0, fde_addr, addr = eh_frame_start;
   int ret;
 
+  /* ANDROID support update. */
+  UNWI_STAT_INC (UNWI_STAT_FDE_LINEAR_SEARCHES);
+  /* End of ANDROID update. */
   while (i++ < fde_count && addr < eh_frame_end)
     {
       fde_addr = addr;
@@ -81,21 +82,30 @@ linear_search (unw_addr_space_t as, unw_word_t ip,
 #endif /* !UNW_REMOTE_ONLY */
 
 #ifdef CONFIG_DEBUG_FRAME
-/* Load .debug_frame section from FILE.  Allocates and returns space
-   in *BUF, and sets *BUFSIZE to its size.  IS_LOCAL is 1 if using the
+/* Load .debug_frame section from FILE into DFF.  DFF->debug_frame points
+   into a read-only mapping of the section, recorded in DFF->map, and
+   DFF->debug_frame_size is its size.  If the section comes from the
+   decompressed .gnu_debugdata, DFF->debug_frame is a malloc'ed copy
+   instead, counted against the mini debug info budget of the file
+   that DFF->mini_debug_info refers to, and the image itself may be
+   evicted.  IS_LOCAL is 1 if using the
    local process, in which case we can search the system debug file
    directory; 0 for other address spaces, in which case we do not; or
    -1 for recursive calls following .gnu_debuglink.  Returns 0 on
    success, 1 on error.  Succeeds even if the file contains no
    .debug_frame.  */
-/* XXX: Could use mmap; but elf_map_image keeps tons mapped in.  */
 
 static int
-load_debug_frame (const char *file, char **buf, size_t *bufsize,
-                  int is_local, Elf_W(Addr)* segbase_bias)
+load_debug_frame (const char *file, struct unw_debug_frame_file *dff,
+                  int is_local)
 {
-  FILE *f;
-  Elf_W (Ehdr) ehdr;
+  /* ANDROID support update. */
+  int fd;
+  struct stat st;
+  char *image;
+  size_t image_size;
+  Elf_W (Ehdr) *ehdr;
+  /* End of ANDROID update. */
   Elf_W (Half) shstrndx;
   Elf_W (Shdr) *sec_hdrs = NULL;
   char *stringtab = NULL;
@@ -103,150 +113,181 @@ load_debug_frame (const char *file, char **buf, size_t *bufsize,
   size_t linksize = 0;
   char *linkbuf = NULL;
 
-  *buf = NULL;
-  *bufsize = 0;
-
-  f = fopen (file, "r");
+  /* ANDROID support update. */
+  /* Only the headers are read from a mapping of the whole file, which is
+     dropped again; .debug_frame gets a mapping of its own.  */
+  fd = open (file, O_RDONLY);
 
-  if (!f)
+  if (fd < 0)
     return 1;
 
-  if (fread (&ehdr, sizeof (Elf_W (Ehdr)), 1, f) != 1)
-    goto file_error;
+  if (fstat (fd, &st) < 0 || (size_t) st.st_size < sizeof (Elf_W (Ehdr)))
+    {
+      close (fd);
+      return 1;
+    }
+  image_size = st.st_size;
+  image = mmap (NULL, image_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (image == MAP_FAILED)
+    {
+      close (fd);
+      return 1;
+    }
+  ehdr = (Elf_W (Ehdr) *) image;
 
   /* Verify this is actually an elf file. */
-  if (memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0)
+  if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0
+      || ehdr->e_ident[EI_CLASS] != ELF_CLASS)
     goto file_error;
 
-  shstrndx = ehdr.e_shstrndx;
+  shstrndx = ehdr->e_shstrndx;
 
   Debug (4, "opened file '%s'. Section header at offset %d\n",
-         file, (int) ehdr.e_shoff);
+         file, (int) ehdr->e_shoff);
 
-  fseek (f, ehdr.e_shoff, SEEK_SET);
-  sec_hdrs = calloc (ehdr.e_shnum, sizeof (Elf_W (Shdr)));
-  if (sec_hdrs == NULL || fread (sec_hdrs, sizeof (Elf_W (Shdr)), ehdr.e_shnum, f) != ehdr.e_shnum
-      || shstrndx >= ehdr.e_shnum)
+  if (ehdr->e_shoff > image_size
+      || ehdr->e_shoff % sizeof (Elf_W (Addr)) != 0
+      || ehdr->e_shnum > (image_size - ehdr->e_shoff) / sizeof (Elf_W (Shdr))
+      || shstrndx >= ehdr->e_shnum)
     goto file_error;
+  sec_hdrs = (Elf_W (Shdr) *) (image + ehdr->e_shoff);
 
   Debug (4, "loading string table of size %ld\n",
 	   (long) sec_hdrs[shstrndx].sh_size);
   size_t sec_size = sec_hdrs[shstrndx].sh_size;
-  stringtab = malloc (sec_size);
-  fseek (f, sec_hdrs[shstrndx].sh_offset, SEEK_SET);
-  if (stringtab == NULL || fread (stringtab, 1, sec_size, f) != sec_size)
+  if (sec_hdrs[shstrndx].sh_offset > image_size
+      || sec_size > image_size - sec_hdrs[shstrndx].sh_offset)
     goto file_error;
+  stringtab = image + sec_hdrs[shstrndx].sh_offset;
 
-  for (i = 1; i < ehdr.e_shnum && *buf == NULL; i++)
+  for (i = 1; i < ehdr->e_shnum && dff->debug_frame == NULL; i++)
     {
       size_t sec_position = sec_hdrs[i].sh_name;
       if (sec_position >= sec_size)
         continue;
       char *secname = &stringtab[sec_position];
 
+      if (sec_hdrs[i].sh_offset > image_size
+          || sec_hdrs[i].sh_size > image_size - sec_hdrs[i].sh_offset)
+        continue;
+
       if (sec_position + sizeof(".debug_frame") <= sec_size
           && strcmp (secname, ".debug_frame") == 0)
         {
-	  *bufsize = sec_hdrs[i].sh_size;
-	  *buf = malloc (*bufsize);
-	  fseek (f, sec_hdrs[i].sh_offset, SEEK_SET);
-	  if (*buf == NULL || fread (*buf, 1, *bufsize, f) != *bufsize)
-	    goto file_error;
+          size_t page_size = getpagesize ();
+          size_t map_offset = sec_hdrs[i].sh_offset & ~(page_size - 1);
+
+          if (sec_hdrs[i].sh_size == 0)
+            continue;
+          dff->map_size = sec_hdrs[i].sh_offset - map_offset + sec_hdrs[i].sh_size;
+          dff->map = mmap (NULL, dff->map_size, PROT_READ, MAP_PRIVATE, fd,
+                           map_offset);
+          if (dff->map == MAP_FAILED)
+            {
+              dff->map = NULL;
+              goto file_error;
+            }
+          dff->debug_frame = (char *) dff->map + (sec_hdrs[i].sh_offset - map_offset);
+          dff->debug_frame_size = sec_hdrs[i].sh_size;
 
-	  Debug (4, "read %zd bytes of .debug_frame from offset %ld\n",
-		 *bufsize, (long) sec_hdrs[i].sh_offset);
+	  Debug (4, "mapped %zd bytes of .debug_frame from offset %ld\n",
+		 dff->debug_frame_size, (long) sec_hdrs[i].sh_offset);
 	}
       else if (sec_position + sizeof(".gnu_debuglink") <= sec_size
           && strcmp (secname, ".gnu_debuglink") == 0)
 	{
 	  linksize = sec_hdrs[i].sh_size;
 	  linkbuf = malloc (linksize);
-	  fseek (f, sec_hdrs[i].sh_offset, SEEK_SET);
-	  if (linkbuf == NULL || fread (linkbuf, 1, linksize, f) != linksize)
+	  if (linkbuf == NULL)
 	    goto file_error;
+	  memcpy (linkbuf, image + sec_hdrs[i].sh_offset, linksize);
 
 	  Debug (4, "read %zd bytes of .gnu_debuglink from offset %ld\n",
 		 linksize, (long) sec_hdrs[i].sh_offset);
 	}
     /* ANDROID support update. */
-      // Do not process the compressed section for local unwinds.
+      // Do not process the compressed section for local unwinds, unless
+      // the application has set a budget for it.
       // Uncompressing this section can consume a large amount of memory
       // and cause the unwind to take longer, which can cause problems
       // when an ANR occurs in the system. Compressed sections are
       // only used to contain java stack trace information. Since ART is
       // one of the only ways that a local trace is done, and it already
       // dumps the java stack, this information is redundant.
-      else if (local_map_list == NULL
+      else if ((local_map_list == NULL || elf_w (local_mini_debug_info) ())
           && sec_position + sizeof(".gnu_debugdata") <= sec_size
           && strcmp (secname, ".gnu_debugdata") == 0)
         {
-          size_t xz_size = sec_hdrs[i].sh_size;
-          uint8_t* xz_data = malloc (xz_size);
+          void *handle;
+          char *copy;
+          uint8_t* found_section;
+          size_t found_size;
+          Elf_W(Addr) old_text_vaddr, new_text_vaddr;
           struct elf_image mdi;
-          if (xz_data == NULL)
-            goto file_error;
-          fseek (f, sec_hdrs[i].sh_offset, SEEK_SET);
-          if (fread (xz_data, 1, xz_size, f) != xz_size) {
-            free(xz_data);
-            goto file_error;
+          /* The decompressed image is shared with the symbol lookup of
+             any map of this file.  .debug_frame is copied out of it and
+             charged to the budget, so that the image can be evicted.  */
+          if (!elf_w (get_mini_debug_info) (file, &handle)) {
+            continue;
           }
-          Debug (4, "read %zd bytes of .gnu_debugdata from offset %ld\n",
-                 xz_size, (long) sec_hdrs[i].sh_offset);
-          if (elf_w (xz_decompress) (xz_data, xz_size,
-                                     (uint8_t**)&mdi.u.mapped.image, &mdi.u.mapped.size)) {
-            uint8_t* found_section;
-            Elf_W(Addr) old_text_vaddr, new_text_vaddr;
-            mdi.valid = elf_w (valid_object_mapped) (&mdi);
-            mdi.mapped = true;
-            Debug (4, "decompressed .gnu_debugdata\n");
-            if (elf_w (find_section_mapped) (&mdi, ".debug_frame", &found_section, bufsize, NULL)) {
-              Debug (4, "found .debug_frame in .gnu_debugdata\n");
-              *buf = malloc (*bufsize);
-              if (*buf == NULL) {
-                free(xz_data);
-                free(mdi.u.mapped.image);
-                goto file_error;
-              }
-              memcpy(*buf, found_section, *bufsize);
-              // The ELF file might have been relocated since .gnu_debugdata was created.
-              if (elf_w (find_section_mapped) (&mdi, ".text", NULL, NULL, &old_text_vaddr)) {
-                int j;
-                for (j = 1; j < ehdr.e_shnum; j++) {
-                  if (sec_hdrs[j].sh_name + sizeof(".text") <= sec_size
-                      && strcmp(&stringtab[sec_hdrs[j].sh_name], ".text") == 0) {
-                    new_text_vaddr = sec_hdrs[j].sh_addr;
-                    *segbase_bias = new_text_vaddr - old_text_vaddr;
-                    Debug (4, "ELF file was relocated by 0x%llx bytes since it was created.\n",
-                           (unsigned long long)*segbase_bias);
-                    break;
-                  }
-                }
+          if (!elf_w (load_mini_debug_info) (handle, NULL, &mdi.u.mapped.image,
+                                             &mdi.u.mapped.size)) {
+            Debug (1, "failed to decompress .gnu_debugdata\n");
+            elf_w (put_mini_debug_info) (handle);
+            continue;
+          }
+          mdi.valid = elf_w (valid_object_mapped) (&mdi);
+          mdi.mapped = true;
+          if (!elf_w (find_section_mapped) (&mdi, ".debug_frame", &found_section, &found_size, NULL)) {
+            Debug (1, "can not find .debug_frame inside .gnu_debugdata\n");
+            elf_w (unload_mini_debug_info) (handle);
+            elf_w (put_mini_debug_info) (handle);
+            continue;
+          }
+          Debug (4, "found .debug_frame in .gnu_debugdata\n");
+          if ((copy = malloc (found_size)) == NULL) {
+            elf_w (unload_mini_debug_info) (handle);
+            elf_w (put_mini_debug_info) (handle);
+            continue;
+          }
+          memcpy (copy, found_section, found_size);
+          dff->debug_frame = copy;
+          dff->debug_frame_size = found_size;
+          dff->mini_debug_info = handle;
+          // The ELF file might have been relocated since .gnu_debugdata was created.
+          if (elf_w (find_section_mapped) (&mdi, ".text", NULL, NULL, &old_text_vaddr)) {
+            int j;
+            for (j = 1; j < ehdr->e_shnum; j++) {
+              if (sec_hdrs[j].sh_name + sizeof(".text") <= sec_size
+                  && strcmp(&stringtab[sec_hdrs[j].sh_name], ".text") == 0) {
+                new_text_vaddr = sec_hdrs[j].sh_addr;
+                dff->segbase_bias = new_text_vaddr - old_text_vaddr;
+                Debug (4, "ELF file was relocated by 0x%llx bytes since it was created.\n",
+                       (unsigned long long)dff->segbase_bias);
+                break;
               }
-            } else {
-              Debug (1, "can not find .debug_frame inside .gnu_debugdata\n");
             }
-            free(mdi.u.mapped.image);
-          } else {
-            Debug (1, "failed to decompress .gnu_debugdata\n");
           }
-          free(xz_data);
+          elf_w (charge_mini_debug_info) (handle, found_size);
+          elf_w (unload_mini_debug_info) (handle);
         }
   /* End of ANDROID update. */
     }
 
-  free (stringtab);
-  free (sec_hdrs);
-
-  fclose (f);
+  /* ANDROID support update. */
+  munmap (image, image_size);
+  close (fd);
+  /* End of ANDROID update. */
 
   /* Ignore separate debug files which contain a .gnu_debuglink section. */
   if (linkbuf && is_local == -1)
     {
-      free (linkbuf);
-      return 1;
+      /* ANDROID support update. */
+      goto load_debug_frame_error;
+      /* End of ANDROID update. */
     }
 
-  if (*buf == NULL && linkbuf != NULL && memchr (linkbuf, 0, linksize) != NULL)
+  if (dff->debug_frame == NULL && linkbuf != NULL && memchr (linkbuf, 0, linksize) != NULL)
     {
       char *newname, *basedir, *p;
       static const char *debugdir = "/usr/lib/debug";
@@ -275,14 +316,14 @@ load_debug_frame (const char *file, char **buf, size_t *bufsize,
       strcpy (newname, basedir);
       strcat (newname, "/");
       strcat (newname, linkbuf);
-      ret = load_debug_frame (newname, buf, bufsize, -1, segbase_bias);
+      ret = load_debug_frame (newname, dff, -1);
 
       if (ret == 1)
 	{
 	  strcpy (newname, basedir);
 	  strcat (newname, "/.debug/");
 	  strcat (newname, linkbuf);
-	  ret = load_debug_frame (newname, buf, bufsize, -1, segbase_bias);
+	  ret = load_debug_frame (newname, dff, -1);
 	}
 
       if (ret == 1 && is_local == 1)
@@ -291,7 +332,7 @@ load_debug_frame (const char *file, char **buf, size_t *bufsize,
 	  strcat (newname, basedir);
 	  strcat (newname, "/");
 	  strcat (newname, linkbuf);
-	  ret = load_debug_frame (newname, buf, bufsize, -1, segbase_bias);
+	  ret = load_debug_frame (newname, dff, -1);
 	}
 
       free (basedir);
@@ -303,12 +344,29 @@ load_debug_frame (const char *file, char **buf, size_t *bufsize,
 
 /* An error reading image file. Release resources and return error code */
 file_error:
-  free (stringtab);
-  free (sec_hdrs);
-  fclose (f);
+  /* ANDROID support update. */
+  munmap (image, image_size);
+  close (fd);
+  /* End of ANDROID update. */
 load_debug_frame_error:
   free (linkbuf);
-  free (*buf);
+  /* ANDROID support update. */
+  if (dff->mini_debug_info)
+    {
+      elf_w (charge_mini_debug_info) (dff->mini_debug_info,
+				      -(long) dff->debug_frame_size);
+      elf_w (put_mini_debug_info) (dff->mini_debug_info);
+      free (dff->debug_frame);
+    }
+  if (dff->map)
+    munmap (dff->map, dff->map_size);
+  dff->debug_frame = NULL;
+  dff->debug_frame_size = 0;
+  dff->segbase_bias = 0;
+  dff->map = NULL;
+  dff->map_size = 0;
+  dff->mini_debug_info = NULL;
+  /* End of ANDROID update. */
 
   return 1;
 }
@@ -321,30 +379,367 @@ load_debug_frame_error:
 /* Removed the find_binary_for_address function. */
 /* End of ANDROID update. */
 
+/* ANDROID support update. */
+/* The index of a .debug_frame section is built by scanning the section
+   in place twice: once to count the FDEs, so that the table is
+   allocated once, and once to fill it in.  Compilers emit .debug_frame
+   CIEs without augmentation, whose FDEs start with an address-sized
+   initial location; those are decoded directly.  Any other FDE goes
+   through dwarf_extract_proc_info_from_fde().  */
+
+static inline uint32_t
+debug_frame_read_u32 (const char *p)
+{
+  uint32_t val;
+
+  memcpy (&val, p, sizeof (val));
+  return val;
+}
+
+static inline uint64_t
+debug_frame_read_u64 (const char *p)
+{
+  uint64_t val;
+
+  memcpy (&val, p, sizeof (val));
+  return val;
+}
+
+/* Decode the header of the CIE or FDE at P.  Sets *IS_CIE, the CIE
+   pointer of an FDE in *CIE_OFFSET, and the start of what follows the
+   CIE id or pointer in *BODY.  Returns the end of the entry, or NULL at
+   the end of the section or if the entry does not fit in it.  */
+
+static const char *
+debug_frame_next (const char *p, const char *end, int *is_cie,
+		  uint64_t *cie_offset, const char **body)
+{
+  uint64_t len;
+
+  if (end - p < 4)
+    return NULL;
+  len = debug_frame_read_u32 (p);
+  p += 4;
+  if (len == 0)
+    return NULL;
+  if (len != 0xffffffff)
+    {
+      if (len < 4 || len > (uint64_t) (end - p))
+	return NULL;
+      *cie_offset = debug_frame_read_u32 (p);
+      *is_cie = *cie_offset == 0xffffffff;
+      *body = p + 4;
+    }
+  else
+    {
+      /* Extended length.  */
+      if (end - p < 8)
+	return NULL;
+      len = debug_frame_read_u64 (p);
+      p += 8;
+      if (len < 8 || len > (uint64_t) (end - p))
+	return NULL;
+      *cie_offset = debug_frame_read_u64 (p);
+      *is_cie = *cie_offset == 0xffffffffffffffffull;
+      *body = p + 8;
+    }
+  return p + len;
+}
+
+/* Return 1 if the CIE at OFFSET in BUF is one that parse_cie() accepts
+   and that has no augmentation.  */
+
+static int
+debug_frame_plain_cie (const char *buf, const char *end, uint64_t offset)
+{
+  const char *body, *next;
+  uint64_t cie_offset;
+  int is_cie;
+
+  if (offset >= (uint64_t) (end - buf))
+    return 0;
+  next = debug_frame_next (buf + offset, end, &is_cie, &cie_offset, &body);
+  if (!next || !is_cie || next - body < 2)
+    return 0;
+  if (body[0] != 1 && body[0] != 3 && body[0] != 4)
+    return 0;
+  if (body[1] != '\0')
+    return 0;
+  if (body[0] == 4
+      && (next - body < 4 || body[2] != sizeof (unw_word_t) || body[3] != 0))
+    return 0;
+  return 1;
+}
+
+static int
+debug_frame_tab_compare (const void *a, const void *b)
+{
+  const struct table_entry *fa = a, *fb = b;
+
+  if (fa->start_ip_offset > fb->start_ip_offset)
+    return 1;
+  else if (fa->start_ip_offset < fb->start_ip_offset)
+    return -1;
+  else
+    return 0;
+}
+
+/* Sort TAB by start_ip_offset with an LSD radix sort, one byte at a
+   time, skipping the bytes that all entries share.  */
+
+static void
+debug_frame_tab_sort (struct table_entry *tab, size_t length)
+{
+# define KEY(e)	((uint32_t) (e).start_ip_offset ^ 0x80000000)
+  struct table_entry *from = tab, *to, *tmp;
+  size_t counts[256], sum, n, i;
+  unsigned int shift;
+
+  tmp = malloc (length * sizeof (*tmp));
+  if (!tmp)
+    {
+      qsort (tab, length, sizeof (*tab), debug_frame_tab_compare);
+      return;
+    }
+  to = tmp;
+
+  for (shift = 0; shift < 32; shift += 8)
+    {
+      memset (counts, 0, sizeof (counts));
+      for (i = 0; i < length; ++i)
+	counts[(KEY (from[i]) >> shift) & 0xff]++;
+      if (counts[(KEY (from[0]) >> shift) & 0xff] == length)
+	continue;
+      for (i = 0, sum = 0; i < 256; ++i)
+	{
+	  n = counts[i];
+	  counts[i] = sum;
+	  sum += n;
+	}
+      for (i = 0; i < length; ++i)
+	to[counts[(KEY (from[i]) >> shift) & 0xff]++] = from[i];
+      to = from;
+      from = to == tab ? tmp : tab;
+    }
+
+  if (from != tab)
+    memcpy (tab, from, length * sizeof (*tab));
+  free (tmp);
+# undef KEY
+}
+
+/* Find all FDE entries in the .debug_frame of FILE, and make them into a
+   sorted index.  */
+
+static void
+build_debug_frame_index (struct unw_debug_frame_file *file)
+{
+  const char *buf = file->debug_frame;
+  const char *end = buf + file->debug_frame_size;
+  const char *p, *next, *body;
+  unw_accessors_t *a = unw_get_accessors (unw_local_addr_space);
+  const size_t addr_size = dwarf_addr_size (unw_local_addr_space);
+  uint64_t cie_offset, last_cie_offset = (uint64_t) -1;
+  size_t count = 0, length = 0;
+  struct table_entry *tab;
+  unw_word_t start_ip;
+  int is_cie, plain_cie = 0, sorted = 1;
+
+  for (p = buf; (next = debug_frame_next (p, end, &is_cie, &cie_offset,
+					  &body)); p = next)
+    if (!is_cie)
+      ++count;
+  if (count == 0)
+    return;
+
+  tab = malloc (count * sizeof (*tab));
+  if (!tab)
+    return;
+
+  for (p = buf; (next = debug_frame_next (p, end, &is_cie, &cie_offset,
+					  &body)); p = next)
+    {
+      if (is_cie)
+	continue;
+
+      /* The FDEs of a CIE usually follow it.  */
+      if (cie_offset != last_cie_offset)
+	{
+	  plain_cie = debug_frame_plain_cie (buf, end, cie_offset);
+	  last_cie_offset = cie_offset;
+	}
+
+      if (plain_cie && (size_t) (next - body) >= addr_size)
+	start_ip = (addr_size == 4 ? debug_frame_read_u32 (body)
+		    : debug_frame_read_u64 (body));
+      else
+	{
+	  unw_word_t fde_addr = (uintptr_t) p;
+	  unw_proc_info_t this_pi;
+
+	  memset (&this_pi, 0, sizeof (this_pi));
+	  if (dwarf_extract_proc_info_from_fde (unw_local_addr_space, a,
+						&fde_addr, &this_pi, 0,
+						(uintptr_t) buf, NULL) < 0)
+	    continue;
+	  start_ip = this_pi.start_ip;
+	}
+
+      Debug (15, "FDE at offset %lx: start_ip = %lx\n",
+	     (long) (p - buf), (long) start_ip);
+      tab[length].fde_offset = p - buf;
+      tab[length].start_ip_offset = start_ip;
+      if (length > 0
+	  && tab[length].start_ip_offset < tab[length - 1].start_ip_offset)
+	sorted = 0;
+      ++length;
+    }
+
+  /* Linkers usually lay out .debug_frame in address order.  */
+  if (!sorted)
+    debug_frame_tab_sort (tab, length);
+  file->index = tab;
+  file->index_size = length;
+  if (file->mini_debug_info)
+    elf_w (charge_mini_debug_info) (file->mini_debug_info,
+	length * sizeof (struct table_entry));
+}
+/* End of ANDROID update. */
+
+/* ANDROID support update. */
+/* Return the index of the first descriptor in INDEX that ends above
+   ADDR.  */
+
+static unsigned int
+debug_frame_index_search (struct unw_debug_frame_index *index,
+			  unw_word_t addr)
+{
+  unsigned int lo = 0, hi = index->num_ranges, mid;
+
+  while (lo < hi)
+    {
+      mid = (lo + hi) / 2;
+      if (index->ranges[mid]->end <= addr)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  return lo;
+}
+
+/* Add FDESC to INDEX.  Descriptors it overlaps describe an object that
+   was unmapped since and are dropped from the index (the list still
+   owns them).  Failure to grow the index is not an error; FDESC is then
+   simply loaded again the next time it is needed.  */
+
+static void
+debug_frame_index_insert (struct unw_debug_frame_index *index,
+			  struct unw_debug_frame_list *fdesc)
+{
+  struct unw_debug_frame_list **ranges;
+  unsigned int i, j, max;
+
+  i = debug_frame_index_search (index, fdesc->start);
+  for (j = i; j < index->num_ranges && index->ranges[j]->start < fdesc->end;
+       ++j)
+    ;
+  if (j > i)
+    {
+      memmove (index->ranges + i, index->ranges + j,
+	       (index->num_ranges - j) * sizeof (*ranges));
+      index->num_ranges -= j - i;
+    }
+
+  if (index->num_ranges == index->max_ranges)
+    {
+      max = index->max_ranges ? 2 * index->max_ranges : 16;
+      ranges = realloc (index->ranges, max * sizeof (*ranges));
+      if (!ranges)
+	return;
+      index->ranges = ranges;
+      index->max_ranges = max;
+    }
+
+  memmove (index->ranges + i + 1, index->ranges + i,
+	   (index->num_ranges - i) * sizeof (*ranges));
+  index->ranges[i] = fdesc;
+  ++index->num_ranges;
+}
+/* End of ANDROID update. */
+
+/* ANDROID support update. */
+/* Return the descriptor of INDEX that covers ADDR, or NULL.  */
+
+static struct unw_debug_frame_list *
+debug_frame_index_find (struct unw_debug_frame_index *index, unw_word_t addr)
+{
+  unsigned int i;
+
+  i = debug_frame_index_search (index, addr);
+  if (i < index->num_ranges && index->ranges[i]->start <= addr)
+    return index->ranges[i];
+  return NULL;
+}
+
+/* Return a reference to the section of FDESC, a descriptor of the
+   regions of AS, or NULL if FDESC was dropped by a flush since.  */
+
+static struct unw_debug_frame_file *
+hold_debug_frame_file (unw_addr_space_t as, struct unw_debug_frame_list *fdesc,
+		       unw_word_t start, unw_word_t end)
+{
+  struct unw_debug_frame_list *w;
+  struct unw_debug_frame_file *file = NULL;
+  intrmask_t saved_mask;
+
+  lock_acquire (&dwarf_debug_frame_lock, saved_mask);
+  w = debug_frame_index_find (&as->debug_frame_index, start);
+  if (w == fdesc && w->start == start && w->end == end)
+    {
+      file = w->file;
+      dwarf_hold_debug_frame_file (file);
+    }
+  lock_release (&dwarf_debug_frame_lock, saved_mask);
+  return file;
+}
+/* End of ANDROID update. */
+
 /* Locate and/or try to load a debug_frame section for address ADDR.  Return
    pointer to debug frame descriptor, or zero if not found.  */
 
+/* ANDROID support update. */
+/* A flush may free the descriptor as soon as dwarf_debug_frame_lock is
+   released, so the caller may only compare it with other descriptors
+   (see hold_debug_frame_file).  Its bounds and the bias of its section
+   are returned in *STARTP, *ENDP and *BIASP instead.  A descriptor whose
+   section is empty is not returned.  The lock is not held while a
+   section is loaded, so other threads keep searching meanwhile.  */
+/* End of ANDROID update. */
+
 static struct unw_debug_frame_list *
 locate_debug_info (unw_addr_space_t as, unw_word_t addr, const char *dlname,
-		   unw_word_t start, unw_word_t end)
+		   unw_word_t start, unw_word_t end, unw_word_t *startp,
+		   unw_word_t *endp, unw_word_t *biasp)
 {
   struct unw_debug_frame_list *w, *fdesc = 0;
-  int err;
-  char *buf;
-  size_t bufsize;
   /* ANDROID support update. */
+  struct unw_debug_frame_index *index = &as->debug_frame_index;
+  struct unw_debug_frame_file *file;
+  struct stat st;
   char *name = NULL;
-  Elf_W(Addr) segbase_bias = 0;
-  /* End of ANDROID update. */
+  intrmask_t saved_mask;
+  size_t size;
 
   /* First, see if we loaded this frame already.  */
 
-  for (w = as->debug_frames; w; w = w->next)
+  lock_acquire (&dwarf_debug_frame_lock, saved_mask);
+  if ((w = debug_frame_index_find (index, addr)) != NULL)
     {
-      Debug (4, "checking %p: %lx-%lx\n", w, (long)w->start, (long)w->end);
-      if (addr >= w->start && addr < w->end)
-	return w;
+      Debug (4, "found %p: %lx-%lx\n", w, (long)w->start, (long)w->end);
+      goto found;
     }
+  lock_release (&dwarf_debug_frame_lock, saved_mask);
+  /* End of ANDROID update. */
 
   /* ANDROID support update. */
   /* If the object name we receive is blank, there's still a chance of locating
@@ -360,7 +755,6 @@ locate_debug_info (unw_addr_space_t as, unw_word_t addr, const char *dlname,
         name = strdup (map->path);
 #endif
       if (!name)
-  /* End of ANDROID update. */
         {
 	  Debug (15, "tried to locate binary for 0x%" PRIx64 ", but no luck\n",
 		 (uint64_t) addr);
@@ -370,77 +764,83 @@ locate_debug_info (unw_addr_space_t as, unw_word_t addr, const char *dlname,
   else
     name = (char*) dlname;
 
-  err = load_debug_frame (name, &buf, &bufsize, as == unw_local_addr_space, &segbase_bias);
+  /* Another region, possibly of another address space, may have loaded
+     the same file already.  */
+  if (stat (name, &st) < 0)
+    file = NULL;
+  else if ((file = dwarf_get_debug_frame_file (st.st_dev, st.st_ino,
+					       st.st_size, st.st_mtime)) == NULL
+	   && (file = calloc (1, sizeof (*file))) != NULL)
+    {
+      if (load_debug_frame (name, file, as == unw_local_addr_space))
+	{
+	  free (file);
+	  file = NULL;
+	}
+      else
+	{
+	  file->dev = st.st_dev;
+	  file->ino = st.st_ino;
+	  file->file_size = st.st_size;
+	  file->file_mtime = st.st_mtime;
+	  file->refs = 1;
+	  if (file->debug_frame_size != 0)
+	    build_debug_frame_index (file);
+	  file = dwarf_add_debug_frame_file (file);
+	}
+    }
 
-  if (!err)
+  if (file)
     {
       fdesc = malloc (sizeof (struct unw_debug_frame_list));
-
-      fdesc->start = start;
-      fdesc->end = end;
-      fdesc->debug_frame = buf;
-      fdesc->debug_frame_size = bufsize;
-      fdesc->segbase_bias = segbase_bias;
-      fdesc->index = NULL;
-      fdesc->next = as->debug_frames;
-
-      as->debug_frames = fdesc;
+      if (fdesc == NULL)
+	dwarf_put_debug_frame_file (file);
+      else
+	{
+	  fdesc->start = start;
+	  fdesc->end = end;
+	  fdesc->file = file;
+	}
     }
 
-  /* ANDROID support update. */
   if (name != dlname)
     free(name);
-  /* End of ANDROID update. */
-
-  return fdesc;
-}
 
-struct debug_frame_tab
-  {
-    struct table_entry *tab;
-    uint32_t length;
-    uint32_t size;
-  };
-
-static void
-debug_frame_tab_append (struct debug_frame_tab *tab,
-			unw_word_t fde_offset, unw_word_t start_ip)
-{
-  unsigned int length = tab->length;
+  if (!fdesc)
+    return 0;
 
-  if (length == tab->size)
+  /* Another thread may have added the region while this one loaded it.  */
+  lock_acquire (&dwarf_debug_frame_lock, saved_mask);
+  if ((w = debug_frame_index_find (index, addr)) == NULL)
     {
-      tab->size *= 2;
-      tab->tab = realloc (tab->tab, sizeof (struct table_entry) * tab->size);
+      fdesc->next = as->debug_frames;
+      as->debug_frames = fdesc;
+      debug_frame_index_insert (index, fdesc);
+      w = fdesc;
+      fdesc = NULL;
     }
 
-  tab->tab[length].fde_offset = fde_offset;
-  tab->tab[length].start_ip_offset = start_ip;
+ found:
+  *startp = w->start;
+  *endp = w->end;
+  *biasp = w->file->segbase_bias;
+  size = w->file->debug_frame_size;
+  lock_release (&dwarf_debug_frame_lock, saved_mask);
 
-  tab->length = length + 1;
-}
-
-static void
-debug_frame_tab_shrink (struct debug_frame_tab *tab)
-{
-  if (tab->size > tab->length)
+  if (fdesc)
     {
-      tab->tab = realloc (tab->tab, sizeof (struct table_entry) * tab->length);
-      tab->size = tab->length;
+      dwarf_put_debug_frame_file (fdesc->file);
+      free (fdesc);
     }
-}
 
-static int
-debug_frame_tab_compare (const void *a, const void *b)
-{
-  const struct table_entry *fa = a, *fb = b;
+  if (size == 0)
+    {
+      Debug (15, "zero-length .debug_frame\n");
+      return 0;
+    }
+  /* End of ANDROID update. */
 
-  if (fa->start_ip_offset > fb->start_ip_offset)
-    return 1;
-  else if (fa->start_ip_offset < fb->start_ip_offset)
-    return -1;
-  else
-    return 0;
+  return w;
 }
 
 PROTECTED int
@@ -450,13 +850,17 @@ dwarf_find_debug_frame (int found, unw_dyn_info_t *di_debug, unw_word_t ip,
 {
   unw_dyn_info_t *di;
   struct unw_debug_frame_list *fdesc = 0;
-  unw_accessors_t *a;
-  unw_word_t addr;
+  /* ANDROID support update. */
+  unw_word_t bias;
+  /* End of ANDROID update. */
 
   Debug (15, "Trying to find .debug_frame for %s\n", obj_name);
   di = di_debug;
 
-  fdesc = locate_debug_info (unw_local_addr_space, ip, obj_name, start, end);
+  /* ANDROID support update. */
+  fdesc = locate_debug_info (unw_local_addr_space, ip, obj_name, start, end,
+			     &start, &end, &bias);
+  /* End of ANDROID update. */
 
   if (!fdesc)
     {
@@ -465,120 +869,23 @@ dwarf_find_debug_frame (int found, unw_dyn_info_t *di_debug, unw_word_t ip,
     }
   else
     {
-      char *buf;
-      size_t bufsize;
-      unw_word_t item_start, item_end = 0;
-      uint32_t u32val = 0;
-      uint64_t cie_id = 0;
-      struct debug_frame_tab tab;
-
       Debug (15, "loaded .debug_frame\n");
 
-      buf = fdesc->debug_frame;
-      bufsize = fdesc->debug_frame_size;
-
-      if (bufsize == 0)
-       {
-         Debug (15, "zero-length .debug_frame\n");
-         return found;
-       }
-
-      /* Now create a binary-search table, if it does not already exist.  */
-      if (!fdesc->index)
-       {
-         addr = (unw_word_t) (uintptr_t) buf;
-
-         a = unw_get_accessors (unw_local_addr_space);
-
-         /* Find all FDE entries in debug_frame, and make into a sorted
-            index.  */
-
-         tab.length = 0;
-         tab.size = 16;
-         tab.tab = calloc (tab.size, sizeof (struct table_entry));
-
-         while (addr < (unw_word_t) (uintptr_t) (buf + bufsize))
-           {
-             uint64_t id_for_cie;
-             item_start = addr;
-
-             dwarf_readu32 (unw_local_addr_space, a, &addr, &u32val, NULL);
-
-             if (u32val == 0)
-               break;
-             else if (u32val != 0xffffffff)
-               {
-                 uint32_t cie_id32 = 0;
-                 item_end = addr + u32val;
-                 dwarf_readu32 (unw_local_addr_space, a, &addr, &cie_id32,
-                                NULL);
-                 cie_id = cie_id32;
-                 id_for_cie = 0xffffffff;
-               }
-             else
-               {
-                 uint64_t u64val = 0;
-                 /* Extended length.  */
-                 dwarf_readu64 (unw_local_addr_space, a, &addr, &u64val, NULL);
-                 item_end = addr + u64val;
-
-                 dwarf_readu64 (unw_local_addr_space, a, &addr, &cie_id, NULL);
-                 id_for_cie = 0xffffffffffffffffull;
-               }
-
-             /*Debug (1, "CIE/FDE id = %.8x\n", (int) cie_id);*/
-
-             if (cie_id == id_for_cie)
-               ;
-             /*Debug (1, "Found CIE at %.8x.\n", item_start);*/
-             else
-               {
-                 unw_word_t fde_addr = item_start;
-                 unw_proc_info_t this_pi;
-                 int err;
-
-                 /*Debug (1, "Found FDE at %.8x\n", item_start);*/
-
-                 err = dwarf_extract_proc_info_from_fde (unw_local_addr_space,
-                                                         a, &fde_addr,
-                                                         &this_pi, 0,
-                                                         (uintptr_t) buf,
-                                                         NULL);
-                 if (err == 0)
-                   {
-                     Debug (15, "start_ip = %lx, end_ip = %lx\n",
-                            (long) this_pi.start_ip, (long) this_pi.end_ip);
-                     debug_frame_tab_append (&tab,
-                                             item_start - (unw_word_t) (uintptr_t) buf,
-                                             this_pi.start_ip);
-                   }
-                 /*else
-                   Debug (1, "FDE parse failed\n");*/
-               }
-
-             addr = item_end;
-           }
-
-         debug_frame_tab_shrink (&tab);
-         qsort (tab.tab, tab.length, sizeof (struct table_entry),
-                debug_frame_tab_compare);
-         /* for (i = 0; i < tab.length; i++)
-            {
-            fprintf (stderr, "ip %x, fde offset %x\n",
-            (int) tab.tab[i].start_ip_offset,
-            (int) tab.tab[i].fde_offset);
-            }*/
-         fdesc->index = tab.tab;
-         fdesc->index_size = tab.length;
-       }
+      /* ANDROID support update. */
+      /* The binary-search table was built when the section was loaded.  */
+      /* End of ANDROID update. */
 
       di->format = UNW_INFO_FORMAT_TABLE;
-      di->start_ip = fdesc->start;
-      di->end_ip = fdesc->end;
+      /* ANDROID support update. */
+      di->start_ip = start;
+      di->end_ip = end;
+      /* End of ANDROID update. */
       di->u.ti.name_ptr = (unw_word_t) (uintptr_t) obj_name;
       di->u.ti.table_data = (unw_word_t *) fdesc;
       di->u.ti.table_len = sizeof (*fdesc) / sizeof (unw_word_t);
-      di->u.ti.segbase = segbase + fdesc->segbase_bias;
+      /* ANDROID support update. */
+      di->u.ti.segbase = segbase + bias;
+      /* End of ANDROID update. */
 
       found = 1;
       Debug (15, "found debug_frame table `%s': segbase=0x%lx, len=%lu, "
@@ -808,6 +1115,9 @@ dwarf_find_proc_info (unw_addr_space_t as, unw_word_t ip,
   cb_data.di.format = -1;
   cb_data.di_debug.format = -1;
 
+  /* ANDROID support update. */
+  UNWI_STAT_INC (UNWI_STAT_DL_ITERATE_PHDR_CALLS);
+  /* End of ANDROID update. */
   SIGPROCMASK (SIG_SETMASK, &unwi_full_mask, &saved_mask);
   ret = dl_iterate_phdr (dwarf_callback, &cb_data);
   SIGPROCMASK (SIG_SETMASK, &saved_mask, NULL);
@@ -841,6 +1151,9 @@ lookup (const struct table_entry *table, size_t table_size, int32_t rel_ip)
   unsigned long table_len = table_size / sizeof (struct table_entry);
   const struct table_entry *e = NULL;
   unsigned long lo, hi, mid;
+  /* ANDROID support update. */
+  unsigned long probes = 0;
+  /* End of ANDROID update. */
 
   /* do a binary search for right entry: */
   for (lo = 0, hi = table_len; lo < hi;)
@@ -848,17 +1161,331 @@ lookup (const struct table_entry *table, size_t table_size, int32_t rel_ip)
       mid = (lo + hi) / 2;
       e = table + mid;
       Debug (15, "e->start_ip_offset = %lx\n", (long) e->start_ip_offset);
+      /* ANDROID support update. */
+      ++probes;
+      /* End of ANDROID update. */
       if (rel_ip < e->start_ip_offset)
 	hi = mid;
       else
 	lo = mid + 1;
     }
+  /* ANDROID support update. */
+  UNWI_STAT_ADD (UNWI_STAT_TABLE_PROBES, probes);
+  /* End of ANDROID update. */
   if (hi <= 0)
 	return NULL;
   e = table + hi - 1;
   return e;
 }
 
+/* ANDROID support update. */
+/* Tables with at least this many entries get a directory the first
+   time they are searched.  Below it, the binary search stays within a
+   few cache lines and the directory would not pay for itself.  */
+#define TABLE_DIRECTORY_MIN_ENTRIES	4096
+#define TABLE_DIRECTORY_SLOTS		32
+/* A directory whose bucket check failed this many times no longer
+   matches its table.  */
+#define TABLE_DIRECTORY_MAX_MISSES	4
+
+/* A directory splits the range covered by a sorted table into buckets
+   of 1 << SHIFT bytes.  FIRST[b] is the index of the first entry that
+   starts at or above BASE + (b << SHIFT), so the entries starting
+   inside bucket b are FIRST[b] .. FIRST[b + 1] - 1.  There are about
+   half as many buckets as entries, so a search usually touches one
+   slot of FIRST and a cache line or two of the table instead of
+   ~log2(n) lines spread over all of it.  The table itself is not
+   copied.  */
+struct table_directory
+  {
+    const struct table_entry *table;
+    unsigned long table_len;
+    int32_t base;
+    unsigned int shift;
+    unsigned long size;
+    size_t mapped_size;
+    unw_word_t generation;	/* as->cache_generation when built */
+#ifdef HAVE_ATOMIC_OPS_H
+    AO_t misses;		/* failed bucket checks */
+#else
+    unsigned int misses;	/* failed bucket checks */
+#endif
+    struct table_directory *next_retired;
+    uint32_t first[0];
+  };
+
+#ifdef HAVE_CMPXCHG
+/* Directories are published with cmpxchg_ptr(), so readers need no
+   lock.  Nothing ties a directory to the lifetime of its table: a
+   module that is unloaded just leaves its slot behind, and
+   lookup_in_directory() checks the neighbours of the bucket it picked
+   so that a directory which no longer matches the memory at TABLE only
+   costs a full binary search.  A directory is stale once the cache of
+   the address space has been flushed since it was built, or once its
+   bucket checks keep failing; its slot is then given to the next table
+   that needs one.  A directory taken out of its slot may still be read
+   by lookups that picked it before: it is only unmapped once no lookup
+   is using any directory.  */
+static struct table_directory *table_directories[TABLE_DIRECTORY_SLOTS];
+static struct table_directory *retired_directories;
+#ifdef HAVE_ATOMIC_OPS_H
+static AO_t table_directory_readers;
+#else
+static unsigned int table_directory_readers;
+#endif
+
+static inline unsigned int
+table_directory_hash (const struct table_entry *table)
+{
+  uintptr_t h = (uintptr_t) table;
+
+  h ^= h >> 17;
+  h *= 0x9e3779b1u;
+  return (unsigned int) (h >> 8) % TABLE_DIRECTORY_SLOTS;
+}
+
+static inline int
+table_directory_is_stale (unw_addr_space_t as, struct table_directory *dir)
+{
+  return dir->generation != atomic_read (&as->cache_generation)
+	 || dir->misses >= TABLE_DIRECTORY_MAX_MISSES;
+}
+
+static void
+retire_table_directories (struct table_directory *first,
+			  struct table_directory *last)
+{
+  struct table_directory *old;
+
+  do
+    {
+      old = retired_directories;
+      last->next_retired = old;
+    }
+  while (!cmpxchg_ptr (&retired_directories, old, first));
+}
+
+/* End a lookup that started with fetch_and_add1
+   (&table_directory_readers).  The last lookup to leave unmaps the
+   retired directories: any lookup that could still read one started
+   before it was retired, and is counted until it ends.  */
+static void
+put_table_directories (void)
+{
+  struct table_directory *dir, *last, *next;
+
+  if (fetch_and_add (&table_directory_readers, -1) != 1
+      || !atomic_read (&retired_directories))
+    return;
+
+  do
+    dir = retired_directories;
+  while (dir && !cmpxchg_ptr (&retired_directories, dir, NULL));
+  if (!dir)
+    return;
+
+  /* Another lookup may have started meanwhile and be reading one of
+     them; the last lookup to leave after it will try again.  */
+  if (atomic_read (&table_directory_readers) != 0)
+    {
+      for (last = dir; last->next_retired; last = last->next_retired)
+	;
+      retire_table_directories (dir, last);
+      return;
+    }
+
+  for (; dir; dir = next)
+    {
+      next = dir->next_retired;
+      munmap (dir, dir->mapped_size);
+    }
+}
+
+static struct table_directory *
+build_table_directory (unw_addr_space_t as, const struct table_entry *table,
+		       unsigned long table_len)
+{
+  struct table_directory *dir;
+  int64_t span, limit;
+  unsigned long size, b, i;
+  unsigned int shift;
+  size_t mapped_size;
+
+  if (table_len > UINT32_MAX)
+    return NULL;
+
+  span = (int64_t) table[table_len - 1].start_ip_offset
+	 - table[0].start_ip_offset;
+  if (span < 0)
+    return NULL;	/* not sorted */
+  for (shift = 0; (span >> shift) > (int64_t) (table_len / 2); ++shift)
+    ;
+  size = (unsigned long) (span >> shift) + 1;
+
+  mapped_size = sizeof (*dir) + (size + 1) * sizeof (dir->first[0]);
+  mapped_size = (mapped_size + getpagesize () - 1) & ~(getpagesize () - 1);
+  GET_MEMORY (dir, mapped_size);
+  if (!dir)
+    return NULL;
+
+  dir->table = table;
+  dir->table_len = table_len;
+  dir->base = table[0].start_ip_offset;
+  dir->shift = shift;
+  dir->size = size;
+  dir->mapped_size = mapped_size;
+  dir->generation = atomic_read (&as->cache_generation);
+  dir->misses = 0;
+  dir->next_retired = NULL;
+  for (b = 0, i = 0; b < size; ++b)
+    {
+      limit = (int64_t) b << shift;
+      while (i < table_len
+	     && (int64_t) table[i].start_ip_offset - dir->base < limit)
+	++i;
+      dir->first[b] = i;
+    }
+  dir->first[size] = table_len;
+
+  Debug (15, "table %p: %lu entries, %lu buckets of %u bytes\n",
+	 table, table_len, size, 1u << shift);
+  return dir;
+}
+
+/* Return the directory for TABLE, building it if there is none yet, or
+   only a stale one, and there is still room for it.  */
+static struct table_directory *
+get_table_directory (unw_addr_space_t as, const struct table_entry *table,
+		     unsigned long table_len)
+{
+  struct table_directory *dir, *old = NULL, *new_dir, **p, **slotp = NULL;
+  unsigned int i, slot;
+
+  /* Take the stale directory of TABLE, or else the first free slot, or
+     else the first slot with a stale directory.  */
+  slot = table_directory_hash (table);
+  for (i = 0; i < TABLE_DIRECTORY_SLOTS; ++i)
+    {
+      p = &table_directories[(slot + i) % TABLE_DIRECTORY_SLOTS];
+      if (!(dir = *p))
+	{
+	  slotp = p;
+	  old = NULL;
+	  break;
+	}
+      if (dir->table == table && dir->table_len == table_len)
+	{
+	  if (!table_directory_is_stale (as, dir))
+	    return dir;
+	  slotp = p;
+	  old = dir;
+	  break;
+	}
+      if (!slotp && table_directory_is_stale (as, dir))
+	{
+	  slotp = p;
+	  old = dir;
+	}
+    }
+  if (!slotp)
+    return NULL;	/* all slots are taken */
+
+  new_dir = build_table_directory (as, table, table_len);
+  if (!new_dir)
+    return NULL;
+
+  if (!cmpxchg_ptr (slotp, old, new_dir))
+    {
+      /* Somebody else changed the slot first; use the plain binary
+	 search this time.  */
+      munmap (new_dir, new_dir->mapped_size);
+      return NULL;
+    }
+  if (old)
+    retire_table_directories (old, old);
+  return new_dir;
+}
+
+static inline const struct table_entry *
+lookup_in_directory (struct table_directory *dir, int32_t rel_ip)
+{
+  const struct table_entry *table = dir->table;
+  unsigned long table_len = dir->table_len;
+  unsigned long b, lo, hi, mid, probes;
+  int64_t delta = (int64_t) rel_ip - dir->base;
+
+  if (delta < 0)
+    {
+      if (rel_ip < table[0].start_ip_offset)
+	return NULL;
+      return lookup (table, table_len * sizeof (struct table_entry), rel_ip);
+    }
+  b = (unsigned long) (delta >> dir->shift);
+  if (b >= dir->size)
+    {
+      lo = hi = table_len;
+    }
+  else
+    {
+      lo = dir->first[b];
+      hi = dir->first[b + 1];
+    }
+
+  /* The answer is the last entry starting at or below REL_IP; if the
+     entries around the bucket agree, it lies between LO - 1 and
+     HI - 1.  */
+  probes = (lo > 0) + (hi < table_len);
+  if ((lo > 0 && rel_ip < table[lo - 1].start_ip_offset)
+      || (hi < table_len && rel_ip >= table[hi].start_ip_offset))
+    {
+      UNWI_STAT_ADD (UNWI_STAT_TABLE_PROBES, probes);
+      fetch_and_add1 (&dir->misses);
+      return lookup (table, table_len * sizeof (struct table_entry), rel_ip);
+    }
+
+  while (lo < hi)
+    {
+      mid = (lo + hi) / 2;
+      ++probes;
+      if (rel_ip < table[mid].start_ip_offset)
+	hi = mid;
+      else
+	lo = mid + 1;
+    }
+  UNWI_STAT_ADD (UNWI_STAT_TABLE_PROBES, probes);
+  if (hi <= 0)
+    return NULL;
+  return table + hi - 1;
+}
+#endif /* HAVE_CMPXCHG */
+
+/* Like lookup(), but use a directory for large tables of the local
+   address space unless caching is turned off.  */
+static inline const struct table_entry *
+lookup_cached (unw_addr_space_t as, const struct table_entry *table,
+	       size_t table_size, int32_t rel_ip)
+{
+#ifdef HAVE_CMPXCHG
+  unsigned long table_len = table_size / sizeof (struct table_entry);
+  const struct table_entry *e;
+  struct table_directory *dir;
+
+  if (table_len >= TABLE_DIRECTORY_MIN_ENTRIES
+      && as->caching_policy != UNW_CACHE_NONE)
+    {
+      fetch_and_add1 (&table_directory_readers);
+      if ((dir = get_table_directory (as, table, table_len)) != NULL)
+	e = lookup_in_directory (dir, rel_ip);
+      else
+	e = lookup (table, table_size, rel_ip);
+      put_table_directories ();
+      return e;
+    }
+#endif
+  return lookup (table, table_size, rel_ip);
+}
+/* End of ANDROID update. */
+
 #endif /* !UNW_REMOTE_ONLY */
 
 #ifndef UNW_LOCAL_ONLY
@@ -885,6 +1512,9 @@ remote_lookup (unw_addr_space_t as,
       e_addr = table + mid * sizeof (struct table_entry);
       if ((ret = dwarf_reads32 (as, a, &e_addr, &start, arg)) < 0)
 	return ret;
+      /* ANDROID support update. */
+      UNWI_STAT_INC (UNWI_STAT_TABLE_PROBES);
+      /* End of ANDROID update. */
 
       if (rel_ip < start)
 	hi = mid;
@@ -902,6 +1532,117 @@ remote_lookup (unw_addr_space_t as,
 
 #endif /* !UNW_LOCAL_ONLY */
 
+/* ANDROID support update. */
+/* The frames of a stack, and successive samples of the same stack,
+   keep coming back to the same few procedures, but every lookup
+   searched the whole table again.  Remember the range and FDE of the
+   last few table hits per address space and check them before
+   searching.  An entry only matches for the table it was found in, so
+   one module's FDE is never applied to another's table.  Like the
+   other caches of the address space, this one is skipped under
+   UNW_CACHE_NONE and emptied when the cache generation changes.
+
+   The cache is consulted for every table search, including the ones
+   that miss, so it must cost less than the probes it saves: instead of
+   masking signals around a blocking lock, it is simply not used while
+   another thread, or a signal handler that interrupted its owner,
+   holds the lock.  */
+
+static inline struct dwarf_fde_cache *
+get_fde_cache (unw_addr_space_t as)
+{
+  struct dwarf_fde_cache *cache = &as->fde_cache;
+
+  if (as->caching_policy == UNW_CACHE_NONE)
+    return NULL;
+
+  if (mutex_trylock (&cache->lock) != 0)
+    return NULL;
+
+  if (atomic_read (&as->cache_generation) != atomic_read (&cache->generation))
+    {
+      memset (cache->entries, 0, sizeof (cache->entries));
+      cache->next = 0;
+      cache->generation = as->cache_generation;
+    }
+  return cache;
+}
+
+/* Return 1 and the FDE address in *FDE_ADDR if a recent search of TABLE
+   found an FDE that covers IP, 0 otherwise.  */
+static int
+fde_cache_lookup (unw_addr_space_t as, unw_word_t table, unw_word_t segbase,
+		  unw_word_t ip, unw_word_t *fde_addr)
+{
+  struct dwarf_fde_cache *cache;
+  unsigned int i;
+  int found = 0;
+
+  if (!(cache = get_fde_cache (as)))
+    return 0;
+
+  for (i = 0; i < DWARF_FDE_CACHE_SIZE; ++i)
+    if (ip >= cache->entries[i].start_ip && ip < cache->entries[i].end_ip
+	&& cache->entries[i].table == table
+	&& cache->entries[i].segbase == segbase)
+      {
+	*fde_addr = cache->entries[i].fde_addr;
+	found = 1;
+	break;
+      }
+  mutex_unlock (&cache->lock);
+  return found;
+}
+
+/* Remember the FDE at FDE_ADDR that a search of TABLE, started in cache
+   generation GENERATION, found.  */
+static void
+fde_cache_insert (unw_addr_space_t as, unw_word_t table, unw_word_t segbase,
+		  unw_word_t start_ip, unw_word_t end_ip, unw_word_t fde_addr,
+		  uint32_t generation)
+{
+  struct dwarf_fde_cache *cache;
+  unsigned int i;
+
+  if (!(cache = get_fde_cache (as)))
+    return;
+  /* After a flush, TABLE may have been freed and its address reused.  */
+  if (cache->generation != generation)
+    {
+      mutex_unlock (&cache->lock);
+      return;
+    }
+
+  i = cache->next;
+  cache->next = (i + 1) % DWARF_FDE_CACHE_SIZE;
+  cache->entries[i].table = table;
+  cache->entries[i].segbase = segbase;
+  cache->entries[i].start_ip = start_ip;
+  cache->entries[i].end_ip = end_ip;
+  cache->entries[i].fde_addr = fde_addr;
+  mutex_unlock (&cache->lock);
+}
+
+/* Forget the FDE at FDE_ADDR that a search of TABLE found.  */
+static void
+fde_cache_remove (unw_addr_space_t as, unw_word_t table, unw_word_t segbase,
+		  unw_word_t fde_addr)
+{
+  struct dwarf_fde_cache *cache;
+  unsigned int i;
+
+  if (!(cache = get_fde_cache (as)))
+    return;
+
+  for (i = 0; i < DWARF_FDE_CACHE_SIZE; ++i)
+    if (cache->entries[i].fde_addr == fde_addr
+	&& cache->entries[i].table == table
+	&& cache->entries[i].segbase == segbase)
+      memset (&cache->entries[i], 0, sizeof (cache->entries[i]));
+  mutex_unlock (&cache->lock);
+}
+/* End of ANDROID update. */
+
 PROTECTED int
 dwarf_search_unwind_table (unw_addr_space_t as, unw_word_t ip,
 			   unw_dyn_info_t *di, unw_proc_info_t *pi,
@@ -916,6 +1657,12 @@ dwarf_search_unwind_table (unw_addr_space_t as, unw_word_t ip,
   int ret;
   unw_word_t debug_frame_base;
   size_t table_len;
+  /* ANDROID support update. */
+  struct unw_debug_frame_file *file = NULL;
+  unw_word_t fde_start;
+  uint32_t generation;
+  int cached;
+  /* End of ANDROID update. */
 
 #ifdef UNW_REMOTE_ONLY
   assert (di->format == UNW_INFO_FORMAT_REMOTE_TABLE);
@@ -930,6 +1677,9 @@ dwarf_search_unwind_table (unw_addr_space_t as, unw_word_t ip,
       table = (const struct table_entry *) (uintptr_t) di->u.rti.table_data;
       table_len = di->u.rti.table_len * sizeof (unw_word_t);
       debug_frame_base = 0;
+      /* ANDROID support update. */
+      generation = atomic_read (&as->cache_generation);
+      /* End of ANDROID update. */
     }
   else
     {
@@ -941,19 +1691,49 @@ dwarf_search_unwind_table (unw_addr_space_t as, unw_word_t ip,
          the address space to check for properties like the address size and
          endianness is the target one.  */
       as = unw_local_addr_space;
-      table = fdesc->index;
-      table_len = fdesc->index_size * sizeof (struct table_entry);
-      debug_frame_base = (uintptr_t) fdesc->debug_frame;
+      /* ANDROID support update. */
+      /* A flush frees FDESC, possibly before DI was even returned (or DI
+         comes from a cache), so it is only used if AS still has it.  The
+         section stays loaded while this search, and the unwind info it
+         returns, need it.  The generation is read first, so a flush that
+         drops FDESC after that changes it.  */
+      generation = atomic_read (&as->cache_generation);
+#ifdef CONFIG_DEBUG_FRAME
+      file = hold_debug_frame_file (as, fdesc, di->start_ip, di->end_ip);
+#endif
+      if (!file)
+	{
+	  Debug (15, "debug_frame table %p was flushed\n", fdesc);
+	  return -UNW_ENOINFO;
+	}
+      table = file->index;
+      table_len = file->index_size * sizeof (struct table_entry);
+      debug_frame_base = (uintptr_t) file->debug_frame;
+      /* End of ANDROID update. */
 #endif
     }
 
   a = unw_get_accessors (as);
 
+  /* ANDROID support update. */
+  segbase = di->u.rti.segbase;
+  cached = fde_cache_lookup (as, (uintptr_t) table, segbase, ip, &fde_addr);
+  if (cached)
+    {
+      Debug (15, "ip=0x%lx, fde_addr = %lx (cached)\n",
+	     (long) ip, (long) fde_addr);
+      goto have_fde;
+    }
+ search:
+  /* End of ANDROID update. */
+
 #ifndef UNW_REMOTE_ONLY
   if (as == unw_local_addr_space)
     {
       segbase = di->u.rti.segbase;
-      e = lookup (table, table_len, ip - segbase);
+      /* ANDROID support update. */
+      e = lookup_cached (as, table, table_len, ip - segbase);
+      /* End of ANDROID update. */
     }
   else
 #endif
@@ -962,7 +1742,7 @@ dwarf_search_unwind_table (unw_addr_space_t as, unw_word_t ip,
       segbase = di->u.rti.segbase;
       if ((ret = remote_lookup (as, (uintptr_t) table, table_len,
 				ip - segbase, &ent, arg)) < 0)
-	return ret;
+	goto out;
       if (ret)
 	e = &ent;
       else
@@ -975,7 +1755,10 @@ dwarf_search_unwind_table (unw_addr_space_t as, unw_word_t ip,
 	     (long) ip, (long) di->start_ip, (long) di->end_ip);
       /* IP is inside this table's range, but there is no explicit
 	 unwind info.  */
-      return -UNW_ENOINFO;
+      /* ANDROID support update. */
+      ret = -UNW_ENOINFO;
+      goto out;
+      /* End of ANDROID update. */
     }
   Debug (15, "ip=0x%lx, start_ip=0x%lx\n",
 	 (long) ip, (long) (e->start_ip_offset));
@@ -986,10 +1769,20 @@ dwarf_search_unwind_table (unw_addr_space_t as, unw_word_t ip,
   Debug (1, "e->fde_offset = %lx, segbase = %lx, debug_frame_base = %lx, "
 	    "fde_addr = %lx\n", (long) e->fde_offset, (long) segbase,
 	    (long) debug_frame_base, (long) fde_addr);
+  /* ANDROID support update. */
+ have_fde:
+  fde_start = fde_addr;
+  /* End of ANDROID update. */
   if ((ret = dwarf_extract_proc_info_from_fde (as, a, &fde_addr, pi,
 					       need_unwind_info,
 					       debug_frame_base, arg)) < 0)
-    return ret;
+    {
+      /* ANDROID support update. */
+      if (cached)
+	goto stale;
+      goto out;
+      /* End of ANDROID update. */
+    }
 
   /* .debug_frame uses an absolute encoding that does not know about any
      shared library relocation.  */
@@ -1012,11 +1805,38 @@ dwarf_search_unwind_table (unw_addr_space_t as, unw_word_t ip,
           mempool_free (&dwarf_cie_info_pool, pi->unwind_info);
           pi->unwind_info = NULL;
         }
+      if (cached)
+	goto stale;
+      ret = -UNW_ENOINFO;
+      goto out;
       /* End of ANDROID support update. */
-      return -UNW_ENOINFO;
     }
 
-  return 0;
+  /* ANDROID support update. */
+  if (!cached)
+    fde_cache_insert (as, (uintptr_t) table, segbase, pi->start_ip,
+		      pi->end_ip, fde_start, generation);
+  ret = 0;
+
+ out:
+  if (file)
+    {
+      /* The unwind info reads its instructions from the section.  */
+      if (ret >= 0 && need_unwind_info && pi->unwind_info)
+	((struct dwarf_cie_info *) pi->unwind_info)->debug_frame_file = file;
+      else
+	dwarf_put_debug_frame_file (file);
+    }
+  return ret;
+
+ stale:
+  /* The cached FDE no longer decodes or no longer covers IP, the table
+     must have changed since it was cached.  */
+  Debug (15, "dropping cached fde_addr = %lx\n", (long) fde_start);
+  fde_cache_remove (as, (uintptr_t) table, segbase, fde_start);
+  cached = 0;
+  goto search;
+  /* End of ANDROID update. */
 }
 
 HIDDEN void
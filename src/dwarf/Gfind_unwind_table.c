@@ -441,6 +441,14 @@ dwarf_find_unwind_table (struct elf_dyn_info *edi, struct elf_image *ei,
       edi->di_arm.u.rti.table_data = load_base + parm_exidx->p_vaddr;
       edi->di_arm.u.rti.table_len = parm_exidx->p_memsz;
       found = 1;
+      /* ANDROID support update. */
+#ifndef UNW_LOCAL_ONLY
+      if (parm_exidx->p_filesz == parm_exidx->p_memsz
+          && parm_exidx->p_offset + parm_exidx->p_filesz <= ei->u.mapped.size)
+        arm_exidx_copy_table (as, &edi->di_arm,
+                              (char *) ei->u.mapped.image + parm_exidx->p_offset);
+#endif
+      /* End of ANDROID update. */
     }
 #endif
 
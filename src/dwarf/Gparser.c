@@ -30,13 +30,189 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
 #define alloc_reg_state()	(mempool_alloc (&dwarf_reg_state_pool))
 #define free_reg_state(rs)	(mempool_free (&dwarf_reg_state_pool, rs))
 
+/* ANDROID support update. */
+/* A CFI program is decoded from a buffer that is filled with one
+   access_mem() call per word, rather than through one access_mem()
+   call per byte; for remote unwinding, each call may be a system call.
+   Anything past the buffer (unusually long programs) or that could not
+   be fetched is read through the accessors as before.  */
+#ifndef UNW_LOCAL_ONLY
+# define DWARF_CFI_BUF_WORDS	64
+
+struct cfi_buf
+  {
+    unw_word_t start;	/* address of data[0] (word-aligned) */
+    unw_word_t end;	/* address past the last buffered byte */
+    unw_word_t data[DWARF_CFI_BUF_WORDS];
+  };
+
+static inline void
+cfi_fill (struct cfi_buf *b, unw_addr_space_t as, unw_accessors_t *a,
+	  unw_word_t addr, unw_word_t end_addr, void *arg)
+{
+  unw_word_t base = addr & -sizeof (unw_word_t);
+  unw_word_t n = (end_addr - base + sizeof (unw_word_t) - 1)
+		 / sizeof (unw_word_t);
+  unw_word_t i;
+
+  /* dwarf_readu8() loads local memory directly, copying it first would
+     only add work.  */
+  if (end_addr <= addr || dwarf_is_local_as (as))
+    n = 0;
+  else if (n > DWARF_CFI_BUF_WORDS)
+    n = DWARF_CFI_BUF_WORDS;
+
+  /* The words are aligned, so they lie in the same pages as the
+     program itself.  */
+  for (i = 0; i < n; ++i)
+    if ((*a->access_mem) (as, base + i * sizeof (unw_word_t), &b->data[i], 0,
+			  arg) < 0)
+      break;
+
+  b->start = base;
+  b->end = base + i * sizeof (unw_word_t);
+}
+#else
+/* Local memory is read directly, there is nothing to buffer.  */
+struct cfi_buf;
+#endif
+
+static inline int
+cfi_readu8 (struct cfi_buf *b, unw_addr_space_t as, unw_accessors_t *a,
+	    unw_word_t *addr, uint8_t *valp, void *arg)
+{
+#ifndef UNW_LOCAL_ONLY
+  unw_word_t off = *addr - b->start, val;
+
+  /* Extract the byte from its word exactly like dwarf_readu8() does.
+     Like dwarf_readu8(), this expects access_mem() to return words in
+     host byte order; cross-endian remote unwinding isn't supported.  */
+  if (likely (off < b->end - b->start))
+    {
+      val = b->data[off / sizeof (unw_word_t)];
+      off %= sizeof (unw_word_t);
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+      val >>= 8*off;
+#else
+      val >>= 8*(sizeof (unw_word_t) - 1 - off);
+#endif
+      *valp = (uint8_t) val;
+      *addr += 1;
+      return 0;
+    }
+#endif
+  return dwarf_readu8 (as, a, addr, valp, arg);
+}
+
+static inline int
+cfi_readu16 (struct cfi_buf *b, unw_addr_space_t as, unw_accessors_t *a,
+	     unw_word_t *addr, uint16_t *val, void *arg)
+{
+  uint8_t v0, v1;
+  int ret;
+
+  if ((ret = cfi_readu8 (b, as, a, addr, &v0, arg)) < 0
+      || (ret = cfi_readu8 (b, as, a, addr, &v1, arg)) < 0)
+    return ret;
+
+  if (tdep_big_endian (as))
+    *val = (uint16_t) v0 << 8 | v1;
+  else
+    *val = (uint16_t) v1 << 8 | v0;
+  return 0;
+}
+
+static inline int
+cfi_readu32 (struct cfi_buf *b, unw_addr_space_t as, unw_accessors_t *a,
+	     unw_word_t *addr, uint32_t *val, void *arg)
+{
+  uint16_t v0, v1;
+  int ret;
+
+  if ((ret = cfi_readu16 (b, as, a, addr, &v0, arg)) < 0
+      || (ret = cfi_readu16 (b, as, a, addr, &v1, arg)) < 0)
+    return ret;
+
+  if (tdep_big_endian (as))
+    *val = (uint32_t) v0 << 16 | v1;
+  else
+    *val = (uint32_t) v1 << 16 | v0;
+  return 0;
+}
+
+static inline int
+cfi_readu64 (struct cfi_buf *b, unw_addr_space_t as, unw_accessors_t *a,
+	     unw_word_t *addr, uint64_t *val, void *arg)
+{
+  uint32_t v0, v1;
+  int ret;
+
+  if ((ret = cfi_readu32 (b, as, a, addr, &v0, arg)) < 0
+      || (ret = cfi_readu32 (b, as, a, addr, &v1, arg)) < 0)
+    return ret;
+
+  if (tdep_big_endian (as))
+    *val = (uint64_t) v0 << 32 | v1;
+  else
+    *val = (uint64_t) v1 << 32 | v0;
+  return 0;
+}
+
 static inline int
-read_regnum (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
-	     unw_word_t *valp, void *arg)
+cfi_read_uleb128 (struct cfi_buf *b, unw_addr_space_t as, unw_accessors_t *a,
+		  unw_word_t *addr, unw_word_t *valp, void *arg)
 {
+  unw_word_t val = 0, shift = 0;
+  uint8_t byte;
   int ret;
 
-  if ((ret = dwarf_read_uleb128 (as, a, addr, valp, arg)) < 0)
+  do
+    {
+      if ((ret = cfi_readu8 (b, as, a, addr, &byte, arg)) < 0)
+	return ret;
+
+      val |= ((unw_word_t) byte & 0x7f) << shift;
+      shift += 7;
+    }
+  while (byte & 0x80);
+
+  *valp = val;
+  return 0;
+}
+
+static inline int
+cfi_read_sleb128 (struct cfi_buf *b, unw_addr_space_t as, unw_accessors_t *a,
+		  unw_word_t *addr, unw_word_t *valp, void *arg)
+{
+  unw_word_t val = 0, shift = 0;
+  uint8_t byte;
+  int ret;
+
+  do
+    {
+      if ((ret = cfi_readu8 (b, as, a, addr, &byte, arg)) < 0)
+	return ret;
+
+      val |= ((unw_word_t) byte & 0x7f) << shift;
+      shift += 7;
+    }
+  while (byte & 0x80);
+
+  if (shift < 8 * sizeof (unw_word_t) && (byte & 0x40) != 0)
+    /* sign-extend negative value */
+    val |= ((unw_word_t) -1) << shift;
+
+  *valp = val;
+  return 0;
+}
+
+static inline int
+read_regnum (struct cfi_buf *b, unw_addr_space_t as, unw_accessors_t *a,
+	     unw_word_t *addr, unw_word_t *valp, void *arg)
+{
+  int ret;
+
+  if ((ret = cfi_read_uleb128 (b, as, a, addr, valp, arg)) < 0)
     return ret;
 
   if (*valp >= DWARF_NUM_PRESERVED_REGS)
@@ -46,6 +222,7 @@ read_regnum (unw_addr_space_t as, unw_accessors_t *a, unw_word_t *addr,
     }
   return 0;
 }
+/* End of ANDROID update. */
 
 static inline void
 set_reg (dwarf_state_record_t *sr, unw_word_t regnum, dwarf_where_t where,
@@ -55,6 +232,7 @@ set_reg (dwarf_state_record_t *sr, unw_word_t regnum, dwarf_where_t where,
   sr->rs_current.reg[regnum].val = val;
 }
 
+/* ANDROID support update. */
 /* Run a CFI program to update the register state.  */
 static int
 run_cfi_program (struct dwarf_cursor *c, dwarf_state_record_t *sr,
@@ -70,6 +248,11 @@ run_cfi_program (struct dwarf_cursor *c, dwarf_state_record_t *sr,
   uint32_t u32;
   void *arg;
   int ret;
+#ifndef UNW_LOCAL_ONLY
+  struct cfi_buf buf, *b = &buf;
+#else
+  struct cfi_buf *b = NULL;
+#endif
 
   as = c->as;
   arg = c->as_arg;
@@ -81,13 +264,16 @@ run_cfi_program (struct dwarf_cursor *c, dwarf_state_record_t *sr,
     }
   a = unw_get_accessors (as);
   curr_ip = c->pi.start_ip;
+#ifndef UNW_LOCAL_ONLY
+  cfi_fill (b, as, a, *addr, end_addr, arg);
+#endif
 
   /* Process everything up to and including the current 'ip',
      including all the DW_CFA_advance_loc instructions.  See
      'c->use_prev_instr' use in 'fetch_proc_info' for details. */
   while (curr_ip <= ip && *addr < end_addr)
     {
-      if ((ret = dwarf_readu8 (as, a, addr, &op, arg)) < 0)
+      if ((ret = cfi_readu8 (b, as, a, addr, &op, arg)) < 0)
 	return ret;
 
       if (op & DWARF_CFA_OPCODE_MASK)
@@ -103,21 +289,21 @@ run_cfi_program (struct dwarf_cursor *c, dwarf_state_record_t *sr,
 	  break;
 
 	case DW_CFA_advance_loc1:
-	  if ((ret = dwarf_readu8 (as, a, addr, &u8, arg)) < 0)
+	  if ((ret = cfi_readu8 (b, as, a, addr, &u8, arg)) < 0)
 	    goto fail;
 	  curr_ip += u8 * dci->code_align;
 	  Debug (15, "CFA_advance_loc1 to 0x%lx\n", (long) curr_ip);
 	  break;
 
 	case DW_CFA_advance_loc2:
-	  if ((ret = dwarf_readu16 (as, a, addr, &u16, arg)) < 0)
+	  if ((ret = cfi_readu16 (b, as, a, addr, &u16, arg)) < 0)
 	    goto fail;
 	  curr_ip += u16 * dci->code_align;
 	  Debug (15, "CFA_advance_loc2 to 0x%lx\n", (long) curr_ip);
 	  break;
 
 	case DW_CFA_advance_loc4:
-	  if ((ret = dwarf_readu32 (as, a, addr, &u32, arg)) < 0)
+	  if ((ret = cfi_readu32 (b, as, a, addr, &u32, arg)) < 0)
 	    goto fail;
 	  curr_ip += u32 * dci->code_align;
 	  Debug (15, "CFA_advance_loc4 to 0x%lx\n", (long) curr_ip);
@@ -128,7 +314,7 @@ run_cfi_program (struct dwarf_cursor *c, dwarf_state_record_t *sr,
 	  {
 	    uint64_t u64;
 
-	    if ((ret = dwarf_readu64 (as, a, addr, &u64, arg)) < 0)
+	    if ((ret = cfi_readu64 (b, as, a, addr, &u64, arg)) < 0)
 	      goto fail;
 	    curr_ip += u64 * dci->code_align;
 	    Debug (15, "CFA_MIPS_advance_loc8\n");
@@ -149,7 +335,7 @@ run_cfi_program (struct dwarf_cursor *c, dwarf_state_record_t *sr,
 	      ret = -UNW_EBADREG;
 	      goto fail;
 	    }
-	  if ((ret = dwarf_read_uleb128 (as, a, addr, &val, arg)) < 0)
+	  if ((ret = cfi_read_uleb128 (b, as, a, addr, &val, arg)) < 0)
 	    goto fail;
 	  set_reg (sr, regnum, DWARF_WHERE_CFAREL, val * dci->data_align);
 	  Debug (15, "CFA_offset r%lu at cfa+0x%lx\n",
@@ -157,8 +343,8 @@ run_cfi_program (struct dwarf_cursor *c, dwarf_state_record_t *sr,
 	  break;
 
 	case DW_CFA_offset_extended:
-	  if (((ret = read_regnum (as, a, addr, &regnum, arg)) < 0)
-	      || ((ret = dwarf_read_uleb128 (as, a, addr, &val, arg)) < 0))
+	  if (((ret = read_regnum (b, as, a, addr, &regnum, arg)) < 0)
+	      || ((ret = cfi_read_uleb128 (b, as, a, addr, &val, arg)) < 0))
 	    goto fail;
 	  set_reg (sr, regnum, DWARF_WHERE_CFAREL, val * dci->data_align);
 	  Debug (15, "CFA_offset_extended r%lu at cf+0x%lx\n",
@@ -166,8 +352,8 @@ run_cfi_program (struct dwarf_cursor *c, dwarf_state_record_t *sr,
 	  break;
 
 	case DW_CFA_offset_extended_sf:
-	  if (((ret = read_regnum (as, a, addr, &regnum, arg)) < 0)
-	      || ((ret = dwarf_read_sleb128 (as, a, addr, &val, arg)) < 0))
+	  if (((ret = read_regnum (b, as, a, addr, &regnum, arg)) < 0)
+	      || ((ret = cfi_read_sleb128 (b, as, a, addr, &val, arg)) < 0))
 	    goto fail;
 	  set_reg (sr, regnum, DWARF_WHERE_CFAREL, val * dci->data_align);
 	  Debug (15, "CFA_offset_extended_sf r%lu at cf+0x%lx\n",
@@ -188,7 +374,7 @@ run_cfi_program (struct dwarf_cursor *c, dwarf_state_record_t *sr,
 	  break;
 
 	case DW_CFA_restore_extended:
-	  if ((ret = dwarf_read_uleb128 (as, a, addr, &regnum, arg)) < 0)
+	  if ((ret = cfi_read_uleb128 (b, as, a, addr, &regnum, arg)) < 0)
 	    goto fail;
 	  if (regnum >= DWARF_NUM_PRESERVED_REGS)
 	    {
@@ -214,22 +400,22 @@ run_cfi_program (struct dwarf_cursor *c, dwarf_state_record_t *sr,
 	  break;
 
 	case DW_CFA_undefined:
-	  if ((ret = read_regnum (as, a, addr, &regnum, arg)) < 0)
+	  if ((ret = read_regnum (b, as, a, addr, &regnum, arg)) < 0)
 	    goto fail;
 	  set_reg (sr, regnum, DWARF_WHERE_UNDEF, 0);
 	  Debug (15, "CFA_undefined r%lu\n", (long) regnum);
 	  break;
 
 	case DW_CFA_same_value:
-	  if ((ret = read_regnum (as, a, addr, &regnum, arg)) < 0)
+	  if ((ret = read_regnum (b, as, a, addr, &regnum, arg)) < 0)
 	    goto fail;
 	  set_reg (sr, regnum, DWARF_WHERE_SAME, 0);
 	  Debug (15, "CFA_same_value r%lu\n", (long) regnum);
 	  break;
 
 	case DW_CFA_register:
-	  if (((ret = read_regnum (as, a, addr, &regnum, arg)) < 0)
-	      || ((ret = dwarf_read_uleb128 (as, a, addr, &val, arg)) < 0))
+	  if (((ret = read_regnum (b, as, a, addr, &regnum, arg)) < 0)
+	      || ((ret = cfi_read_uleb128 (b, as, a, addr, &val, arg)) < 0))
 	    goto fail;
 	  set_reg (sr, regnum, DWARF_WHERE_REG, val);
 	  Debug (15, "CFA_register r%lu to r%lu\n", (long) regnum, (long) val);
@@ -265,8 +451,8 @@ run_cfi_program (struct dwarf_cursor *c, dwarf_state_record_t *sr,
 	  break;
 
 	case DW_CFA_def_cfa:
-	  if (((ret = read_regnum (as, a, addr, &regnum, arg)) < 0)
-	      || ((ret = dwarf_read_uleb128 (as, a, addr, &val, arg)) < 0))
+	  if (((ret = read_regnum (b, as, a, addr, &regnum, arg)) < 0)
+	      || ((ret = cfi_read_uleb128 (b, as, a, addr, &val, arg)) < 0))
 	    goto fail;
 	  set_reg (sr, DWARF_CFA_REG_COLUMN, DWARF_WHERE_REG, regnum);
 	  set_reg (sr, DWARF_CFA_OFF_COLUMN, 0, val);	/* NOT factored! */
@@ -274,8 +460,8 @@ run_cfi_program (struct dwarf_cursor *c, dwarf_state_record_t *sr,
 	  break;
 
 	case DW_CFA_def_cfa_sf:
-	  if (((ret = read_regnum (as, a, addr, &regnum, arg)) < 0)
-	      || ((ret = dwarf_read_sleb128 (as, a, addr, &val, arg)) < 0))
+	  if (((ret = read_regnum (b, as, a, addr, &regnum, arg)) < 0)
+	      || ((ret = cfi_read_sleb128 (b, as, a, addr, &val, arg)) < 0))
 	    goto fail;
 	  set_reg (sr, DWARF_CFA_REG_COLUMN, DWARF_WHERE_REG, regnum);
 	  set_reg (sr, DWARF_CFA_OFF_COLUMN, 0,
@@ -285,21 +471,21 @@ run_cfi_program (struct dwarf_cursor *c, dwarf_state_record_t *sr,
 	  break;
 
 	case DW_CFA_def_cfa_register:
-	  if ((ret = read_regnum (as, a, addr, &regnum, arg)) < 0)
+	  if ((ret = read_regnum (b, as, a, addr, &regnum, arg)) < 0)
 	    goto fail;
 	  set_reg (sr, DWARF_CFA_REG_COLUMN, DWARF_WHERE_REG, regnum);
 	  Debug (15, "CFA_def_cfa_register r%lu\n", (long) regnum);
 	  break;
 
 	case DW_CFA_def_cfa_offset:
-	  if ((ret = dwarf_read_uleb128 (as, a, addr, &val, arg)) < 0)
+	  if ((ret = cfi_read_uleb128 (b, as, a, addr, &val, arg)) < 0)
 	    goto fail;
 	  set_reg (sr, DWARF_CFA_OFF_COLUMN, 0, val);	/* NOT factored! */
 	  Debug (15, "CFA_def_cfa_offset 0x%lx\n", (long) val);
 	  break;
 
 	case DW_CFA_def_cfa_offset_sf:
-	  if ((ret = dwarf_read_sleb128 (as, a, addr, &val, arg)) < 0)
+	  if ((ret = cfi_read_sleb128 (b, as, a, addr, &val, arg)) < 0)
 	    goto fail;
 	  set_reg (sr, DWARF_CFA_OFF_COLUMN, 0,
 		   val * dci->data_align);	/* factored! */
@@ -311,7 +497,7 @@ run_cfi_program (struct dwarf_cursor *c, dwarf_state_record_t *sr,
 	  /* Save the address of the DW_FORM_block for later evaluation. */
 	  set_reg (sr, DWARF_CFA_REG_COLUMN, DWARF_WHERE_EXPR, *addr);
 
-	  if ((ret = dwarf_read_uleb128 (as, a, addr, &len, arg)) < 0)
+	  if ((ret = cfi_read_uleb128 (b, as, a, addr, &len, arg)) < 0)
 	    goto fail;
 
 	  Debug (15, "CFA_def_cfa_expr @ 0x%lx [%lu bytes]\n",
@@ -320,13 +506,13 @@ run_cfi_program (struct dwarf_cursor *c, dwarf_state_record_t *sr,
 	  break;
 
 	case DW_CFA_expression:
-	  if ((ret = read_regnum (as, a, addr, &regnum, arg)) < 0)
+	  if ((ret = read_regnum (b, as, a, addr, &regnum, arg)) < 0)
 	    goto fail;
 
 	  /* Save the address of the DW_FORM_block for later evaluation. */
 	  set_reg (sr, regnum, DWARF_WHERE_EXPR, *addr);
 
-	  if ((ret = dwarf_read_uleb128 (as, a, addr, &len, arg)) < 0)
+	  if ((ret = cfi_read_uleb128 (b, as, a, addr, &len, arg)) < 0)
 	    goto fail;
 
 	  Debug (15, "CFA_expression r%lu @ 0x%lx [%lu bytes]\n",
@@ -335,7 +521,7 @@ run_cfi_program (struct dwarf_cursor *c, dwarf_state_record_t *sr,
 	  break;
 
 	case DW_CFA_GNU_args_size:
-	  if ((ret = dwarf_read_uleb128 (as, a, addr, &val, arg)) < 0)
+	  if ((ret = cfi_read_uleb128 (b, as, a, addr, &val, arg)) < 0)
 	    goto fail;
 	  sr->args_size = val;
 	  Debug (15, "CFA_GNU_args_size %lu\n", (long) val);
@@ -345,8 +531,8 @@ run_cfi_program (struct dwarf_cursor *c, dwarf_state_record_t *sr,
 	  /* A comment in GCC says that this is obsoleted by
 	     DW_CFA_offset_extended_sf, but that it's used by older
 	     PowerPC code.  */
-	  if (((ret = read_regnum (as, a, addr, &regnum, arg)) < 0)
-	      || ((ret = dwarf_read_uleb128 (as, a, addr, &val, arg)) < 0))
+	  if (((ret = read_regnum (b, as, a, addr, &regnum, arg)) < 0)
+	      || ((ret = cfi_read_uleb128 (b, as, a, addr, &val, arg)) < 0))
 	    goto fail;
 	  set_reg (sr, regnum, DWARF_WHERE_CFAREL, -(val * dci->data_align));
 	  Debug (15, "CFA_GNU_negative_offset_extended cfa+0x%lx\n",
@@ -384,6 +570,7 @@ run_cfi_program (struct dwarf_cursor *c, dwarf_state_record_t *sr,
     }
   return ret;
 }
+/* End of ANDROID update. */
 
 static int
 fetch_proc_info (struct dwarf_cursor *c, unw_word_t ip, int need_unwind_info)
@@ -464,6 +651,12 @@ put_unwind_info (struct dwarf_cursor *c, unw_proc_info_t *pi)
     unwi_put_dynamic_unwind_info (c->as, pi, c->as_arg);
   else if (pi->unwind_info && pi->format == UNW_INFO_FORMAT_TABLE)
     {
+      /* ANDROID support update. */
+      struct dwarf_cie_info *dci = pi->unwind_info;
+
+      if (dci->debug_frame_file)
+	dwarf_put_debug_frame_file (dci->debug_frame_file);
+      /* End of ANDROID update. */
       mempool_free (&dwarf_cie_info_pool, pi->unwind_info);
       pi->unwind_info = NULL;
     }
@@ -493,130 +686,290 @@ parse_fde (struct dwarf_cursor *c, unw_word_t ip, dwarf_state_record_t *sr)
   return 0;
 }
 
+/* ANDROID support update. */
+/* A shard's miss rate is checked every RS_SHARD_CHECK_INTERVAL
+   lookups per entry; more than one miss in RS_SHARD_GROW_RATIO makes
+   it grow.  */
+#define RS_SHARD_CHECK_INTERVAL	8
+#define RS_SHARD_GROW_RATIO	4
+
+static inline size_t
+rs_shard_mapped_size (unsigned short log_size)
+{
+  return (sizeof (dwarf_compact_reg_state_t) + 2 * sizeof (unsigned short))
+	 << log_size;
+}
+
 static inline void
-flush_rs_cache (struct dwarf_rs_cache *cache)
+flush_rs_shard (struct dwarf_rs_cache_shard *shard)
 {
-  int i;
+  int i, size;
 
-  cache->lru_head = DWARF_UNW_CACHE_SIZE - 1;
-  cache->lru_tail = 0;
+  if (!shard->buckets)
+    {
+      /* first use of a zero-initialized shard */
+      shard->log_size = DWARF_LOG_RS_SHARD_SIZE;
+      shard->hash = shard->default_hash;
+      shard->buckets = shard->default_buckets;
+    }
+  size = 1 << shard->log_size;
 
-  for (i = 0; i < DWARF_UNW_CACHE_SIZE; ++i)
+  shard->lru_head = size - 1;
+  shard->lru_tail = 0;
+  shard->lookups = 0;
+  shard->misses = 0;
+
+  for (i = 0; i < size; ++i)
     {
-      if (i > 0)
-	cache->buckets[i].lru_chain = (i - 1);
-      cache->buckets[i].coll_chain = -1;
-      cache->buckets[i].ip = 0;
-      cache->buckets[i].valid = 0;
+      /* the first entry's chain only matters for a one-entry shard */
+      shard->buckets[i].lru_chain = (i > 0 ? i - 1 : 0);
+      shard->buckets[i].coll_chain = -1;
+      shard->buckets[i].ip = 0;
+      shard->buckets[i].valid = 0;
     }
-  for (i = 0; i<DWARF_UNW_HASH_SIZE; ++i)
-    cache->hash[i] = -1;
+  for (i = 0; i < 2 * size; ++i)
+    shard->hash[i] = -1;
 }
 
-static inline struct dwarf_rs_cache *
-get_rs_cache (unw_addr_space_t as, intrmask_t *saved_maskp)
+/* Give SHARD room for 1 << LOG_SIZE entries and flush it.  Sizes up
+   to the default fit in the embedded arrays, larger ones are mmap'd.
+   The caller must hold the shard's lock, and any rs it looked up is
+   gone afterwards.  */
+static int
+resize_rs_shard (struct dwarf_rs_cache_shard *shard, unsigned short log_size)
 {
-  struct dwarf_rs_cache *cache = &as->global_cache;
+  dwarf_compact_reg_state_t *buckets;
+  unsigned short *hash;
+  void *mem = NULL;
+
+  if (log_size > DWARF_LOG_RS_SHARD_SIZE)
+    {
+      GET_MEMORY (mem, rs_shard_mapped_size (log_size));
+      if (!mem)
+	{
+	  Debug (1, "failed to allocate %u rs cache entries\n", 1 << log_size);
+	  return -UNW_ENOMEM;
+	}
+      buckets = mem;
+      hash = (unsigned short *) (buckets + (1 << log_size));
+    }
+  else
+    {
+      buckets = shard->default_buckets;
+      hash = shard->default_hash;
+    }
+
+  if (shard->mapped_log_size)
+    munmap (shard->buckets, rs_shard_mapped_size (shard->mapped_log_size));
+
+  Debug (4, "rs cache shard resized to %u entries\n", 1 << log_size);
+  shard->hash = hash;
+  shard->buckets = buckets;
+  shard->log_size = log_size;
+  shard->mapped_log_size = mem ? log_size : 0;
+  flush_rs_shard (shard);
+  return 0;
+}
+
+HIDDEN int
+dwarf_set_rs_cache_size (struct dwarf_rs_cache *cache,
+			 unsigned short log_size, int fixed)
+{
+  struct dwarf_rs_cache_shard *shard;
+  intrmask_t saved_mask;
+  int i, ret = 0;
+
+  cache->fixed = fixed;
+  for (i = 0; i < DWARF_RS_CACHE_SHARDS; ++i)
+    {
+      shard = cache->shards + i;
+      lock_acquire (&shard->lock, saved_mask);
+      if ((!shard->buckets || shard->log_size != log_size)
+	  && resize_rs_shard (shard, log_size) < 0)
+	ret = -UNW_ENOMEM;
+      lock_release (&shard->lock, saved_mask);
+    }
+  return ret;
+}
+
+HIDDEN void
+dwarf_free_rs_cache (struct dwarf_rs_cache *cache)
+{
+  struct dwarf_rs_cache_shard *shard;
+  int i;
+
+  for (i = 0; i < DWARF_RS_CACHE_SHARDS; ++i)
+    {
+      shard = cache->shards + i;
+      if (shard->mapped_log_size)
+	munmap (shard->buckets, rs_shard_mapped_size (shard->mapped_log_size));
+      shard->mapped_log_size = 0;
+      shard->buckets = NULL;
+    }
+}
+
+static inline unw_word_t CONST_ATTR
+hash (unw_word_t ip)
+{
+  /* based on (sqrt(5)/2-1)*2^64 */
+# define magic	((unw_word_t) 0x9e3779b97f4a7c16ULL)
+
+  return ip * magic;
+}
+
+/* The top bits of the hash pick the shard, the bits below them the
+   hash chain within the shard.  */
+static inline unsigned int
+rs_shard_index (unw_word_t ip)
+{
+  return hash (ip) >> ((sizeof(unw_word_t) * 8) - DWARF_LOG_RS_CACHE_SHARDS);
+}
+
+static inline unw_hash_index_t
+rs_hash_index (struct dwarf_rs_cache_shard *shard, unw_word_t ip)
+{
+  return (hash (ip) << DWARF_LOG_RS_CACHE_SHARDS)
+	 >> ((sizeof(unw_word_t) * 8) - (shard->log_size + 1));
+}
+
+static inline struct dwarf_rs_cache_shard *
+get_rs_cache (unw_addr_space_t as, unsigned int shard_index,
+	      intrmask_t *saved_maskp)
+{
+  struct dwarf_rs_cache_shard *shard;
   unw_caching_policy_t caching = as->caching_policy;
 
   if (caching == UNW_CACHE_NONE)
     return NULL;
 
+  shard = as->global_cache.shards + shard_index;
   if (likely (caching == UNW_CACHE_GLOBAL))
     {
       Debug (16, "acquiring lock\n");
-      lock_acquire (&cache->lock, *saved_maskp);
+      lock_acquire (&shard->lock, *saved_maskp);
     }
 
-  if (atomic_read (&as->cache_generation) != atomic_read (&cache->generation))
+  if (!shard->buckets
+      || atomic_read (&as->cache_generation) != atomic_read (&shard->generation))
     {
-      flush_rs_cache (cache);
-      cache->generation = as->cache_generation;
+      flush_rs_shard (shard);
+      shard->generation = as->cache_generation;
     }
 
-  return cache;
+  return shard;
 }
 
 static inline void
-put_rs_cache (unw_addr_space_t as, struct dwarf_rs_cache *cache,
+put_rs_cache (unw_addr_space_t as, struct dwarf_rs_cache_shard *shard,
 		  intrmask_t *saved_maskp)
 {
   assert (as->caching_policy != UNW_CACHE_NONE);
 
   Debug (16, "unmasking signals/interrupts and releasing lock\n");
   if (likely (as->caching_policy == UNW_CACHE_GLOBAL))
-    lock_release (&cache->lock, *saved_maskp);
+    lock_release (&shard->lock, *saved_maskp);
 }
 
-static inline unw_hash_index_t CONST_ATTR
-hash (unw_word_t ip)
+/* Called on a miss, before a new rs is entered into SHARD.  Shards
+   only grow under UNW_CACHE_GLOBAL, where nobody else can be using
+   them, and not once unw_set_cache_size() has fixed their size.  */
+static inline void
+rs_shard_check_size (unw_addr_space_t as, struct dwarf_rs_cache_shard *shard)
 {
-  /* based on (sqrt(5)/2-1)*2^64 */
-# define magic	((unw_word_t) 0x9e3779b97f4a7c16ULL)
-
-  return ip * magic >> ((sizeof(unw_word_t) * 8) - DWARF_LOG_UNW_HASH_SIZE);
+  if (shard->lookups < ((uint32_t) RS_SHARD_CHECK_INTERVAL << shard->log_size))
+    return;
+
+  if (shard->misses * RS_SHARD_GROW_RATIO > shard->lookups
+      && shard->log_size < DWARF_LOG_RS_SHARD_MAX_SIZE
+      && !as->global_cache.fixed
+      && as->caching_policy == UNW_CACHE_GLOBAL
+      && resize_rs_shard (shard, shard->log_size + 1) == 0)
+    return;
+
+  shard->lookups = 0;
+  shard->misses = 0;
 }
 
 static inline long
-cache_match (dwarf_reg_state_t *rs, unw_word_t ip)
+cache_match (dwarf_compact_reg_state_t *rs, unw_word_t ip)
 {
   if (rs->valid && (ip == rs->ip))
     return 1;
   return 0;
 }
 
-static dwarf_reg_state_t *
-rs_lookup (struct dwarf_rs_cache *cache, struct dwarf_cursor *c)
+static dwarf_compact_reg_state_t *
+rs_lookup (struct dwarf_rs_cache_shard *shard, unsigned int shard_index,
+	   struct dwarf_cursor *c)
 {
-  dwarf_reg_state_t *rs = cache->buckets + c->hint;
+  unsigned int size = 1 << shard->log_size;
+  dwarf_compact_reg_state_t *rs;
   unsigned short index;
   unw_word_t ip;
 
   ip = c->ip;
 
-  if (cache_match (rs, ip))
-    return rs;
+  if (DWARF_RS_HINT_SHARD (c->hint) == shard_index
+      && DWARF_RS_HINT_INDEX (c->hint) < size)
+    {
+      rs = shard->buckets + DWARF_RS_HINT_INDEX (c->hint);
+      if (cache_match (rs, ip))
+	return rs;
+    }
 
-  index = cache->hash[hash (ip)];
-  if (index >= DWARF_UNW_CACHE_SIZE)
+  index = shard->hash[rs_hash_index (shard, ip)];
+  if (index >= size)
     return NULL;
 
-  rs = cache->buckets + index;
+  rs = shard->buckets + index;
   while (1)
     {
       if (cache_match (rs, ip))
-        {
-          /* update hint; no locking needed: single-word writes are atomic */
-          c->hint = cache->buckets[c->prev_rs].hint =
-            (rs - cache->buckets);
-          return rs;
-        }
-      if (rs->coll_chain >= DWARF_UNW_HASH_SIZE)
+	return rs;
+      if (rs->coll_chain >= size)
         return NULL;
-      rs = cache->buckets + rs->coll_chain;
+      rs = shard->buckets + rs->coll_chain;
     }
 }
 
-static inline dwarf_reg_state_t *
-rs_new (struct dwarf_rs_cache *cache, struct dwarf_cursor * c)
+/* Make RS the hint of the previous frame's rs, and use its own hint
+   for the next frame.  Another shard's rs is left alone: its lock
+   isn't held and the shard may be resized under us.  */
+static inline void
+rs_link (struct dwarf_rs_cache_shard *shard, unsigned int shard_index,
+	 struct dwarf_cursor *c, dwarf_compact_reg_state_t *rs)
+{
+  short self = DWARF_RS_HINT (shard_index, rs - shard->buckets);
+
+  if (DWARF_RS_HINT_SHARD (c->prev_rs) == shard_index
+      && DWARF_RS_HINT_INDEX (c->prev_rs) < (1U << shard->log_size))
+    shard->buckets[DWARF_RS_HINT_INDEX (c->prev_rs)].hint = self;
+
+  c->hint = rs->hint;
+  c->prev_rs = self;
+}
+
+static inline dwarf_compact_reg_state_t *
+rs_new (struct dwarf_rs_cache_shard *shard, struct dwarf_cursor * c)
 {
-  dwarf_reg_state_t *rs, *prev, *tmp;
+  unsigned int size = 1 << shard->log_size;
+  dwarf_compact_reg_state_t *rs, *prev, *tmp;
   unw_hash_index_t index;
   unsigned short head;
 
-  head = cache->lru_head;
-  rs = cache->buckets + head;
-  cache->lru_head = rs->lru_chain;
+  head = shard->lru_head;
+  rs = shard->buckets + head;
+  shard->lru_head = rs->lru_chain;
 
   /* re-insert rs at the tail of the LRU chain: */
-  cache->buckets[cache->lru_tail].lru_chain = head;
-  cache->lru_tail = head;
+  shard->buckets[shard->lru_tail].lru_chain = head;
+  shard->lru_tail = head;
 
   /* remove the old rs from the hash table (if it's there): */
   if (rs->ip)
     {
-      index = hash (rs->ip);
-      tmp = cache->buckets + cache->hash[index];
+      index = rs_hash_index (shard, rs->ip);
+      tmp = shard->buckets + shard->hash[index];
       prev = NULL;
       while (1)
 	{
@@ -625,33 +978,95 @@ rs_new (struct dwarf_rs_cache *cache, struct dwarf_cursor * c)
 	      if (prev)
 		prev->coll_chain = tmp->coll_chain;
 	      else
-		cache->hash[index] = tmp->coll_chain;
+		shard->hash[index] = tmp->coll_chain;
 	      break;
 	    }
 	  else
 	    prev = tmp;
-	  if (tmp->coll_chain >= DWARF_UNW_CACHE_SIZE)
+	  if (tmp->coll_chain >= size)
 	    /* old rs wasn't in the hash-table */
 	    break;
-	  tmp = cache->buckets + tmp->coll_chain;
+	  tmp = shard->buckets + tmp->coll_chain;
 	}
     }
 
   /* enter new rs in the hash table */
-  index = hash (c->ip);
-  rs->coll_chain = cache->hash[index];
-  cache->hash[index] = rs - cache->buckets;
+  index = rs_hash_index (shard, c->ip);
+  rs->coll_chain = shard->hash[index];
+  shard->hash[index] = rs - shard->buckets;
 
   rs->hint = 0;
   rs->ip = c->ip;
   rs->valid = 1;
-  rs->ret_addr_column = c->ret_addr_column;
-  rs->signal_frame = 0;
-  tdep_cache_frame (c, rs);
 
   return rs;
 }
 
+/* Convert RS, the state for IP, to the cache's compact form.  Returns
+   -1 if it doesn't fit.  */
+static int
+rs_compact (dwarf_compact_reg_state_t *crs, dwarf_reg_state_t *rs,
+	    unw_word_t ip)
+{
+  unw_word_t val;
+  int i, n = 0;
+
+  if (rs->ret_addr_column > 0xff)
+    return -1;
+
+  for (i = 0; i < DWARF_NUM_PRESERVED_REGS + 2; ++i)
+    {
+      if (rs->reg[i].where == DWARF_WHERE_SAME)
+	continue;
+      if (n == DWARF_COMPACT_RS_MAX_REGS)
+	return -1;
+
+      val = rs->reg[i].val;
+      if (rs->reg[i].where == DWARF_WHERE_EXPR)
+	val -= ip;
+      if ((unw_word_t) (int32_t) val != val)
+	return -1;
+
+      crs->reg[n].column = i;
+      crs->reg[n].where = rs->reg[i].where;
+      crs->reg[n].val = (int32_t) val;
+      ++n;
+    }
+
+  crs->nregs = n;
+  crs->ret_addr_column = rs->ret_addr_column;
+  crs->signal_frame = rs->signal_frame;
+  return 0;
+}
+
+/* The reverse of rs_compact().  */
+static inline void
+rs_expand (dwarf_reg_state_t *rs, dwarf_compact_reg_state_t *crs)
+{
+  dwarf_save_loc_t *loc;
+  int i;
+
+  for (i = 0; i < DWARF_NUM_PRESERVED_REGS + 2; ++i)
+    {
+      rs->reg[i].where = DWARF_WHERE_SAME;
+      rs->reg[i].val = 0;
+    }
+
+  for (i = 0; i < crs->nregs; ++i)
+    {
+      loc = rs->reg + crs->reg[i].column;
+      loc->where = crs->reg[i].where;
+      loc->val = (unw_word_t) crs->reg[i].val;
+      if (loc->where == DWARF_WHERE_EXPR)
+	loc->val += crs->ip;
+    }
+
+  rs->next = NULL;
+  rs->ret_addr_column = crs->ret_addr_column;
+  rs->signal_frame = crs->signal_frame;
+}
+/* End of ANDROID update. */
+
 static int
 create_state_record_for (struct dwarf_cursor *c, dwarf_state_record_t *sr,
 			 unw_word_t ip)
@@ -857,24 +1272,45 @@ dwarf_find_save_locs (struct dwarf_cursor *c)
   dwarf_reg_state_t rs_copy_stack;
   dwarf_reg_state_t *rs_copy = &rs_copy_stack;
 #endif
-  dwarf_reg_state_t *rs;
-  struct dwarf_rs_cache *cache;
+  /* ANDROID support update. */
+  dwarf_compact_reg_state_t *rs;
+  struct dwarf_rs_cache_shard *cache;
+  unsigned int shard_index;
+  /* End of ANDROID update. */
   int ret = 0;
   intrmask_t saved_mask;
 
   if (c->as->caching_policy == UNW_CACHE_NONE)
     return uncached_dwarf_find_save_locs (c);
 
-  cache = get_rs_cache(c->as, &saved_mask);
-  rs = rs_lookup(cache, c);
+#if defined(CONSERVE_STACK)
+  rs_copy = (dwarf_reg_state_t*)malloc(sizeof(dwarf_reg_state_t));
+  if (rs_copy == NULL)
+    return -UNW_ENOMEM;
+#endif
+
+  /* ANDROID support update. */
+  shard_index = rs_shard_index (c->ip);
+  cache = get_rs_cache(c->as, shard_index, &saved_mask);
+  rs = rs_lookup(cache, shard_index, c);
+  cache->lookups++;
+  UNWI_STAT_INC (UNWI_STAT_RS_CACHE_LOOKUPS);
+  /* End of ANDROID update. */
 
   if (rs)
     {
       c->ret_addr_column = rs->ret_addr_column;
       c->use_prev_instr = ! rs->signal_frame;
+      /* ANDROID support update. */
+      rs_link (cache, shard_index, c, rs);
+      rs_expand (rs_copy, rs);
+      /* End of ANDROID update. */
     }
   else
     {
+      /* ANDROID support update. */
+      dwarf_compact_reg_state_t compact;
+      /* End of ANDROID update. */
 #if !defined(CONSERVE_STACK)
       dwarf_state_record_t sr_stack;
       dwarf_state_record_t *sr = &sr_stack;
@@ -882,9 +1318,19 @@ dwarf_find_save_locs (struct dwarf_cursor *c)
       dwarf_state_record_t *sr = (dwarf_state_record_t*)malloc(sizeof(dwarf_state_record_t));
 
       if (sr == NULL)
-        return -UNW_ENOMEM;
+        {
+          put_rs_cache (c->as, cache, &saved_mask);
+          free(rs_copy);
+          return -UNW_ENOMEM;
+        }
 #endif
 
+      /* ANDROID support update. */
+      cache->misses++;
+      UNWI_STAT_INC (UNWI_STAT_RS_CACHE_MISSES);
+      rs_shard_check_size (c->as, cache);
+      /* End of ANDROID update. */
+
       if ((ret = fetch_proc_info (c, c->ip, 1)) < 0 ||
 	  (ret = create_state_record_for (c, sr, c->ip)) < 0)
 	{
@@ -892,16 +1338,28 @@ dwarf_find_save_locs (struct dwarf_cursor *c)
           put_unwind_info (c, &c->pi);
 #if defined(CONSERVE_STACK)
           free(sr);
+          free(rs_copy);
 #endif
 	  return ret;
 	}
 
-      rs = rs_new (cache, c);
-      memcpy(rs, &sr->rs_current, offsetof(struct dwarf_reg_state, ip));
-      cache->buckets[c->prev_rs].hint = rs - cache->buckets;
+      /* ANDROID support update. */
+      sr->rs_current.ret_addr_column = c->ret_addr_column;
+      sr->rs_current.signal_frame = 0;
+      tdep_cache_frame (c, &sr->rs_current);
 
-      c->hint = rs->hint;
-      c->prev_rs = rs - cache->buckets;
+      /* States too big for the compact form are used but not cached.  */
+      if (rs_compact (&compact, &sr->rs_current, c->ip) == 0)
+	{
+	  rs = rs_new (cache, c);
+	  rs->ret_addr_column = compact.ret_addr_column;
+	  rs->signal_frame = compact.signal_frame;
+	  rs->nregs = compact.nregs;
+	  memcpy (rs->reg, compact.reg, compact.nregs * sizeof (rs->reg[0]));
+	  rs_link (cache, shard_index, c, rs);
+	}
+      memcpy (rs_copy, &sr->rs_current, sizeof (*rs_copy));
+      /* End of ANDROID update. */
 
       put_unwind_info (c, &c->pi);
 
@@ -910,13 +1368,6 @@ dwarf_find_save_locs (struct dwarf_cursor *c)
 #endif
     }
 
-#if defined(CONSERVE_STACK)
-  rs_copy = (dwarf_reg_state_t*)malloc(sizeof(dwarf_reg_state_t));
-  if (rs_copy == NULL)
-    return -UNW_ENOMEM;
-#endif
-
-  memcpy (rs_copy, rs, sizeof (*rs_copy));
   put_rs_cache (c->as, cache, &saved_mask);
 
   tdep_reuse_frame (c, rs_copy);
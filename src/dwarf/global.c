@@ -35,3 +35,144 @@ dwarf_init (void)
   mempool_init (&dwarf_cie_info_pool, sizeof (struct dwarf_cie_info), 0);
   return 0;
 }
+
+/* ANDROID support update. */
+/* Loaded .debug_frame sections, keyed by the identity of the file they
+   were loaded for.  The local unwinder, the generic one and every
+   address space of either share them.  */
+static struct unw_debug_frame_file *debug_frame_files;
+static define_lock (debug_frame_files_lock);
+
+/* Return a reference to the loaded .debug_frame of the file identified
+   by DEV, INO, FILE_SIZE and FILE_MTIME, or NULL if it was not loaded.  */
+HIDDEN struct unw_debug_frame_file *
+dwarf_get_debug_frame_file (dev_t dev, ino_t ino, off_t file_size,
+			    time_t file_mtime)
+{
+  struct unw_debug_frame_file *file;
+  intrmask_t saved_mask;
+
+  lock_acquire (&debug_frame_files_lock, saved_mask);
+  for (file = debug_frame_files; file; file = file->next)
+    if (file->dev == dev && file->ino == ino
+	&& file->file_size == file_size && file->file_mtime == file_mtime)
+      {
+	file->refs++;
+	break;
+      }
+  lock_release (&debug_frame_files_lock, saved_mask);
+  return file;
+}
+
+static void
+free_debug_frame_file (struct unw_debug_frame_file *file)
+{
+  if (file->mini_debug_info)
+    {
+      elf_w (charge_mini_debug_info) (file->mini_debug_info,
+	  -(long) (file->debug_frame_size
+		   + file->index_size * sizeof (struct table_entry)));
+      elf_w (put_mini_debug_info) (file->mini_debug_info);
+      free (file->debug_frame);
+    }
+  if (file->map)
+    munmap (file->map, file->map_size);
+  free (file->index);
+  free (file);
+}
+
+/* Publish FILE, which holds one reference, and return it.  If another
+   thread published the same file first, FILE is freed and a reference to
+   the other one is returned instead.  */
+HIDDEN struct unw_debug_frame_file *
+dwarf_add_debug_frame_file (struct unw_debug_frame_file *file)
+{
+  struct unw_debug_frame_file *other;
+  intrmask_t saved_mask;
+
+  lock_acquire (&debug_frame_files_lock, saved_mask);
+  for (other = debug_frame_files; other; other = other->next)
+    if (other->dev == file->dev && other->ino == file->ino
+	&& other->file_size == file->file_size
+	&& other->file_mtime == file->file_mtime)
+      {
+	other->refs++;
+	break;
+      }
+  if (!other)
+    {
+      file->next = debug_frame_files;
+      debug_frame_files = file;
+    }
+  lock_release (&debug_frame_files_lock, saved_mask);
+
+  if (!other)
+    return file;
+  free_debug_frame_file (file);
+  return other;
+}
+
+/* Take another reference to FILE, which a region keeps loaded.  The
+   caller holds dwarf_debug_frame_lock, so signals are blocked already.  */
+HIDDEN void
+dwarf_hold_debug_frame_file (struct unw_debug_frame_file *file)
+{
+  mutex_lock (&debug_frame_files_lock);
+  file->refs++;
+  mutex_unlock (&debug_frame_files_lock);
+}
+
+/* Drop a reference to FILE, unloading it with the last one.  */
+HIDDEN void
+dwarf_put_debug_frame_file (struct unw_debug_frame_file *file)
+{
+  struct unw_debug_frame_file **filep;
+  intrmask_t saved_mask;
+
+  lock_acquire (&debug_frame_files_lock, saved_mask);
+  if (--file->refs > 0)
+    file = NULL;
+  else
+    {
+      for (filep = &debug_frame_files; *filep != file;
+	   filep = &(*filep)->next)
+	;
+      *filep = file->next;
+    }
+  lock_release (&debug_frame_files_lock, saved_mask);
+
+  if (file)
+    {
+      Debug (4, "unloading .debug_frame at %p\n", file->debug_frame);
+      free_debug_frame_file (file);
+    }
+}
+
+/* Serializes lookups in, and additions to, the .debug_frame regions of
+   an address space with unw_flush_cache().  A region may only be used
+   while holding the lock; whoever needs its section for longer takes a
+   reference to it first.  */
+HIDDEN define_lock (dwarf_debug_frame_lock);
+
+/* Drop the .debug_frame regions of AS.  */
+HIDDEN void
+dwarf_flush_debug_frames (unw_addr_space_t as)
+{
+  struct unw_debug_frame_list *w, *n;
+  intrmask_t saved_mask;
+
+  lock_acquire (&dwarf_debug_frame_lock, saved_mask);
+  w = as->debug_frames;
+  as->debug_frames = NULL;
+  free (as->debug_frame_index.ranges);
+  memset (&as->debug_frame_index, 0, sizeof (as->debug_frame_index));
+  lock_release (&dwarf_debug_frame_lock, saved_mask);
+
+  for (; w; w = n)
+    {
+      n = w->next;
+      dwarf_put_debug_frame_file (w->file);
+      free (w);
+    }
+}
+/* End of ANDROID update. */
@@ -458,62 +458,576 @@ static void xz_free(void* p, void* address) {
   free(address);
 }
 
+// Images at least this large are decompressed into their own anonymous
+// mapping, which goes straight back to the system when it is freed.
+#define XZ_MMAP_THRESHOLD	(64 * 1024)
+
+// Amount of output produced between checks for the needed sections.
+#define XZ_CHUNK_SIZE		(64 * 1024)
+
+#if HAVE_LZMA
+static bool xz_tables_ready;
+static define_lock (xz_tables_lock);
+
+static void xz_init_tables (void) {
+  intrmask_t saved_mask;
+
+  lock_acquire (&xz_tables_lock, saved_mask);
+  if (!xz_tables_ready) {
+    CrcGenerateTable();
+    Crc64GenerateTable();
+    xz_tables_ready = true;
+  }
+  lock_release (&xz_tables_lock, saved_mask);
+}
+
+static bool xz_read_varint (const uint8_t** p, const uint8_t* end, uint64_t* value) {
+  int shift;
+
+  *value = 0;
+  for (shift = 0; shift < 63 && *p < end; shift += 7) {
+    uint8_t byte = *(*p)++;
+    *value |= (uint64_t) (byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Return the uncompressed size of the xz data SRC as recorded in the
+// index of its stream, or 0 if it cannot be determined, for example
+// because SRC holds more than one stream.
+static size_t xz_uncompressed_size (const uint8_t* src, size_t src_size) {
+  static const uint8_t header_magic[6] = { 0xfd, '7', 'z', 'X', 'Z', 0 };
+  const uint8_t *footer, *index, *p;
+  uint64_t records, unpadded, uncompressed;
+  uint64_t blocks_size = 0, total = 0;
+  size_t index_size;
+
+  // Stream padding comes in multiples of four null bytes.
+  while (src_size >= 4 && memcmp (src + src_size - 4, "\0\0\0", 4) == 0) {
+    src_size -= 4;
+  }
+  if (src_size < 24 || memcmp (src, header_magic, sizeof (header_magic)) != 0) {
+    return 0;
+  }
+  footer = src + src_size - 12;
+  if (footer[10] != 'Y' || footer[11] != 'Z') {
+    return 0;
+  }
+  index_size = ((size_t) footer[4] | (size_t) footer[5] << 8
+                | (size_t) footer[6] << 16 | (size_t) footer[7] << 24) + 1;
+  index_size *= 4;
+  if (index_size > src_size - 24) {
+    return 0;
+  }
+  index = footer - index_size;
+  if (index[0] != 0) {
+    return 0;
+  }
+  p = index + 1;
+  if (!xz_read_varint (&p, footer, &records)) {
+    return 0;
+  }
+  while (records-- > 0) {
+    if (!xz_read_varint (&p, footer, &unpadded)
+        || !xz_read_varint (&p, footer, &uncompressed)) {
+      return 0;
+    }
+    blocks_size += (unpadded + 3) & ~(uint64_t) 3;
+    total += uncompressed;
+  }
+  // The blocks must fill the space between the stream header and the
+  // index, otherwise there is more than one stream.
+  if (blocks_size != (uint64_t) (index - src - 12) || total != (size_t) total) {
+    return 0;
+  }
+  return total;
+}
+
+// Return the end offset of the section table and of the sections named
+// in SECTIONS (and of the sections they link to) of the ELF image in
+// BUF, of which LEN bytes have been decompressed so far. Return 0 if the
+// image is not a valid ELF image, and SIZE_MAX if not enough of it is
+// available yet to tell.
+static size_t xz_needed_size (const uint8_t* buf, size_t len, const char** sections) {
+  const Elf_W (Ehdr)* ehdr = (const Elf_W (Ehdr)*) buf;
+  const Elf_W (Shdr) *shdr, *strtab_shdr;
+  size_t table_end, end;
+  const char* strtab;
+  int i, j;
+
+  if (len < sizeof (*ehdr)) {
+    return SIZE_MAX;
+  }
+  if (memcmp (ehdr->e_ident, ELFMAG, SELFMAG) != 0 || ehdr->e_ident[EI_CLASS] != ELF_CLASS
+      || ehdr->e_shentsize != sizeof (Elf_W (Shdr)) || ehdr->e_shstrndx >= ehdr->e_shnum
+      || ehdr->e_shoff % sizeof (Elf_W (Addr)) != 0 || ehdr->e_shoff > SIZE_MAX / 2) {
+    return 0;
+  }
+  table_end = ehdr->e_shoff + (size_t) ehdr->e_shnum * sizeof (Elf_W (Shdr));
+  if (len < table_end) {
+    return table_end;
+  }
+  shdr = (const Elf_W (Shdr)*) (buf + ehdr->e_shoff);
+  strtab_shdr = &shdr[ehdr->e_shstrndx];
+  if (strtab_shdr->sh_offset + strtab_shdr->sh_size < strtab_shdr->sh_offset) {
+    return 0;
+  }
+  end = MAX (table_end, strtab_shdr->sh_offset + strtab_shdr->sh_size);
+  if (len < end) {
+    return end;
+  }
+  strtab = (const char*) buf + strtab_shdr->sh_offset;
+  for (i = 0; i < ehdr->e_shnum; i++) {
+    if (shdr[i].sh_name >= strtab_shdr->sh_size || shdr[i].sh_type == SHT_NOBITS) {
+      continue;
+    }
+    for (j = 0; sections[j] != NULL; j++) {
+      if (strncmp (strtab + shdr[i].sh_name, sections[j],
+                   strtab_shdr->sh_size - shdr[i].sh_name) == 0) {
+        end = MAX (end, shdr[i].sh_offset + shdr[i].sh_size);
+        if (shdr[i].sh_link != 0 && shdr[i].sh_link < ehdr->e_shnum) {
+          const Elf_W (Shdr)* link = &shdr[shdr[i].sh_link];
+          end = MAX (end, link->sh_offset + link->sh_size);
+        }
+        break;
+      }
+    }
+  }
+  return end;
+}
+
+static uint8_t* xz_alloc_image (size_t size, bool* mapped) {
+  uint8_t* image;
+
+  *mapped = size >= XZ_MMAP_THRESHOLD;
+  if (!*mapped) {
+    return malloc (size);
+  }
+  image = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return image != MAP_FAILED ? image : NULL;
+}
+#endif // HAVE_LZMA
+
+// Free an image returned by xz_decompress.
+HIDDEN void
+elf_w (xz_free_image) (uint8_t* image, size_t size, bool mapped) {
+  if (mapped) {
+    munmap (image, size);
+  } else {
+    free (image);
+  }
+}
+
+// Decompress the xz data SRC into a buffer returned in *DST, which must
+// be freed with xz_free_image. The buffer is allocated once, with the
+// size recorded in the xz index. If SECTIONS is not NULL, it lists the
+// names of the sections of the ELF image being decompressed that the
+// caller needs, and decompression stops once they and the section table
+// have been produced; *DST_SIZE is then the size of that prefix.
 HIDDEN bool
-elf_w (xz_decompress) (uint8_t* src, size_t src_size,
-                       uint8_t** dst, size_t* dst_size) {
+elf_w (xz_decompress) (uint8_t* src, size_t src_size, const char** sections,
+                       uint8_t** dst, size_t* dst_size, bool* dst_mapped) {
 #if HAVE_LZMA
   size_t src_offset = 0;
   size_t dst_offset = 0;
   size_t src_remaining;
   size_t dst_remaining;
+  size_t capacity, needed = SIZE_MAX;
+  bool exact;
   ISzAlloc alloc;
   CXzUnpacker state;
   ECoderStatus status;
   alloc.Alloc = xz_alloc;
   alloc.Free = xz_free;
+  xz_init_tables();
+
+  capacity = xz_uncompressed_size (src, src_size);
+  exact = capacity != 0;
+  if (exact) {
+    *dst = xz_alloc_image (capacity, dst_mapped);
+  } else {
+    // No usable index; guess and grow the buffer as needed.
+    Debug (1, "no xz index, guessing the decompressed size\n");
+    capacity = 4 * src_size;
+    *dst = malloc (capacity);
+    *dst_mapped = false;
+  }
+  if (*dst == NULL) {
+    Debug (1, "LZMA decompression failed due to failed allocation.\n");
+    return false;
+  }
   XzUnpacker_Construct(&state, &alloc);
-  CrcGenerateTable();
-  Crc64GenerateTable();
-  *dst_size = 2 * src_size;
-  *dst = NULL;
   do {
-    *dst_size *= 2;
-    *dst = realloc(*dst, *dst_size);
-    if (*dst == NULL) {
-      Debug (1, "LZMA decompression failed due to failed realloc.\n");
-      XzUnpacker_Free(&state);
-      return false;
+    bool full = dst_offset == capacity;
+    if (full && !exact) {
+      uint8_t* grown = realloc (*dst, 2 * capacity);
+      if (grown == NULL) {
+        Debug (1, "LZMA decompression failed due to failed realloc.\n");
+        goto fail;
+      }
+      *dst = grown;
+      capacity *= 2;
     }
     src_remaining = src_size - src_offset;
-    dst_remaining = *dst_size - dst_offset;
+    dst_remaining = MIN (capacity - dst_offset, XZ_CHUNK_SIZE);
     int res = XzUnpacker_Code(&state,
                               *dst + dst_offset, &dst_remaining,
                               src + src_offset, &src_remaining,
                               CODER_FINISH_ANY, &status);
     if (res != SZ_OK) {
       Debug (1, "LZMA decompression failed with error %d\n", res);
-      free(*dst);
-      XzUnpacker_Free(&state);
-      return false;
+      goto fail;
+    }
+    if (full && exact && src_remaining == 0 && status == CODER_STATUS_NOT_FINISHED) {
+      Debug (1, "LZMA decompression failed, data larger than its index says.\n");
+      goto fail;
     }
     src_offset += src_remaining;
     dst_offset += dst_remaining;
+
+    if (sections != NULL && needed != 0) {
+      if (needed == SIZE_MAX || dst_offset >= needed) {
+        needed = xz_needed_size (*dst, dst_offset, sections);
+      }
+      if (needed != 0 && needed != SIZE_MAX && dst_offset >= needed
+          && status == CODER_STATUS_NOT_FINISHED) {
+        Debug (4, "stopped decompressing after %zu bytes\n", dst_offset);
+        XzUnpacker_Free(&state);
+        goto done;
+      }
+    }
   } while (status == CODER_STATUS_NOT_FINISHED);
   XzUnpacker_Free(&state);
   if (!XzUnpacker_IsStreamWasFinished(&state)) {
     Debug (1, "LZMA decompression failed due to incomplete stream.\n");
-    free(*dst);
+    elf_w (xz_free_image) (*dst, capacity, *dst_mapped);
     return false;
   }
+
+done:
+  if (*dst_mapped) {
+    // Give back the pages past the end of what was produced.
+    size_t page_size = getpagesize ();
+    size_t used = (dst_offset + page_size - 1) & ~(page_size - 1);
+    size_t mapped = (capacity + page_size - 1) & ~(page_size - 1);
+    if (used < mapped) {
+      munmap (*dst + used, mapped - used);
+    }
+  } else if (dst_offset != 0 && dst_offset < capacity) {
+    uint8_t* shrunk = realloc (*dst, dst_offset);
+    if (shrunk != NULL) {
+      *dst = shrunk;
+    }
+  }
   *dst_size = dst_offset;
-  *dst = realloc(*dst, *dst_size);
   return true;
+
+fail:
+  XzUnpacker_Free(&state);
+  elf_w (xz_free_image) (*dst, capacity, *dst_mapped);
+  return false;
 #else
   Debug (1, "Decompression failed - compiled without LZMA support.\n");
   return false;
 #endif // HAVE_LZMA
 }
 
+// Decompressed .gnu_debugdata images, keyed by the identity of the file
+// they came from. Maps of the same file in every address space and the
+// .debug_frame loader share one entry, which lives as long as somebody
+// holds a reference to it. The decompressed image itself is kept while
+// it is in use, and afterwards only while it fits in a memory budget:
+// unused images are kept in least-recently-used order and the oldest
+// ones are freed when the cached images take more than the budget. An
+// evicted image is decompressed again the next time it is needed.
+// .debug_frame copies and indexes made from the images can't be
+// evicted (they live until the cache is flushed), so they are counted
+// separately instead of against the budget.
+struct mini_debug_info {
+  struct mini_debug_info* next;
+  struct mini_debug_info* lru_prev;	// unused images, most recent first
+  struct mini_debug_info* lru_next;
+  dev_t dev;
+  ino_t ino;
+  off_t file_size;
+  time_t file_mtime;
+  char* path;
+  unsigned int refs;	// references to the entry
+  unsigned int users;	// users of the image
+  void* data;
+  size_t size;
+  bool mapped;	// data is an anonymous mapping
+  size_t derived_size;	// copies and indexes made from the image
+};
+
+#define MINI_DEBUG_INFO_DEFAULT_BUDGET	(32 * 1024 * 1024)
+
+// The only parts of the image anybody looks at: symbols for names and
+// .debug_frame for unwinding.
+static const char* mini_debug_info_sections[] = {
+  ".symtab", ".strtab", ".debug_frame", NULL
+};
+
+static struct mini_debug_info* mini_debug_info_list;
+static struct mini_debug_info* mini_debug_info_lru_head;
+static struct mini_debug_info* mini_debug_info_lru_tail;
+static size_t mini_debug_info_bytes;
+static size_t mini_debug_info_derived_bytes;
+static size_t mini_debug_info_budget = MINI_DEBUG_INFO_DEFAULT_BUDGET;
+static bool mini_debug_info_budget_set;
+static define_lock (mini_debug_info_lock);
+
+static struct mini_debug_info* find_mini_debug_info (struct stat* st) {
+  struct mini_debug_info* mdi;
+
+  for (mdi = mini_debug_info_list; mdi != NULL; mdi = mdi->next) {
+    if (mdi->dev == st->st_dev && mdi->ino == st->st_ino
+        && mdi->file_size == st->st_size && mdi->file_mtime == st->st_mtime) {
+      return mdi;
+    }
+  }
+  return NULL;
+}
+
+static void lru_remove (struct mini_debug_info* mdi) {
+  if (mdi->lru_prev != NULL) {
+    mdi->lru_prev->lru_next = mdi->lru_next;
+  } else {
+    mini_debug_info_lru_head = mdi->lru_next;
+  }
+  if (mdi->lru_next != NULL) {
+    mdi->lru_next->lru_prev = mdi->lru_prev;
+  } else {
+    mini_debug_info_lru_tail = mdi->lru_prev;
+  }
+  mdi->lru_prev = mdi->lru_next = NULL;
+}
+
+static void lru_push (struct mini_debug_info* mdi) {
+  mdi->lru_prev = NULL;
+  mdi->lru_next = mini_debug_info_lru_head;
+  if (mini_debug_info_lru_head != NULL) {
+    mini_debug_info_lru_head->lru_prev = mdi;
+  } else {
+    mini_debug_info_lru_tail = mdi;
+  }
+  mini_debug_info_lru_head = mdi;
+}
+
+static void free_mini_debug_info (struct mini_debug_info* mdi) {
+  struct mini_debug_info** mdip;
+
+  for (mdip = &mini_debug_info_list; *mdip != mdi; mdip = &(*mdip)->next) {
+  }
+  *mdip = mdi->next;
+  free (mdi->path);
+  free (mdi);
+}
+
+// Free unused images, least recently used first, until the cache fits in
+// the budget. Entries nobody refers to any more go with their image.
+// Called with the lock held.
+static void evict_mini_debug_info (void) {
+  struct mini_debug_info* mdi;
+
+  while (mini_debug_info_bytes > mini_debug_info_budget
+         && (mdi = mini_debug_info_lru_tail) != NULL) {
+    lru_remove (mdi);
+    Debug (1, "Evicted cached .gnu_debugdata of %s\n", mdi->path);
+    mini_debug_info_bytes -= mdi->size;
+    elf_w (xz_free_image) (mdi->data, mdi->size, mdi->mapped);
+    mdi->data = NULL;
+    mdi->size = 0;
+    if (mdi->refs == 0) {
+      free_mini_debug_info (mdi);
+    }
+  }
+}
+
+// Return in *HANDLE a reference to the .gnu_debugdata of the file at
+// PATH, to be dropped with put_mini_debug_info. The image itself is only
+// decompressed by load_mini_debug_info.
+HIDDEN bool
+elf_w (get_mini_debug_info) (const char* path, void** handle) {
+  struct mini_debug_info *mdi, *new_mdi;
+  struct stat st;
+  intrmask_t saved_mask;
+
+  if (path == NULL || stat (path, &st) == -1) {
+    return false;
+  }
+
+  new_mdi = calloc (1, sizeof (*new_mdi));
+  if (new_mdi == NULL || (new_mdi->path = strdup (path)) == NULL) {
+    free (new_mdi);
+    return false;
+  }
+  new_mdi->dev = st.st_dev;
+  new_mdi->ino = st.st_ino;
+  new_mdi->file_size = st.st_size;
+  new_mdi->file_mtime = st.st_mtime;
+
+  lock_acquire (&mini_debug_info_lock, saved_mask);
+  mdi = find_mini_debug_info (&st);
+  if (mdi == NULL) {
+    new_mdi->next = mini_debug_info_list;
+    mini_debug_info_list = new_mdi;
+    mdi = new_mdi;
+    new_mdi = NULL;
+  }
+  mdi->refs++;
+  lock_release (&mini_debug_info_lock, saved_mask);
+  if (new_mdi != NULL) {
+    free (new_mdi->path);
+    free (new_mdi);
+  }
+
+  *handle = mdi;
+  return true;
+}
+
+// Drop a reference taken by get_mini_debug_info.
+HIDDEN void
+elf_w (put_mini_debug_info) (void* handle) {
+  struct mini_debug_info* mdi = handle;
+  intrmask_t saved_mask;
+
+  lock_acquire (&mini_debug_info_lock, saved_mask);
+  if (--mdi->refs == 0 && mdi->users == 0 && mdi->data == NULL) {
+    free_mini_debug_info (mdi);
+  }
+  lock_release (&mini_debug_info_lock, saved_mask);
+}
+
+// Return the decompressed image of HANDLE in *DATA and *SIZE, and keep it
+// until unload_mini_debug_info is called. EI is the file already mapped
+// in, or NULL to have it mapped temporarily if the image has to be
+// decompressed.
+HIDDEN bool
+elf_w (load_mini_debug_info) (void* handle, struct elf_image* ei,
+                              void** data, size_t* size) {
+  struct mini_debug_info* mdi = handle;
+  struct elf_image file_ei;
+  intrmask_t saved_mask;
+  uint8_t* compressed;
+  size_t compressed_len;
+  uint8_t* image;
+  size_t image_size;
+  bool image_mapped;
+  bool found;
+
+  lock_acquire (&mini_debug_info_lock, saved_mask);
+  if (mdi->users++ == 0 && mdi->data != NULL) {
+    lru_remove (mdi);
+  }
+  image = mdi->data;
+  image_size = mdi->size;
+  lock_release (&mini_debug_info_lock, saved_mask);
+  if (image != NULL) {
+    *data = image;
+    *size = image_size;
+    return true;
+  }
+
+  // Decompress without holding the lock; another thread racing to load
+  // the same image is resolved below.
+  file_ei.mapped = false;
+  if (ei == NULL && elf_map_image (&file_ei, mdi->path)) {
+    ei = &file_ei;
+  }
+  found = ei != NULL
+          && elf_w (find_section_mapped) (ei, ".gnu_debugdata", &compressed,
+                                          &compressed_len, NULL)
+          && elf_w (xz_decompress) (compressed, compressed_len, mini_debug_info_sections,
+                                    &image, &image_size, &image_mapped);
+  if (file_ei.mapped) {
+    munmap (file_ei.u.mapped.image, file_ei.u.mapped.size);
+  }
+
+  lock_acquire (&mini_debug_info_lock, saved_mask);
+  if (!found) {
+    mdi->users--;
+  } else {
+    if (mdi->data == NULL) {
+      Debug (1, "Decompressed and cached .gnu_debugdata of %s\n", mdi->path);
+      mdi->data = image;
+      mdi->size = image_size;
+      mdi->mapped = image_mapped;
+      mini_debug_info_bytes += image_size;
+      image = NULL;
+      evict_mini_debug_info ();
+    }
+    *data = mdi->data;
+    *size = mdi->size;
+  }
+  lock_release (&mini_debug_info_lock, saved_mask);
+  if (found && image != NULL) {
+    elf_w (xz_free_image) (image, image_size, image_mapped);
+  }
+  return found;
+}
+
+// Stop using an image returned by load_mini_debug_info.
+HIDDEN void
+elf_w (unload_mini_debug_info) (void* handle) {
+  struct mini_debug_info* mdi = handle;
+  intrmask_t saved_mask;
+
+  lock_acquire (&mini_debug_info_lock, saved_mask);
+  if (--mdi->users == 0) {
+    lru_push (mdi);
+    evict_mini_debug_info ();
+  }
+  lock_release (&mini_debug_info_lock, saved_mask);
+}
+
+// Count BYTES copied or indexed from the image of HANDLE, or stop
+// counting them if BYTES is negative. They are reported by
+// get_mini_debug_info_usage, but not charged against the budget.
+HIDDEN void
+elf_w (charge_mini_debug_info) (void* handle, long bytes) {
+  struct mini_debug_info* mdi = handle;
+  intrmask_t saved_mask;
+
+  lock_acquire (&mini_debug_info_lock, saved_mask);
+  mdi->derived_size += bytes;
+  mini_debug_info_derived_bytes += bytes;
+  lock_release (&mini_debug_info_lock, saved_mask);
+}
+
+// Return the bytes of decompressed images kept in *IMAGE_BYTES, and of
+// the data made from them in *DERIVED_BYTES.
+HIDDEN void
+elf_w (get_mini_debug_info_usage) (size_t* image_bytes, size_t* derived_bytes) {
+  intrmask_t saved_mask;
+
+  lock_acquire (&mini_debug_info_lock, saved_mask);
+  *image_bytes = mini_debug_info_bytes;
+  *derived_bytes = mini_debug_info_derived_bytes;
+  lock_release (&mini_debug_info_lock, saved_mask);
+}
+
+HIDDEN void
+elf_w (set_mini_debug_info_budget) (size_t bytes) {
+  intrmask_t saved_mask;
+
+  lock_acquire (&mini_debug_info_lock, saved_mask);
+  mini_debug_info_budget_set = bytes != 0;
+  mini_debug_info_budget = bytes != 0 ? bytes : MINI_DEBUG_INFO_DEFAULT_BUDGET;
+  evict_mini_debug_info ();
+  lock_release (&mini_debug_info_lock, saved_mask);
+}
+
+// Local unwinds only use the mini debug info once the application has
+// bounded its memory use by setting a budget.
+HIDDEN bool
+elf_w (local_mini_debug_info) (void) {
+  return mini_debug_info_budget_set;
+}
+
 HIDDEN bool
 elf_w (find_section_mapped) (struct elf_image *ei, const char* name,
                              uint8_t** section, size_t* size, Elf_W(Addr)* vaddr) {
@@ -567,6 +1081,7 @@ HIDDEN bool elf_w (get_proc_name_in_image) (
   Elf_W(Ehdr) ehdr;
   memset(&ehdr, 0, sizeof(ehdr));
   Elf_W(Addr) load_offset;
+  struct elf_image mdi;
   if (!elf_w (get_load_offset) (ei, segbase, mapoff, &ehdr, &load_offset)) {
     return false;
   }
@@ -577,11 +1092,10 @@ HIDDEN bool elf_w (get_proc_name_in_image) (
 
   // If the ELF image doesn't contain a match, look up the symbol in
   // the MiniDebugInfo.
-  if (ei->mapped && ei->mini_debug_info_data) {
-    struct elf_image mdi;
+  if (ei->mapped && ei->mini_debug_info
+      && elf_w (load_mini_debug_info) (ei->mini_debug_info, ei,
+                                       &mdi.u.mapped.image, &mdi.u.mapped.size)) {
     mdi.mapped = true;
-    mdi.u.mapped.image = ei->mini_debug_info_data;
-    mdi.u.mapped.size = ei->mini_debug_info_size;
     mdi.valid = elf_w (valid_object_mapped) (&mdi);
     // The ELF file might have been relocated after the debug
     // information has been compresses and embedded.
@@ -591,6 +1105,7 @@ HIDDEN bool elf_w (get_proc_name_in_image) (
       load_offset += ei_text_address - mdi_text_address;
     }
     bool ret_val = elf_w (lookup_symbol) (as, ip, &mdi, load_offset, buf, buf_len, offp, &ehdr);
+    elf_w (unload_mini_debug_info) (ei->mini_debug_info);
     return ret_val;
   }
   return false;
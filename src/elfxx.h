@@ -83,8 +83,28 @@ extern bool elf_w (get_load_base) (struct elf_image* ei, unw_word_t mapoff, unw_
 extern size_t elf_w (memory_read) (
     struct elf_image* ei, unw_word_t addr, uint8_t* buffer, size_t bytes, bool string_read);
 
-extern bool elf_w (xz_decompress) (uint8_t* src, size_t src_size,
-                                   uint8_t** dst, size_t* dst_size);
+extern bool elf_w (xz_decompress) (uint8_t* src, size_t src_size, const char** sections,
+                                   uint8_t** dst, size_t* dst_size, bool* dst_mapped);
+
+extern void elf_w (xz_free_image) (uint8_t* image, size_t size, bool mapped);
+
+extern bool elf_w (get_mini_debug_info) (const char* path, void** handle);
+
+extern void elf_w (put_mini_debug_info) (void* handle);
+
+extern bool elf_w (load_mini_debug_info) (void* handle, struct elf_image* ei,
+                                          void** data, size_t* size);
+
+extern void elf_w (unload_mini_debug_info) (void* handle);
+
+extern void elf_w (charge_mini_debug_info) (void* handle, long bytes);
+
+extern void elf_w (get_mini_debug_info_usage) (size_t* image_bytes,
+                                               size_t* derived_bytes);
+
+extern void elf_w (set_mini_debug_info_budget) (size_t bytes);
+
+extern bool elf_w (local_mini_debug_info) (void);
 
 extern bool elf_w (find_section_mapped) (struct elf_image *ei, const char* name,
                                          uint8_t** section, size_t* size, Elf_W(Addr)* vaddr);
@@ -184,8 +204,9 @@ static inline bool elf_map_cached_image (
         map->ei.u.memory.as_arg = as_arg;
         map->ei.valid = elf_w (valid_object_memory) (&map->ei);
       }
-    } else if (!local_unwind) {
-      // Do not process the compressed section for local unwinds.
+    } else if (!local_unwind || elf_w (local_mini_debug_info) ()) {
+      // Do not process the compressed section for local unwinds, unless
+      // the application has set a budget for it.
       // Uncompressing this section can consume a large amount of memory
       // and cause the unwind to take longer, which can cause problems
       // when an ANR occurs in the system. Compressed sections are
@@ -193,18 +214,12 @@ static inline bool elf_map_cached_image (
       // one of the only ways that a local trace is done, and it already
       // dumps the java stack, this information is redundant.
 
-      // Try to cache the minidebuginfo data.
-      uint8_t *compressed = NULL;
-      size_t compressed_len;
-      if (elf_w (find_section_mapped) (&map->ei, ".gnu_debugdata", &compressed,
-          &compressed_len, NULL)) {
-        if (elf_w (xz_decompress) (compressed, compressed_len,
-            (uint8_t**) &map->ei.mini_debug_info_data, &map->ei.mini_debug_info_size)) {
-          Debug (1, "Decompressed and cached .gnu_debugdata");
-        } else {
-          map->ei.mini_debug_info_data = NULL;
-          map->ei.mini_debug_info_size = 0;
-        }
+      // Remember the minidebuginfo data. It is only decompressed when a
+      // symbol lookup needs it, and shared with every other user of the
+      // same file.
+      if (!elf_w (find_section_mapped) (&map->ei, ".gnu_debugdata", NULL, NULL, NULL)
+          || !elf_w (get_mini_debug_info) (map->path, &map->ei.mini_debug_info)) {
+        map->ei.mini_debug_info = NULL;
       }
     }
     unw_word_t load_base;
@@ -35,6 +35,15 @@ unw_destroy_addr_space (unw_addr_space_t as)
   /* ANDROID support update. */
   if (as->map_list)
     map_destroy_list(as->map_list);
+  unwi_dyn_remote_free_cache (as);
+  unwi_edi_cache_free (as);
+#if !UNW_TARGET_IA64
+  dwarf_flush_cie_cache (&as->cie_cache);
+  dwarf_free_rs_cache (&as->global_cache);
+#endif
+#if UNW_TARGET_ARM
+  arm_exidx_free_copies (as);
+#endif
   /* End of ANDROID update. */
   free (as);
 #endif
@@ -111,7 +111,7 @@ intern_array (unw_addr_space_t as, unw_accessors_t *a,
     }
 
   for (i = 0; i < table_len; ++i)
-    if (fetchw (as, a, addr, data + i, arg) < 0)
+    if ((ret = fetchw (as, a, addr, data + i, arg)) < 0)
       goto out;
 
   *table_data = data;
@@ -150,75 +150,389 @@ free_dyn_info (unw_dyn_info_t *di)
     }
 }
 
+/* Remote dynamic unwind-info cache.
+
+   Each unw_dyn_info_t found on the remote list is remembered by its
+   remote address together with a copy of its fixed-size part.  When
+   the generation number of the list changes, the list is re-walked
+   and the fixed-size part of each record is read again; a record that
+   is still at the same address with the same fixed-size part keeps
+   everything that was interned for it earlier, so only the region
+   lists and tables of new or recycled records ever need to be
+   fetched.  Without caching, the list is searched for the one
+   matching record instead, see find_proc_info_uncached().  */
+
+struct unw_dyn_remote_info
+  {
+    struct unw_dyn_remote_info *next;	/* next record in list order */
+    struct unw_dyn_remote_info *hash_next;
+    unw_word_t addr;			/* remote address of the record */
+    unw_word_t data_addr;		/* remote address of regions/table */
+    int interned;			/* pointers in di.u are valid */
+    unw_dyn_info_t di;			/* local copy of the record */
+  };
+
+struct unw_dyn_remote_cache
+  {
+    pthread_mutex_t lock;
+    int valid;				/* entries match GENERATION */
+    unw_word_t list_addr;		/* remote unw_dyn_info_list_t */
+    unw_word_t generation;		/* generation of the remote list */
+    unw_word_t cache_generation;	/* as->cache_generation when filled */
+    struct unw_dyn_remote_info *first;
+  };
+
+static inline unsigned int
+hash_addr (unw_word_t addr, unsigned int nbuckets)
+{
+  return ((addr >> 4) ^ (addr >> 12)) & (nbuckets - 1);
+}
+
+static void
+free_entry (struct unw_dyn_remote_info *e)
+{
+  free_dyn_info (&e->di);
+  free (e);
+}
+
+static void
+flush_entries (struct unw_dyn_remote_cache *cache)
+{
+  struct unw_dyn_remote_info *e;
+
+  while ((e = cache->first))
+    {
+      cache->first = e->next;
+      free_entry (e);
+    }
+  cache->valid = 0;
+}
+
+static struct unw_dyn_remote_cache *
+get_cache (unw_addr_space_t as)
+{
+  struct unw_dyn_remote_cache *cache = as->dyn_remote_cache;
+
+  if (cache)
+    return cache;
+
+  cache = calloc (1, sizeof (*cache));
+  if (!cache)
+    return NULL;
+  lock_init (&cache->lock);
+
+#ifdef HAVE_CMPXCHG
+  if (!cmpxchg_ptr (&as->dyn_remote_cache, NULL, cache))
+    {
+      /* somebody else beat us to it */
+      free (cache);
+      return as->dyn_remote_cache;
+    }
+#else
+  as->dyn_remote_cache = cache;
+#endif
+  return cache;
+}
+
+/* Read the remainder of the fixed-size part of a remote unw_dyn_info_t
+   (everything after end_ip) at ADDR into DI.  *DATA_ADDR is set to the
+   remote address of the region list (UNW_INFO_FORMAT_DYNAMIC) or of
+   the table (UNW_INFO_FORMAT_TABLE), i.e., of whatever
+   intern_dyn_data() will have to fetch later.  */
+
 static int
-intern_dyn_info (unw_addr_space_t as, unw_accessors_t *a,
-		 unw_word_t *addr, unw_dyn_info_t *di, void *arg)
+fetch_dyn_info_header (unw_addr_space_t as, unw_accessors_t *a,
+		       unw_word_t addr, unw_dyn_info_t *di,
+		       unw_word_t *data_addr, void *arg)
 {
-  unw_word_t first_region;
   int ret;
 
+  *data_addr = 0;
+
+  if ((ret = fetchw (as, a, &addr, &di->gp, arg)) < 0
+      || (ret = fetch32 (as, a, &addr, &di->format, arg)) < 0)
+    return ret;
+
+  addr += 4;	/* skip over padding */
+
   switch (di->format)
     {
     case UNW_INFO_FORMAT_DYNAMIC:
-      if ((ret = fetchw (as, a, addr, &di->u.pi.name_ptr, arg)) < 0
-	  || (ret = fetchw (as, a, addr, &di->u.pi.handler, arg)) < 0
-	  || (ret = fetch32 (as, a, addr,
+      if ((ret = fetchw (as, a, &addr, &di->u.pi.name_ptr, arg)) < 0
+	  || (ret = fetchw (as, a, &addr, &di->u.pi.handler, arg)) < 0
+	  || (ret = fetch32 (as, a, &addr,
 			     (int32_t *) &di->u.pi.flags, arg)) < 0)
-	goto out;
-      *addr += 4;	/* skip over pad0 */
-      if ((ret = fetchw (as, a, addr, &first_region, arg)) < 0
-	  || (ret = intern_regions (as, a, &first_region, &di->u.pi.regions,
-				    arg)) < 0)
-	goto out;
+	return ret;
+      addr += 4;	/* skip over pad0 */
+      return fetchw (as, a, &addr, data_addr, arg);
+
+    case UNW_INFO_FORMAT_TABLE:
+      if ((ret = fetchw (as, a, &addr, &di->u.ti.name_ptr, arg)) < 0
+	  || (ret = fetchw (as, a, &addr, &di->u.ti.segbase, arg)) < 0
+	  || (ret = fetchw (as, a, &addr, &di->u.ti.table_len, arg)) < 0)
+	return ret;
+      *data_addr = addr;
+      return 0;
+
+    case UNW_INFO_FORMAT_REMOTE_TABLE:
+      if ((ret = fetchw (as, a, &addr, &di->u.rti.name_ptr, arg)) < 0
+	  || (ret = fetchw (as, a, &addr, &di->u.rti.segbase, arg)) < 0
+	  || (ret = fetchw (as, a, &addr, &di->u.rti.table_len, arg)) < 0
+	  || (ret = fetchw (as, a, &addr, &di->u.rti.table_data, arg)) < 0)
+	return ret;
+      return 0;
+
+    default:
+      /* unknown format: keep the entry, lookups will reject it */
+      return 0;
+    }
+}
+
+/* Return 1 if the fixed-size part HDR, with its data at DATA_ADDR, is
+   the one E was created from.  */
+
+static int
+same_header (const struct unw_dyn_remote_info *e, const unw_dyn_info_t *hdr,
+	     unw_word_t data_addr)
+{
+  const unw_dyn_info_t *di = &e->di;
+
+  if (di->start_ip != hdr->start_ip || di->end_ip != hdr->end_ip
+      || di->gp != hdr->gp || di->format != hdr->format
+      || e->data_addr != data_addr)
+    return 0;
+
+  switch (di->format)
+    {
+    case UNW_INFO_FORMAT_DYNAMIC:
+      return (di->u.pi.name_ptr == hdr->u.pi.name_ptr
+	      && di->u.pi.handler == hdr->u.pi.handler
+	      && di->u.pi.flags == hdr->u.pi.flags);
+
+    case UNW_INFO_FORMAT_TABLE:
+      return (di->u.ti.name_ptr == hdr->u.ti.name_ptr
+	      && di->u.ti.segbase == hdr->u.ti.segbase
+	      && di->u.ti.table_len == hdr->u.ti.table_len);
+
+    case UNW_INFO_FORMAT_REMOTE_TABLE:
+      return (di->u.rti.name_ptr == hdr->u.rti.name_ptr
+	      && di->u.rti.segbase == hdr->u.rti.segbase
+	      && di->u.rti.table_len == hdr->u.rti.table_len
+	      && di->u.rti.table_data == hdr->u.rti.table_data);
+
+    default:
+      return 1;
+    }
+}
+
+/* Fetch the variable-sized data (region list or table) of E.  */
+
+static int
+intern_dyn_data (unw_addr_space_t as, unw_accessors_t *a,
+		 struct unw_dyn_remote_info *e, void *arg)
+{
+  unw_word_t addr = e->data_addr;
+  int ret;
+
+  switch (e->di.format)
+    {
+    case UNW_INFO_FORMAT_DYNAMIC:
+      ret = intern_regions (as, a, &addr, &e->di.u.pi.regions, arg);
       break;
 
     case UNW_INFO_FORMAT_TABLE:
-      if ((ret = fetchw (as, a, addr, &di->u.ti.name_ptr, arg)) < 0
-	  || (ret = fetchw (as, a, addr, &di->u.ti.segbase, arg)) < 0
-	  || (ret = fetchw (as, a, addr, &di->u.ti.table_len, arg)) < 0
-	  || (ret = intern_array (as, a, addr, di->u.ti.table_len,
-				  &di->u.ti.table_data, arg)) < 0)
-	goto out;
+      ret = intern_array (as, a, &addr, e->di.u.ti.table_len,
+			  &e->di.u.ti.table_data, arg);
       break;
 
     case UNW_INFO_FORMAT_REMOTE_TABLE:
-      if ((ret = fetchw (as, a, addr, &di->u.rti.name_ptr, arg)) < 0
-	  || (ret = fetchw (as, a, addr, &di->u.rti.segbase, arg)) < 0
-	  || (ret = fetchw (as, a, addr, &di->u.rti.table_len, arg)) < 0
-	  || (ret = fetchw (as, a, addr, &di->u.rti.table_data, arg)) < 0)
-	goto out;
+      ret = 0;
       break;
 
     default:
-      ret = -UNW_ENOINFO;
-      goto out;
+      return -UNW_ENOINFO;
     }
-  return 0;
 
- out:
-  free_dyn_info (di);
+  if (ret >= 0)
+    e->interned = 1;
   return ret;
 }
 
-HIDDEN int
-unwi_dyn_remote_find_proc_info (unw_addr_space_t as, unw_word_t ip,
-				unw_proc_info_t *pi,
-				int need_unwind_info, void *arg)
+static int
+dup_regions (unw_dyn_region_info_t *src, unw_dyn_region_info_t **dstp)
 {
-  unw_accessors_t *a = unw_get_accessors (as);
-  unw_word_t dyn_list_addr, addr, next_addr, gen1, gen2, start_ip, end_ip;
-  unw_dyn_info_t *di = NULL;
-  int ret;
+  unw_dyn_region_info_t *region, **tail = dstp;
+  size_t size;
 
-  if (as->dyn_info_list_addr)
-    dyn_list_addr = as->dyn_info_list_addr;
-  else
+  *dstp = NULL;
+  for (; src; src = src->next)
     {
-      if ((*a->get_dyn_info_list_addr) (as, &dyn_list_addr, arg) < 0)
+      size = _U_dyn_region_info_size (src->op_count);
+      region = malloc (size);
+      if (!region)
+	{
+	  if (*dstp)
+	    free_regions (*dstp);
+	  *dstp = NULL;
+	  return -UNW_ENOMEM;
+	}
+      memcpy (region, src, size);
+      region->next = NULL;
+      *tail = region;
+      tail = &region->next;
+    }
+  return 0;
+}
+
+/* Bring the entries of CACHE in sync with the remote list.  Records
+   that are still present and unchanged are carried over as-is.  */
+
+static int
+update_cache (unw_addr_space_t as, unw_accessors_t *a,
+	      struct unw_dyn_remote_cache *cache, void *arg)
+{
+  struct unw_dyn_remote_info *e, **hash, **tail, **pp;
+  unw_word_t addr, rec_addr, next_addr, data_addr, gen1, gen2;
+  unsigned int i, nbuckets, count;
+  unw_dyn_info_t hdr;
+  int ret, complete;
+
+  do
+    {
+      addr = cache->list_addr;
+
+      if (fetchw (as, a, &addr, &gen1, arg) < 0
+	  || fetchw (as, a, &addr, &next_addr, arg) < 0)
 	return -UNW_ENOINFO;
-      if (as->caching_policy != UNW_CACHE_NONE)
-	as->dyn_info_list_addr = dyn_list_addr;
+
+      /* Hash the existing entries by remote address so that each
+	 record on the list can be matched in constant time.  */
+      for (count = 0, e = cache->first; e; e = e->next)
+	++count;
+      for (nbuckets = 1; nbuckets < count; nbuckets <<= 1)
+	;
+      hash = calloc (nbuckets, sizeof (*hash));
+      if (!hash)
+	return -UNW_ENOMEM;
+
+      while ((e = cache->first))
+	{
+	  cache->first = e->next;
+	  i = hash_addr (e->addr, nbuckets);
+	  e->hash_next = hash[i];
+	  hash[i] = e;
+	}
+      cache->valid = 0;
+      tail = &cache->first;
+
+      ret = -UNW_ENOINFO;
+
+      for (addr = next_addr; addr != 0; addr = next_addr)
+	{
+	  rec_addr = addr;
+
+	  if (fetchw (as, a, &addr, &next_addr, arg) < 0)
+	    goto recheck;	/* only fail if generation # didn't change */
+
+	  addr += WSIZE;	/* skip over prev_addr */
+
+	  memset (&hdr, 0, sizeof (hdr));
+	  if (fetchw (as, a, &addr, &hdr.start_ip, arg) < 0
+	      || fetchw (as, a, &addr, &hdr.end_ip, arg) < 0
+	      || fetch_dyn_info_header (as, a, addr, &hdr, &data_addr, arg) < 0)
+	    goto recheck;	/* only fail if generation # didn't change */
+
+	  for (pp = &hash[hash_addr (rec_addr, nbuckets)]; (e = *pp) != NULL;
+	       pp = &e->hash_next)
+	    if (e->addr == rec_addr)
+	      {
+		*pp = e->hash_next;
+		break;
+	      }
+
+	  /* A registered record must not be modified in place, so a
+	     record we already know about is only re-read if its
+	     fixed-size part changed (i.e., the memory got recycled for
+	     a different record, possibly for the same range).  */
+	  if (e && !same_header (e, &hdr, data_addr))
+	    {
+	      free_entry (e);
+	      e = NULL;
+	    }
+
+	  if (!e)
+	    {
+	      e = calloc (1, sizeof (*e));
+	      if (!e)
+		{
+		  ret = -UNW_ENOMEM;
+		  goto recheck;
+		}
+	      e->addr = rec_addr;
+	      e->data_addr = data_addr;
+	      e->di = hdr;
+	    }
+
+	  e->next = NULL;
+	  *tail = e;
+	  tail = &e->next;
+	}
+      ret = 0;
+
+      /* Re-check generation number to ensure the data we have is
+	 consistent.  */
+    recheck:
+      addr = cache->list_addr;
+      if (fetchw (as, a, &addr, &gen2, arg) < 0)
+	{
+	  gen2 = gen1;
+	  ret = -UNW_ENOINFO;
+	}
+      complete = (ret >= 0 && gen1 == gen2);
+
+      /* Entries that were not matched belong to records that have
+	 been removed from the list.  If the walk did not finish,
+	 keep them around so that the next walk can still match
+	 them.  */
+      for (i = 0; i < nbuckets; ++i)
+	while ((e = hash[i]))
+	  {
+	    hash[i] = e->hash_next;
+	    if (complete)
+	      free_entry (e);
+	    else
+	      {
+		e->next = NULL;
+		*tail = e;
+		tail = &e->next;
+	      }
+	  }
+      free (hash);
     }
+  while (gen1 != gen2);
+
+  if (ret < 0)
+    return ret;
+
+  cache->generation = gen1;
+  cache->valid = 1;
+  return 0;
+}
+
+/* Look up IP without the cache: walk the list and read the rest of a
+   record only once its range matches, as unwinding did before the
+   cache existed.  A remote address space does not cache by default, so
+   this must not read or allocate more than that.  */
+
+static int
+find_proc_info_uncached (unw_addr_space_t as, unw_accessors_t *a,
+			 unw_word_t dyn_list_addr, unw_word_t ip,
+			 unw_proc_info_t *pi, int need_unwind_info, void *arg)
+{
+  unw_word_t addr, next_addr, start_ip, end_ip, gen1, gen2;
+  struct unw_dyn_remote_info e;
+  unw_dyn_info_t *di;
+  int ret;
 
   do
     {
@@ -241,33 +555,49 @@ unwi_dyn_remote_find_proc_info (unw_addr_space_t as, unw_word_t ip,
 	      || fetchw (as, a, &addr, &end_ip, arg) < 0)
 	    goto recheck;	/* only fail if generation # didn't change */
 
-	  if (ip >= start_ip && ip < end_ip)
-	    {
-	      if (!di)
-		di = calloc (1, sizeof (*di));
-
-	      di->start_ip = start_ip;
-	      di->end_ip = end_ip;
-
-	      if (fetchw (as, a, &addr, &di->gp, arg) < 0
-		  || fetch32 (as, a, &addr, &di->format, arg) < 0)
-		goto recheck;	/* only fail if generation # didn't change */
+	  if (ip < start_ip || ip >= end_ip)
+	    continue;
 
-	      addr += 4;	/* skip over padding */
+	  memset (&e, 0, sizeof (e));
+	  e.di.start_ip = start_ip;
+	  e.di.end_ip = end_ip;
+	  if (fetch_dyn_info_header (as, a, addr, &e.di, &e.data_addr, arg) < 0)
+	    goto recheck;	/* only fail if generation # didn't change */
 
-	      if (need_unwind_info
-		  && intern_dyn_info (as, a, &addr, di, arg) < 0)
-		goto recheck;	/* only fail if generation # didn't change */
+	  /* Tables are needed for the lookup itself; region lists only
+	     when the caller wants the unwind info.  */
+	  if ((need_unwind_info || e.di.format == UNW_INFO_FORMAT_TABLE)
+	      && intern_dyn_data (as, a, &e, arg) < 0)
+	    {
+	      free_dyn_info (&e.di);
+	      goto recheck;	/* only fail if generation # didn't change */
+	    }
 
-	      if (unwi_extract_dynamic_proc_info (as, ip, pi, di,
-						  need_unwind_info, arg) < 0)
+	  /* pi->unwind_info belongs to the caller until it is handed
+	     back to unwi_dyn_remote_put_unwind_info().  */
+	  if (e.di.format == UNW_INFO_FORMAT_DYNAMIC && need_unwind_info)
+	    {
+	      di = malloc (sizeof (*di));
+	      if (!di)
 		{
-		  free_dyn_info (di);
-		  goto recheck;	/* only fail if generation # didn't change */
+		  free_dyn_info (&e.di);
+		  return -UNW_ENOMEM;
 		}
-	      ret = 0;	/* OK, found it */
-	      break;
+	      *di = e.di;
+	    }
+	  else
+	    di = &e.di;
+
+	  ret = unwi_extract_dynamic_proc_info (as, ip, pi, di,
+						need_unwind_info, arg);
+	  if (di == &e.di)
+	    free_dyn_info (&e.di);
+	  else if (ret < 0)
+	    {
+	      free_dyn_info (di);
+	      free (di);
 	    }
+	  break;
 	}
 
       /* Re-check generation number to ensure the data we have is
@@ -275,16 +605,157 @@ unwi_dyn_remote_find_proc_info (unw_addr_space_t as, unw_word_t ip,
     recheck:
       addr = dyn_list_addr;
       if (fetchw (as, a, &addr, &gen2, arg) < 0)
-	return ret;
+	gen2 = gen1;
+      if (gen1 != gen2 && ret >= 0)
+	{
+	  /* what we found may be stale; look again */
+	  if (need_unwind_info)
+	    unwi_put_dynamic_unwind_info (as, pi, arg);
+	  ret = -UNW_ENOINFO;
+	}
     }
   while (gen1 != gen2);
 
-  if (ret < 0 && di)
-    free (di);
+  return ret;
+}
+
+HIDDEN int
+unwi_dyn_remote_find_proc_info (unw_addr_space_t as, unw_word_t ip,
+				unw_proc_info_t *pi,
+				int need_unwind_info, void *arg)
+{
+  unw_accessors_t *a = unw_get_accessors (as);
+  unw_word_t dyn_list_addr, addr, gen;
+  struct unw_dyn_remote_cache *cache;
+  struct unw_dyn_remote_info *e;
+  intrmask_t saved_mask;
+  unw_dyn_info_t *di;
+  int ret;
+
+  if (as->dyn_info_list_addr)
+    dyn_list_addr = as->dyn_info_list_addr;
+  else
+    {
+      if ((*a->get_dyn_info_list_addr) (as, &dyn_list_addr, arg) < 0)
+	return -UNW_ENOINFO;
+      if (as->caching_policy != UNW_CACHE_NONE)
+	as->dyn_info_list_addr = dyn_list_addr;
+    }
+
+  if (as->caching_policy == UNW_CACHE_NONE)
+    return find_proc_info_uncached (as, a, dyn_list_addr, ip, pi,
+				    need_unwind_info, arg);
+
+  if (!(cache = get_cache (as)))
+    return -UNW_ENOMEM;
+
+  lock_acquire (&cache->lock, saved_mask);
+
+  /* unw_flush_cache() means that anything we copied may be stale, no
+     matter what the list headers say.  */
+  if (cache->list_addr != dyn_list_addr
+      || cache->cache_generation != as->cache_generation)
+    {
+      flush_entries (cache);
+      cache->list_addr = dyn_list_addr;
+      cache->cache_generation = as->cache_generation;
+    }
+
+  for (;;)
+    {
+      addr = dyn_list_addr;
+      if (fetchw (as, a, &addr, &gen, arg) < 0)
+	{
+	  ret = -UNW_ENOINFO;
+	  goto out;
+	}
+
+      if ((!cache->valid || gen != cache->generation)
+	  && (ret = update_cache (as, a, cache, arg)) < 0)
+	goto out;
+
+      for (e = cache->first; e; e = e->next)
+	if (ip >= e->di.start_ip && ip < e->di.end_ip)
+	  break;
+
+      if (!e)
+	{
+	  ret = -UNW_ENOINFO;
+	  goto out;
+	}
+
+      /* Tables are needed for the lookup itself; region lists only
+	 when the caller wants the unwind info.  */
+      if (e->interned
+	  || !(need_unwind_info || e->di.format == UNW_INFO_FORMAT_TABLE))
+	break;
+
+      ret = intern_dyn_data (as, a, e, arg);
 
+      addr = dyn_list_addr;
+      if (fetchw (as, a, &addr, &gen, arg) < 0)
+	{
+	  ret = -UNW_ENOINFO;
+	  goto out;
+	}
+      if (gen == cache->generation)
+	{
+	  if (ret < 0)
+	    goto out;
+	  break;
+	}
+
+      /* The list changed under us; E may be gone or half-written.  */
+      free_dyn_info (&e->di);
+      e->interned = 0;
+      cache->valid = 0;
+    }
+
+  if (e->di.format == UNW_INFO_FORMAT_DYNAMIC && need_unwind_info)
+    {
+      /* pi->unwind_info belongs to the caller until it is handed back
+	 to unwi_dyn_remote_put_unwind_info(), so give out a copy.  */
+      di = malloc (sizeof (*di));
+      if (!di)
+	{
+	  ret = -UNW_ENOMEM;
+	  goto out;
+	}
+      *di = e->di;
+      if ((ret = dup_regions (e->di.u.pi.regions, &di->u.pi.regions)) < 0)
+	{
+	  free (di);
+	  goto out;
+	}
+    }
+  else
+    di = &e->di;
+
+  ret = unwi_extract_dynamic_proc_info (as, ip, pi, di, need_unwind_info, arg);
+  if (ret < 0 && di != &e->di)
+    {
+      free_dyn_info (di);
+      free (di);
+    }
+
+ out:
+  lock_release (&cache->lock, saved_mask);
   return ret;
 }
 
+HIDDEN void
+unwi_dyn_remote_free_cache (unw_addr_space_t as)
+{
+  struct unw_dyn_remote_cache *cache = as->dyn_remote_cache;
+
+  if (!cache)
+    return;
+
+  flush_entries (cache);
+  free (cache);
+  as->dyn_remote_cache = NULL;
+}
+
 HIDDEN void
 unwi_dyn_remote_put_unwind_info (unw_addr_space_t as, unw_proc_info_t *pi,
 				 void *arg)
@@ -322,5 +793,10 @@ unwi_dyn_validate_cache (unw_addr_space_t as, void *arg)
 
   unw_flush_cache (as, 0, 0);
   as->dyn_generation = gen;
+
+  /* The remote dyn-info cache revalidates its entries against the new
+     generation by itself; don't let this flush throw them away.  */
+  if (as->dyn_remote_cache)
+    as->dyn_remote_cache->cache_generation = as->cache_generation;
   return -1;
 }
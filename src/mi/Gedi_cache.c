@@ -0,0 +1,261 @@
+/* libunwind - a platform-independent unwind library
+   Copyright (C) 2014 The Android Open Source Project
+
+This file is part of libunwind.
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
+
+#include "libunwind_i.h"
+
+/* A cache of the unwind tables that tdep_find_unwind_table() found for
+   the ELF images of a remote address space.  The entries are sorted by
+   start address and do not overlap, so a lookup is a binary search.
+
+   Without it, an unwinder that keeps a single elf_dyn_info has to look
+   up the tables again every time the IP moves to a different image,
+   and a typical backtrace moves between a handful of images many
+   times.
+
+   The entries are discarded lazily when the cache generation of the
+   address space changes (unw_flush_cache(), unw_set_caching_policy()).
+   The .debug_frame tables (di_debug) are loaded into, and owned by, the
+   local address space, so a flush of that one discards them as well.  */
+
+/* Compute the address range covered by the valid tables of EDI.
+   Returns 0 if EDI has no valid table.  */
+static int
+edi_range (const struct elf_dyn_info *edi, unw_word_t *start, unw_word_t *end)
+{
+  const unw_dyn_info_t *tables[] =
+    {
+      &edi->di_cache, &edi->di_debug,
+#if UNW_TARGET_ARM
+      &edi->di_arm,
+#endif
+    };
+  unsigned int i;
+  int found = 0;
+
+  for (i = 0; i < sizeof (tables) / sizeof (tables[0]); ++i)
+    {
+      if (tables[i]->format == -1)
+	continue;
+      if (!found || tables[i]->start_ip < *start)
+	*start = tables[i]->start_ip;
+      if (!found || tables[i]->end_ip > *end)
+	*end = tables[i]->end_ip;
+      found = 1;
+    }
+  return found;
+}
+
+/* Return the index of the first entry that ends above IP.  */
+static unsigned int
+search (struct elf_dyn_info_cache *cache, unw_word_t ip)
+{
+  unsigned int lo = 0, hi = cache->num_entries, mid;
+
+  while (lo < hi)
+    {
+      mid = (lo + hi) / 2;
+      if (cache->entries[mid].end_ip <= ip)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  return lo;
+}
+
+/* Return the generation the tables found for AS belong to.  It changes
+   whenever the cache generation of AS or of the local address space
+   does; both only ever increase, so their sum does too.  */
+
+PROTECTED unw_word_t
+unwi_edi_cache_generation (unw_addr_space_t as)
+{
+  unw_word_t generation = atomic_read (&as->cache_generation);
+
+#ifndef UNW_REMOTE_ONLY
+  if (as != unw_local_addr_space)
+    generation += atomic_read (&unw_local_addr_space->cache_generation);
+#endif
+  return generation;
+}
+
+PROTECTED void
+unwi_edi_cache_init (struct elf_dyn_info_cache *cache)
+{
+  memset (cache, 0, sizeof (*cache));
+  lock_rdwr_init (&cache->lock);
+}
+
+PROTECTED void
+unwi_edi_cache_fini (struct elf_dyn_info_cache *cache)
+{
+  free (cache->entries);
+  cache->entries = NULL;
+  cache->num_entries = cache->max_entries = 0;
+  pthread_rwlock_destroy (&cache->lock);
+}
+
+/* Look up the tables covering IP.  On a hit, the tables are copied to
+   EDI and 0 is returned.  Other members of EDI are left alone.  */
+
+PROTECTED int
+unwi_edi_cache_lookup (unw_addr_space_t as, struct elf_dyn_info_cache *cache,
+		       unw_word_t ip, struct elf_dyn_info *edi)
+{
+  struct elf_dyn_info_cache_entry *e;
+  intrmask_t saved_mask;
+  int ret = -UNW_ENOINFO;
+  unsigned int i;
+
+  lock_rdwr_rd_acquire (&cache->lock, saved_mask);
+  if (cache->generation == unwi_edi_cache_generation (as))
+    {
+      i = search (cache, ip);
+      e = cache->entries + i;
+      if (i < cache->num_entries && e->start_ip <= ip)
+	{
+	  edi->di_cache = e->edi.di_cache;
+	  edi->di_debug = e->edi.di_debug;
+#if UNW_TARGET_ARM
+	  edi->di_arm = e->edi.di_arm;
+#endif
+	  ret = 0;
+	}
+    }
+  lock_rdwr_release (&cache->lock, saved_mask);
+  return ret;
+}
+
+/* Add the tables of EDI, which were just found by
+   tdep_find_unwind_table(), to the cache.  GENERATION is what
+   unwi_edi_cache_generation() returned before the search; if the
+   caches were flushed since, the tables may be stale and are not
+   added.  Entries that overlap them are stale (the image was unmapped
+   and something else mapped in its place) and are dropped.  Failure
+   to grow the cache is not an error; the tables simply are not
+   cached.  */
+
+PROTECTED void
+unwi_edi_cache_insert (unw_addr_space_t as, struct elf_dyn_info_cache *cache,
+		       const struct elf_dyn_info *edi, unw_word_t generation)
+{
+  struct elf_dyn_info_cache_entry *e;
+  unw_word_t start, end;
+  unsigned int i, j, max;
+  intrmask_t saved_mask;
+
+  if (!edi_range (edi, &start, &end))
+    return;
+
+  lock_rdwr_wr_acquire (&cache->lock, saved_mask);
+
+  if (generation != unwi_edi_cache_generation (as))
+    goto out;
+  if (cache->generation != generation)
+    {
+      cache->num_entries = 0;
+      cache->generation = generation;
+    }
+
+  i = search (cache, start);
+  for (j = i; j < cache->num_entries && cache->entries[j].start_ip < end; ++j)
+    ;
+  if (j > i)
+    {
+      memmove (cache->entries + i, cache->entries + j,
+	       (cache->num_entries - j) * sizeof (*e));
+      cache->num_entries -= j - i;
+    }
+
+  if (cache->num_entries == cache->max_entries)
+    {
+      max = cache->max_entries ? 2 * cache->max_entries : 16;
+      e = realloc (cache->entries, max * sizeof (*e));
+      if (!e)
+	goto out;
+      cache->entries = e;
+      cache->max_entries = max;
+    }
+
+  e = cache->entries + i;
+  memmove (e + 1, e, (cache->num_entries - i) * sizeof (*e));
+  ++cache->num_entries;
+
+  memset (e, 0, sizeof (*e));
+  e->start_ip = start;
+  e->end_ip = end;
+  e->edi.di_cache = edi->di_cache;
+  e->edi.di_debug = edi->di_debug;
+  /* The names point into the path of the image, which the caller is
+     about to free.  */
+  e->edi.di_debug.u.ti.name_ptr = 0;
+#if UNW_TARGET_ARM
+  e->edi.di_arm = edi->di_arm;
+  e->edi.di_arm.u.rti.name_ptr = 0;
+#endif
+
+ out:
+  lock_rdwr_release (&cache->lock, saved_mask);
+}
+
+/* Return the cache shared by all users of AS, creating it on first use.  */
+
+PROTECTED struct elf_dyn_info_cache *
+unwi_edi_cache_get (unw_addr_space_t as)
+{
+  struct elf_dyn_info_cache *cache = as->edi_cache;
+
+  if (cache)
+    return cache;
+
+  cache = malloc (sizeof (*cache));
+  if (!cache)
+    return NULL;
+  unwi_edi_cache_init (cache);
+
+#ifdef HAVE_CMPXCHG
+  if (!cmpxchg_ptr (&as->edi_cache, NULL, cache))
+    {
+      /* somebody else beat us to it */
+      unwi_edi_cache_fini (cache);
+      free (cache);
+      return as->edi_cache;
+    }
+#else
+  as->edi_cache = cache;
+#endif
+  return cache;
+}
+
+HIDDEN void
+unwi_edi_cache_free (unw_addr_space_t as)
+{
+  struct elf_dyn_info_cache *cache = as->edi_cache;
+
+  if (!cache)
+    return;
+
+  unwi_edi_cache_fini (cache);
+  free (cache);
+  as->edi_cache = NULL;
+}
@@ -0,0 +1,56 @@
+/* libunwind - a platform-independent unwind library
+   Copyright (C) 2014 The Android Open Source Project
+
+This file is part of libunwind.
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
+
+#include "libunwind_i.h"
+
+PROTECTED int
+unw_set_cache_size (unw_addr_space_t as, size_t size, int flag)
+{
+#if !UNW_TARGET_IA64
+  unsigned short log_size;
+#endif
+
+  if (!tdep_init_done)
+    tdep_init ();
+
+  if (flag != 0)
+    return -UNW_EINVAL;
+
+#if UNW_TARGET_IA64
+  /* The ia64 script cache has a fixed size.  */
+  return -UNW_EINVAL;
+#else
+  /* Zero restores the default size, which grows with the miss rate.  */
+  if (size == 0)
+    return dwarf_set_rs_cache_size (&as->global_cache,
+				    DWARF_LOG_RS_SHARD_SIZE, 0);
+
+  /* Round up to a power of two per shard.  */
+  for (log_size = 0; log_size < DWARF_LOG_RS_SHARD_MAX_SIZE; ++log_size)
+    if (((size_t) DWARF_RS_CACHE_SHARDS << log_size) >= size)
+      break;
+
+  return dwarf_set_rs_cache_size (&as->global_cache, log_size, 1);
+#endif
+}
@@ -39,46 +39,197 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
 # define MAX_ALIGN	MAX_ALIGN_(sizeof (long double))
 #endif
 
+/* ANDROID support update. */
+/* SOS memory is an arena of chunks.  The first chunk is static, so
+   that some memory is available even when mmap() fails; further chunks
+   are mapped SOS_CHUNK_SIZE bytes at a time, or larger for a large
+   request.  Allocations are carved off the current chunk.  A chunk
+   whose allocations have all been returned with sos_free() is unmapped
+   unless it is the current or the static chunk, which are reused.  */
+struct sos_chunk
+  {
+    struct sos_chunk *next;
+    char *mem;		/* first usable byte, MAX_ALIGN aligned */
+    size_t size;	/* usable bytes */
+    size_t pos;		/* offset of the first free byte */
+    size_t live;	/* bytes handed out and not yet returned */
+    size_t mapped_size;	/* size of the mapping, 0 for the static chunk */
+  };
+
 static char sos_memory[SOS_MEMORY_SIZE] ALIGNED(MAX_ALIGN);
-static size_t sos_memory_freepos;
+static struct sos_chunk sos_static_chunk =
+  {
+    NULL, sos_memory, SOS_MEMORY_SIZE, 0, 0, 0
+  };
+static struct sos_chunk *sos_chunks = &sos_static_chunk;
+static struct sos_chunk *sos_current = &sos_static_chunk;
+static size_t sos_mapped = SOS_MEMORY_SIZE;
+static size_t sos_in_use;
+static define_lock (sos_lock);
 static size_t pg_size;
 
+/* The arena is used by signal handlers that unwind, for instance to
+   set up a thread's magazines.  A handler that interrupts the holder
+   of the lock would deadlock on it, so signals are blocked while it is
+   held, even where lock_acquire() leaves them alone because
+   CONFIG_BLOCK_SIGNALS is not defined.  */
+static void
+sos_lock_acquire (intrmask_t *saved_mask)
+{
+  intrmask_t full_mask;
+
+  sigfillset (&full_mask);
+  sigprocmask (SIG_SETMASK, &full_mask, saved_mask);
+  mutex_lock (&sos_lock);
+}
+
+static void
+sos_lock_release (intrmask_t *saved_mask)
+{
+  mutex_unlock (&sos_lock);
+  sigprocmask (SIG_SETMASK, saved_mask, NULL);
+}
+
+/* Must be called while holding the sos lock.  */
+static struct sos_chunk *
+sos_new_chunk (size_t size)
+{
+  size_t hdr_size = UNW_ALIGN(sizeof (struct sos_chunk), MAX_ALIGN);
+  size_t mapped_size;
+  struct sos_chunk *c;
+
+  if (pg_size == 0)
+    pg_size = getpagesize ();
+
+  mapped_size = UNW_ALIGN(hdr_size + size, pg_size);
+  if (mapped_size < SOS_CHUNK_SIZE)
+    mapped_size = SOS_CHUNK_SIZE;
+
+  GET_MEMORY (c, mapped_size);
+  if (!c)
+    return NULL;
+
+  c->mem = (char *) c + hdr_size;
+  c->size = mapped_size - hdr_size;
+  c->pos = 0;
+  c->live = 0;
+  c->mapped_size = mapped_size;
+  c->next = sos_chunks;
+  sos_chunks = c;
+  sos_mapped += mapped_size;
+  Debug (5, "new sos chunk %p of %zu bytes, %zu mapped\n", c, mapped_size,
+	 sos_mapped);
+  return c;
+}
+
+/* Must be called while holding the sos lock.  */
+static void
+sos_release_chunk (struct sos_chunk *c)
+{
+  struct sos_chunk **pp;
+
+  if (!c->mapped_size)
+    return;
+
+  for (pp = &sos_chunks; *pp != c; pp = &(*pp)->next)
+    ;
+  *pp = c->next;
+  sos_mapped -= c->mapped_size;
+  Debug (5, "released sos chunk %p, %zu mapped\n", c, sos_mapped);
+  munmap (c, c->mapped_size);
+}
+
 HIDDEN void *
 sos_alloc (size_t size)
 {
-  size_t pos;
+  intrmask_t saved_mask;
+  struct sos_chunk *c, *old;
+  void *mem = NULL;
 
   size = UNW_ALIGN(size, MAX_ALIGN);
 
-#if defined(__GNUC__) && defined(HAVE_FETCH_AND_ADD)
-  /* Assume `sos_memory' is suitably aligned. */
-  assert(((uintptr_t) &sos_memory[0] & (MAX_ALIGN-1)) == 0);
+  sos_lock_acquire (&saved_mask);
+  {
+    c = sos_current;
+    if (c->size - c->pos < size)
+      {
+	/* Any chunk with room will do, otherwise map a new one.  */
+	for (c = sos_chunks; c; c = c->next)
+	  if (c->size - c->pos >= size)
+	    break;
+	if (!c)
+	  c = sos_new_chunk (size);
+
+	/* A large request does not retire the current chunk, which
+	   still has room for small ones.  */
+	if (c && size <= SOS_CHUNK_SIZE / 4 && c != sos_current)
+	  {
+	    old = sos_current;
+	    sos_current = c;
+	    if (!old->live)
+	      {
+		old->pos = 0;
+		sos_release_chunk (old);
+	      }
+	  }
+      }
 
-  pos = fetch_and_add (&sos_memory_freepos, size);
-#else
-  static define_lock (sos_lock);
+    if (c)
+      {
+	mem = c->mem + c->pos;
+	c->pos += size;
+	c->live += size;
+	sos_in_use += size;
+      }
+  }
+  sos_lock_release (&saved_mask);
+
+  if (!mem)
+    Debug (1, "out of SOS memory for %zu bytes\n", size);
+  return mem;
+}
+
+HIDDEN void
+sos_free (void *mem, size_t size)
+{
   intrmask_t saved_mask;
+  struct sos_chunk *c;
 
-  lock_acquire (&sos_lock, saved_mask);
+  size = UNW_ALIGN(size, MAX_ALIGN);
+
+  sos_lock_acquire (&saved_mask);
   {
-    /* No assumptions about `sos_memory' alignment. */
-    if (sos_memory_freepos == 0)
+    for (c = sos_chunks; c; c = c->next)
+      if ((char *) mem >= c->mem && (char *) mem < c->mem + c->size)
+	break;
+    assert (c && c->live >= size);
+
+    c->live -= size;
+    sos_in_use -= size;
+    if (!c->live)
       {
-	unsigned align = UNW_ALIGN((uintptr_t) &sos_memory[0], MAX_ALIGN)
-				- (uintptr_t) &sos_memory[0];
-	sos_memory_freepos = align;
+	/* Nothing in the chunk is in use any more.  */
+	c->pos = 0;
+	if (c != sos_current)
+	  sos_release_chunk (c);
       }
-    pos = sos_memory_freepos;
-    sos_memory_freepos += size;
   }
-  lock_release (&sos_lock, saved_mask);
-#endif
+  sos_lock_release (&saved_mask);
+}
 
-  assert (((uintptr_t) &sos_memory[pos] & (MAX_ALIGN-1)) == 0);
-  assert ((pos+size) <= SOS_MEMORY_SIZE);
+HIDDEN void
+sos_get_usage (size_t *mapped, size_t *in_use)
+{
+  intrmask_t saved_mask;
 
-  return &sos_memory[pos];
+  sos_lock_acquire (&saved_mask);
+  {
+    *mapped = sos_mapped;
+    *in_use = sos_in_use;
+  }
+  sos_lock_release (&saved_mask);
 }
+/* End of ANDROID update. */
 
 /* Must be called while holding the mempool lock. */
 
@@ -118,11 +269,165 @@ expand (struct mempool *pool)
 	  /* last chance: try to allocate one object from the SOS memory */
 	  size = pool->obj_size;
 	  mem = sos_alloc (size);
+	  /* ANDROID support update. */
+	  if (!mem)
+	    return;
+	  /* End of ANDROID update. */
 	}
     }
   add_memory (pool, mem, size, pool->obj_size);
 }
 
+/* ANDROID support update. */
+#pragma weak pthread_key_create
+#pragma weak pthread_setspecific
+
+#define MAX_MAGAZINES	8	/* pools that get per-thread magazines */
+#define MAGAZINE_SIZE	16	/* objects held by one magazine */
+#define MAGAZINE_BATCH	(MAGAZINE_SIZE / 2)	/* objects moved at a time */
+
+struct magazine
+  {
+    unsigned int count;
+    void *objs[MAGAZINE_SIZE];
+  };
+
+struct magazines
+  {
+    volatile int busy;	/* set while the thread uses one of the magazines */
+    struct magazine mag[MAX_MAGAZINES];
+  };
+
+static define_lock (magazine_lock);
+static struct mempool *magazine_pools[MAX_MAGAZINES];
+static unsigned int num_magazines;
+static int magazine_key_created;
+static pthread_key_t magazine_key;
+static __thread struct magazines *tls_magazines;
+static __thread int tls_magazines_destroyed;
+
+/* Move up to MAGAZINE_BATCH objects from POOL into MAG.  */
+static void
+refill_magazine (struct mempool *pool, struct magazine *mag)
+{
+  intrmask_t saved_mask;
+  struct object *obj;
+
+  lock_acquire (&pool->lock, saved_mask);
+  {
+    while (mag->count < MAGAZINE_BATCH)
+      {
+	if (pool->num_free <= pool->reserve)
+	  expand (pool);
+	if (pool->num_free == 0)
+	  break;
+
+	--pool->num_free;
+	obj = pool->free_list;
+	pool->free_list = obj->next;
+	mag->objs[mag->count++] = obj;
+      }
+  }
+  lock_release (&pool->lock, saved_mask);
+}
+
+/* Move the top COUNT objects of MAG back into POOL.  */
+static void
+drain_magazine (struct mempool *pool, struct magazine *mag, unsigned int count)
+{
+  intrmask_t saved_mask;
+
+  lock_acquire (&pool->lock, saved_mask);
+  {
+    while (count-- > 0)
+      free_object (pool, mag->objs[--mag->count]);
+  }
+  lock_release (&pool->lock, saved_mask);
+}
+
+/* Return a thread's objects to their pools when it exits.  */
+static void
+magazines_free (void *arg)
+{
+  struct magazines *m = arg;
+  unsigned int i;
+
+  tls_magazines_destroyed = 1;
+  tls_magazines = NULL;
+  for (i = 0; i < num_magazines; ++i)
+    if (m->mag[i].count > 0)
+      drain_magazine (magazine_pools[i], &m->mag[i], m->mag[i].count);
+  sos_free (m, sizeof (*m));
+  Debug (5, "freed magazines %p\n", m);
+}
+
+static struct magazines *
+get_magazines (void)
+{
+  struct magazines *m = tls_magazines;
+
+  if (likely (m != NULL))
+    return m;
+
+  /* A thread that is exiting would not get another chance to give
+     the objects back.  */
+  if (!magazine_key_created || tls_magazines_destroyed)
+    return NULL;
+
+  m = sos_alloc (sizeof (*m));
+  if (!m)
+    return NULL;
+  memset (m, 0, sizeof (*m));
+
+  /* A signal handler may have set up the magazines in the meantime.  */
+  if (tls_magazines != NULL)
+    {
+      sos_free (m, sizeof (*m));
+      return tls_magazines;
+    }
+
+  if (pthread_setspecific (magazine_key, m) != 0)
+    {
+      sos_free (m, sizeof (*m));
+      return NULL;
+    }
+  tls_magazines = m;
+  Debug (5, "allocated magazines %p\n", m);
+  return m;
+}
+
+/* Give POOL a magazine index, unless there are none left or threads
+   cannot be told apart.  */
+static void
+register_magazine (struct mempool *pool)
+{
+  intrmask_t saved_mask;
+  unsigned int i;
+
+  lock_acquire (&magazine_lock, saved_mask);
+  {
+    if (!magazine_key_created
+	&& pthread_key_create != NULL && pthread_setspecific != NULL)
+      magazine_key_created =
+	pthread_key_create (&magazine_key, magazines_free) == 0;
+
+    if (magazine_key_created)
+      {
+	/* A pool that is initialized again keeps its index, objects
+	   already in magazines are still good.  */
+	for (i = 0; i < num_magazines; ++i)
+	  if (magazine_pools[i] == pool)
+	    break;
+	if (i == num_magazines && i < MAX_MAGAZINES)
+	  magazine_pools[num_magazines++] = pool;
+	if (i < num_magazines)
+	  pool->magazine = i + 1;
+      }
+  }
+  lock_release (&magazine_lock, saved_mask);
+}
+/* End of ANDROID update. */
+
 HIDDEN void
 mempool_init (struct mempool *pool, size_t obj_size, size_t reserve)
 {
@@ -148,6 +453,10 @@ mempool_init (struct mempool *pool, size_t obj_size, size_t reserve)
   pool->chunk_size = UNW_ALIGN(2*reserve*obj_size, pg_size);
 
   expand (pool);
+
+  /* ANDROID support update. */
+  register_magazine (pool);
+  /* End of ANDROID update. */
 }
 
 HIDDEN void *
@@ -155,6 +464,28 @@ mempool_alloc (struct mempool *pool)
 {
   intrmask_t saved_mask;
   struct object *obj;
+  /* ANDROID support update. */
+  struct magazines *m;
+
+  /* A signal handler that interrupts the thread while it is using its
+     magazines goes to the pool instead.  */
+  if (pool->magazine && (m = get_magazines ()) != NULL && !m->busy)
+    {
+      struct magazine *mag = &m->mag[pool->magazine - 1];
+
+      obj = NULL;
+      m->busy = 1;
+      COMPILER_BARRIER ();
+      if (mag->count == 0)
+	refill_magazine (pool, mag);
+      if (mag->count > 0)
+	obj = mag->objs[--mag->count];
+      COMPILER_BARRIER ();
+      m->busy = 0;
+      if (obj)
+	return obj;
+    }
+  /* End of ANDROID update. */
 
   lock_acquire (&pool->lock, saved_mask);
   {
@@ -175,6 +506,23 @@ HIDDEN void
 mempool_free (struct mempool *pool, void *object)
 {
   intrmask_t saved_mask;
+  /* ANDROID support update. */
+  struct magazines *m;
+
+  if (pool->magazine && (m = get_magazines ()) != NULL && !m->busy)
+    {
+      struct magazine *mag = &m->mag[pool->magazine - 1];
+
+      m->busy = 1;
+      COMPILER_BARRIER ();
+      if (mag->count == MAGAZINE_SIZE)
+	drain_magazine (pool, mag, MAGAZINE_BATCH);
+      mag->objs[mag->count++] = object;
+      COMPILER_BARRIER ();
+      m->busy = 0;
+      return;
+    }
+  /* End of ANDROID update. */
 
   lock_acquire (&pool->lock, saved_mask);
   {
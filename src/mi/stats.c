@@ -0,0 +1,228 @@
+/* libunwind - a platform-independent unwind library
+   Copyright (C) 2014 The Android Open Source Project
+
+This file is part of libunwind.
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
+
+#include "libunwind_i.h"
+#include "mempool.h"
+
+#ifdef CONFIG_STATS
+#pragma weak pthread_key_create
+#pragma weak pthread_setspecific
+
+/* Each thread counts into its own block, allocated from the SOS arena
+   when the thread first counts something.  The blocks are kept on a
+   list so that unw_get_stats() can add them up, and a thread that
+   exits folds its counts into stats_retired.  Counts are not reset in
+   place: unw_reset_stats() records the current totals, which are then
+   subtracted, so that no thread ever writes another thread's block.  */
+struct unwi_stats
+  {
+    struct unwi_stats *next;
+    unsigned long long count[UNWI_STAT_COUNT];
+  };
+
+static define_lock (stats_lock);
+static struct unwi_stats *stats_list;
+static unsigned long long stats_retired[UNWI_STAT_COUNT];
+static unsigned long long stats_base[UNWI_STAT_COUNT];
+static int stats_key_created;
+static pthread_key_t stats_key;
+static __thread struct unwi_stats *tls_stats;
+static __thread int tls_stats_destroyed;
+/* Non-zero while this thread holds the stats lock or creates its
+   block.  A signal handler that interrupts it and counts for the first
+   time skips the count instead of waiting for the lock.  */
+static __thread volatile int tls_stats_busy;
+
+/* A block has a single writer, but unw_get_stats() reads it from other
+   threads.  The counters are loaded and stored whole, so that a 64-bit
+   count isn't torn on 32-bit targets.  */
+#ifdef __ATOMIC_RELAXED
+# define stats_load(p)		__atomic_load_n (p, __ATOMIC_RELAXED)
+# define stats_store(p, v)	__atomic_store_n (p, v, __ATOMIC_RELAXED)
+#else
+# define stats_load(p)		(*(volatile unsigned long long *) (p))
+# define stats_store(p, v)	(*(volatile unsigned long long *) (p) = (v))
+#endif
+
+#define stats_lock_acquire(m)			\
+  do {						\
+    ++tls_stats_busy;				\
+    lock_acquire (&stats_lock, m);		\
+  } while (0)
+#define stats_lock_release(m)			\
+  do {						\
+    lock_release (&stats_lock, m);		\
+    --tls_stats_busy;				\
+  } while (0)
+
+static void
+stats_free (void *arg)
+{
+  struct unwi_stats *s = arg, **pp;
+  intrmask_t saved_mask;
+  int i;
+
+  tls_stats_destroyed = 1;
+  tls_stats = NULL;
+
+  stats_lock_acquire (saved_mask);
+  {
+    for (i = 0; i < UNWI_STAT_COUNT; ++i)
+      stats_retired[i] += s->count[i];
+    for (pp = &stats_list; *pp != s; pp = &(*pp)->next)
+      ;
+    *pp = s->next;
+  }
+  stats_lock_release (saved_mask);
+
+  sos_free (s, sizeof (*s));
+}
+
+static struct unwi_stats *
+stats_create (void)
+{
+  struct unwi_stats *s;
+  intrmask_t saved_mask;
+
+  if (tls_stats_destroyed
+      || pthread_key_create == NULL || pthread_setspecific == NULL)
+    return NULL;
+
+  if (!(s = sos_alloc (sizeof (*s))))
+    return NULL;
+  memset (s, 0, sizeof (*s));
+
+  stats_lock_acquire (saved_mask);
+  {
+    if (!stats_key_created)
+      stats_key_created = pthread_key_create (&stats_key, stats_free) == 0;
+    if (stats_key_created && pthread_setspecific (stats_key, s) == 0)
+      {
+	s->next = stats_list;
+	stats_list = s;
+      }
+    else
+      {
+	sos_free (s, sizeof (*s));
+	s = NULL;
+      }
+  }
+  stats_lock_release (saved_mask);
+
+  return s;
+}
+
+HIDDEN void
+unwi_stats_add (enum unwi_stat stat, unsigned long n)
+{
+  struct unwi_stats *s = tls_stats;
+
+  if (unlikely (s == NULL))
+    {
+      /* Also skips the counts made while the block is being created.  */
+      if (tls_stats_busy)
+	return;
+      ++tls_stats_busy;
+      s = stats_create ();
+      --tls_stats_busy;
+      if (!s)
+	return;
+      tls_stats = s;
+    }
+  stats_store (&s->count[stat], s->count[stat] + n);
+}
+
+/* Must be called while holding the stats lock.  */
+static void
+stats_sum (unsigned long long *count)
+{
+  struct unwi_stats *s;
+  int i;
+
+  for (i = 0; i < UNWI_STAT_COUNT; ++i)
+    count[i] = stats_retired[i];
+  for (s = stats_list; s; s = s->next)
+    for (i = 0; i < UNWI_STAT_COUNT; ++i)
+      count[i] += stats_load (&s->count[i]);
+}
+#endif /* CONFIG_STATS */
+
+PROTECTED int
+unw_get_stats (unw_stats_t *stats)
+{
+#ifdef CONFIG_STATS
+  unsigned long long count[UNWI_STAT_COUNT];
+  intrmask_t saved_mask;
+  size_t mapped, in_use, mdi_image, mdi_derived;
+  int i;
+#endif
+
+  if (!stats)
+    return -UNW_EINVAL;
+
+  memset (stats, 0, sizeof (*stats));
+
+#ifdef CONFIG_STATS
+  stats_lock_acquire (saved_mask);
+  {
+    stats_sum (count);
+    for (i = 0; i < UNWI_STAT_COUNT; ++i)
+      count[i] -= stats_base[i];
+  }
+  stats_lock_release (saved_mask);
+
+  sos_get_usage (&mapped, &in_use);
+  elf_w (get_mini_debug_info_usage) (&mdi_image, &mdi_derived);
+
+  stats->rs_cache_lookups = count[UNWI_STAT_RS_CACHE_LOOKUPS];
+  stats->rs_cache_misses = count[UNWI_STAT_RS_CACHE_MISSES];
+  stats->trace_cache_expansions = count[UNWI_STAT_TRACE_CACHE_EXPANSIONS];
+  stats->map_rebuilds = count[UNWI_STAT_MAP_REBUILDS];
+  stats->dl_iterate_phdr_calls = count[UNWI_STAT_DL_ITERATE_PHDR_CALLS];
+  stats->fde_linear_searches = count[UNWI_STAT_FDE_LINEAR_SEARCHES];
+  stats->table_probes = count[UNWI_STAT_TABLE_PROBES];
+  stats->access_mem_bytes = count[UNWI_STAT_ACCESS_MEM_BYTES];
+  stats->internal_mapped_bytes = mapped;
+  stats->internal_in_use_bytes = in_use;
+  stats->mini_debug_info_bytes = mdi_image;
+  stats->mini_debug_info_derived_bytes = mdi_derived;
+  return 0;
+#else
+  return -UNW_ENOINFO;
+#endif
+}
+
+PROTECTED void
+unw_reset_stats (void)
+{
+#ifdef CONFIG_STATS
+  intrmask_t saved_mask;
+
+  stats_lock_acquire (saved_mask);
+  {
+    stats_sum (stats_base);
+  }
+  stats_lock_release (saved_mask);
+#endif
+}
@@ -48,6 +48,13 @@ unw_init_local (unw_cursor_t *cursor, ucontext_t *uc)
   c->dwarf.as = unw_local_addr_space;
   c->dwarf.as_arg = uc;
 
+  /* ANDROID support update. */
+#ifdef UNW_LOCAL_ONLY
+  /* The stack is not the one the last unwind on this thread saw.  */
+  unwi_local_mem_flush ();
+#endif
+  /* End of ANDROID update. */
+
   return common_init (c, 1);
 }
 
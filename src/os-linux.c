@@ -23,12 +23,16 @@ LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
 OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
 WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
 
+#include <errno.h>
 #include <limits.h>
 #include <stdio.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
 
 #include "libunwind_i.h"
 #include "libunwind-ptrace.h"
 #include "map_info.h"
+#include "mempool.h"
 #include "os-linux.h"
 
 /* ANDROID support update. */
@@ -62,8 +66,7 @@ map_create_list (int map_create_type, pid_t pid)
       cur_map->ei.valid = false;
       cur_map->ei.load_attempted = false;
       cur_map->ei.mapped = false;
-      cur_map->ei.mini_debug_info_data = NULL;
-      cur_map->ei.mini_debug_info_size = 0;
+      cur_map->ei.mini_debug_info = NULL;
 
       /* Indicate mapped memory of devices is special and should not
          be read or written. Use a special flag instead of zeroing the
@@ -159,3 +162,209 @@ map_create_list (int map_create_type, pid_t pid)
   return map_list;
 }
 /* End of ANDROID update. */
+
+/* ANDROID support update. */
+#ifdef __NR_process_vm_readv
+/* Local memory is copied with process_vm_readv() on the process itself,
+   so the kernel rejects unreadable addresses without the map list
+   having to be consulted, or rebuilt, first.  Each thread keeps the
+   last chunk it fetched: stack slots read by consecutive steps are
+   usually close to each other, and one system call then serves
+   several reads.  */
+# define LOCAL_MEM_CHUNK_WORDS	32
+# define LOCAL_MEM_CHUNK_SIZE	(LOCAL_MEM_CHUNK_WORDS * sizeof (unw_word_t))
+
+struct local_mem_chunk
+  {
+    pid_t pid;		/* getpid (), 0 until the first read */
+    unw_word_t start;	/* address of data[0] */
+    unw_word_t end;	/* address past the last fetched byte */
+    unw_word_t data[LOCAL_MEM_CHUNK_WORDS];
+  };
+
+#pragma weak pthread_once
+#pragma weak pthread_key_create
+#pragma weak pthread_setspecific
+
+/* The chunk is allocated by the first read of a thread, so that threads
+   which never unwind don't pay for it.  LOCAL_MEM_BUSY is set while the
+   chunk is being allocated, read or filled, and for good once the
+   thread has freed it on exit.  */
+static __thread struct local_mem_chunk *local_mem_chunk;
+static __thread volatile int local_mem_busy;
+static pthread_once_t local_mem_once = PTHREAD_ONCE_INIT;
+static pthread_key_t local_mem_key;
+static int local_mem_key_created;
+
+static void
+local_mem_chunk_free (void *arg)
+{
+  local_mem_busy = 1;
+  local_mem_chunk = NULL;
+  sos_free (arg, sizeof (struct local_mem_chunk));
+}
+
+static void
+local_mem_init_once (void)
+{
+  local_mem_key_created =
+    pthread_key_create (&local_mem_key, local_mem_chunk_free) == 0;
+}
+
+static struct local_mem_chunk *
+local_mem_chunk_create (void)
+{
+  struct local_mem_chunk *c;
+
+  if (pthread_once == NULL || pthread_key_create == NULL
+      || pthread_setspecific == NULL)
+    return NULL;
+
+  pthread_once (&local_mem_once, local_mem_init_once);
+  if (!local_mem_key_created || !(c = sos_alloc (sizeof (*c))))
+    return NULL;
+
+  memset (c, 0, sizeof (*c));
+  if (pthread_setspecific (local_mem_key, c) != 0)
+    {
+      sos_free (c, sizeof (*c));
+      return NULL;
+    }
+  return c;
+}
+
+/* Cleared once process_vm_readv() turns out not to work here.  */
+static int local_mem_readv_ok = 1;
+
+/* Copy up to LEN bytes at ADDR into BUF.  Returns the number of bytes
+   copied, 0 if ADDR is not readable and -1 if the system call is not
+   available.  */
+static ssize_t
+local_mem_readv (pid_t pid, void *buf, unw_word_t addr, size_t len)
+{
+  struct iovec local, remote;
+  int saved_errno = errno;
+  ssize_t n;
+
+  local.iov_base = buf;
+  local.iov_len = len;
+  remote.iov_base = (void *) (uintptr_t) addr;
+  remote.iov_len = len;
+
+  n = syscall (__NR_process_vm_readv, pid, &local, 1, &remote, 1, 0);
+  if (n < 0)
+    {
+      if (errno == EFAULT)
+	n = 0;
+      else if (errno == ENOSYS || errno == EPERM)
+	{
+	  Debug (1, "process_vm_readv not usable (errno %d)\n", errno);
+	  local_mem_readv_ok = 0;
+	}
+    }
+  errno = saved_errno;
+  return n;
+}
+
+HIDDEN int
+unwi_local_read_mem (unw_word_t addr, unw_word_t *val)
+{
+  struct local_mem_chunk *c;
+  unw_word_t start;
+  ssize_t n;
+  int ret = 1;
+
+  if (!local_mem_readv_ok)
+    return -1;
+
+  /* A signal handler that unwinds while this thread is in the middle of
+     a read must not touch the chunk, it reads the word on its own.  */
+  if (local_mem_busy)
+    goto uncached;
+  local_mem_busy = 1;
+  COMPILER_BARRIER ();
+
+  if (!(c = local_mem_chunk))
+    c = local_mem_chunk = local_mem_chunk_create ();
+  if (!c)
+    {
+      COMPILER_BARRIER ();
+      local_mem_busy = 0;
+      goto uncached;
+    }
+
+  /* The pid is forgotten by unwi_local_mem_flush(), so that a child of
+     fork() does not go on reading the memory of its parent.  */
+  if (!c->pid)
+    c->pid = getpid ();
+
+  if (addr < c->start || addr > c->end - sizeof (unw_word_t)
+      || c->end - c->start < sizeof (unw_word_t))
+    {
+      /* The unwinder mostly moves up the stack, so the chunk starts a
+	 few words below ADDR, at a boundary in the same page as ADDR: the
+	 read cannot fail because of a page that precedes it.  A chunk
+	 that runs into an unreadable page is simply cut short by the
+	 kernel.  */
+      start = addr & -(LOCAL_MEM_CHUNK_SIZE / 8);
+      c->start = c->end = 0;
+      n = local_mem_readv (c->pid, c->data, start, LOCAL_MEM_CHUNK_SIZE);
+      if (n > 0)
+	{
+	  c->start = start;
+	  c->end = start + n;
+	}
+      if (n <= 0)
+	/* START is in the page of ADDR.  */
+	ret = n < 0 ? -1 : 0;
+      else if (addr + sizeof (unw_word_t) > start + n)
+	{
+	  /* The word is not in the chunk, it straddles the boundary at
+	     which the read stopped.  */
+	  n = local_mem_readv (c->pid, val, addr, sizeof (unw_word_t));
+	  ret = n < 0 ? -1 : n == sizeof (unw_word_t);
+	  goto out;
+	}
+    }
+  if (ret > 0)
+    memcpy (val, (char *) c->data + (addr - c->start), sizeof (unw_word_t));
+
+ out:
+  COMPILER_BARRIER ();
+  local_mem_busy = 0;
+  return ret;
+
+ uncached:
+  n = local_mem_readv (getpid (), val, addr, sizeof (unw_word_t));
+  if (n < 0)
+    return -1;
+  return n == sizeof (unw_word_t);
+}
+
+HIDDEN void
+unwi_local_mem_flush (void)
+{
+  struct local_mem_chunk *c = local_mem_chunk;
+
+  /* Only the range is reset, a read that has already checked it may
+     still copy from the data.  */
+  if (c)
+    {
+      c->start = c->end = 0;
+      c->pid = 0;
+    }
+}
+#else /* !__NR_process_vm_readv */
+
+HIDDEN int
+unwi_local_read_mem (unw_word_t addr, unw_word_t *val)
+{
+  return -1;
+}
+
+HIDDEN void
+unwi_local_mem_flush (void)
+{
+}
+#endif /* !__NR_process_vm_readv */
+/* End of ANDROID update. */
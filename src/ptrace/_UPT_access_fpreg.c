@@ -39,6 +39,14 @@ _UPT_access_fpreg (unw_addr_space_t as, unw_regnum_t reg, unw_fpreg_t *val,
   if ((unsigned) reg >= ARRAY_SIZE (_UPT_reg_offset))
     return -UNW_EBADREG;
 
+  /* ANDROID support update. */
+#if UPT_HAVE_REGSET
+  if (_UPT_regset_access (ui, _UPT_reg_offset[reg], val, sizeof (*val),
+			  write) >= 0)
+    return 0;
+#endif
+  /* End of ANDROID update. */
+
   errno = 0;
   if (write)
     for (i = 0; i < (int) (sizeof (*val) / sizeof (wp[i])); ++i)
@@ -236,6 +236,14 @@ _UPT_access_reg (unw_addr_space_t as, unw_regnum_t reg, unw_word_t *val,
       goto badreg;
     }
 
+  /* ANDROID support update. */
+#if UPT_HAVE_REGSET
+  if (_UPT_regset_access (ui, _UPT_reg_offset[reg], val, sizeof (*val),
+			  write) >= 0)
+    goto out;
+#endif
+  /* End of ANDROID update. */
+
 #ifdef HAVE_TTRACE
 #	warning No support for ttrace() yet.
 #else
@@ -261,7 +269,7 @@ _UPT_access_reg (unw_addr_space_t as, unw_regnum_t reg, unw_word_t *val,
   }
 #endif
 
-#ifdef UNW_TARGET_IA64
+#if defined(UNW_TARGET_IA64) || UPT_HAVE_REGSET
  out:
 #endif
 #if UNW_DEBUG
@@ -359,7 +367,19 @@ _UPT_access_reg (unw_addr_space_t as, unw_regnum_t reg, unw_word_t *val,
 {
   struct UPT_info *ui = arg;
   pid_t pid = ui->pid;
-#if defined(__aarch64__)
+#if defined(__aarch64__) && UPT_HAVE_REGSET
+#if UNW_DEBUG
+  Debug(16, "using getregset: reg: %s [%u], val: %lx, write: %u\n", unw_regname(reg), (unsigned) reg, (long) val, write);
+
+  if (write)
+    Debug (16, "%s [%u] <- %lx\n", unw_regname (reg), (unsigned) reg, (long) *val);
+#endif
+  /* X0-X30, SP and PC are laid out in this order in user_pt_regs.  */
+  if (reg > UNW_AARCH64_PC
+      || _UPT_regset_access (ui, _UPT_reg_offset[reg], val, sizeof (*val),
+			     write) < 0)
+    goto badreg;
+#elif defined(__aarch64__)
   struct user_pt_regs regs;
   struct iovec io;
   io.iov_base = &regs;
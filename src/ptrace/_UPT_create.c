@@ -42,5 +42,11 @@ _UPT_create (pid_t pid)
 #if UNW_TARGET_IA64
   ui->edi.ktab.format = -1;
 #endif
+  /* ANDROID support update. */
+#if UNW_TARGET_ARM
+  ui->edi.di_arm.format = -1;
+#endif
+  unwi_edi_cache_init (&ui->edi_cache);
+  /* End of ANDROID update. */
   return ui;
 }
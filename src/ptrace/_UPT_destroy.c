@@ -29,6 +29,10 @@ void
 _UPT_destroy (void *ptr)
 {
   struct UPT_info *ui = (struct UPT_info *) ptr;
+  /* ANDROID support update. */
+  _UPT_flush_regs (ui);
+  unwi_edi_cache_fini (&ui->edi_cache);
+  /* End of ANDROID update. */
   invalidate_edi (&ui->edi);
   free (ptr);
 }
@@ -32,15 +32,17 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
 
 #include "_UPT_internal.h"
 
+/* ANDROID support update. */
 static int
-get_unwind_info (struct elf_dyn_info *edi, pid_t pid, unw_addr_space_t as, unw_word_t ip, void *as_arg)
+get_unwind_info (struct UPT_info *ui, unw_addr_space_t as, unw_word_t ip)
 {
-  /* ANDROID support update. */
+  struct elf_dyn_info *edi = &ui->edi;
+  struct elf_dyn_info_cache *cache;
+  unw_word_t generation;
   unsigned long segbase, mapoff;
   struct elf_image ei;
   int ret;
   char *path = NULL;
-  /* End of ANDROID update. */
 
 #if UNW_TARGET_IA64 && defined(__linux)
   if (!edi->ktab.start_ip && _Uia64_get_kernel_table (&edi->ktab) < 0)
@@ -50,27 +52,39 @@ get_unwind_info (struct elf_dyn_info *edi, pid_t pid, unw_addr_space_t as, unw_w
     return 0;
 #endif
 
-  if ((edi->di_cache.format != -1
-       && ip >= edi->di_cache.start_ip && ip < edi->di_cache.end_ip)
+  generation = unwi_edi_cache_generation (as);
+  if (ui->edi_generation == generation
+      && ((edi->di_cache.format != -1
+	   && ip >= edi->di_cache.start_ip && ip < edi->di_cache.end_ip)
 #if UNW_TARGET_ARM
-      || (edi->di_debug.format != -1
-       && ip >= edi->di_arm.start_ip && ip < edi->di_arm.end_ip)
+	  || (edi->di_arm.format != -1
+	      && ip >= edi->di_arm.start_ip && ip < edi->di_arm.end_ip)
 #endif
-      || (edi->di_debug.format != -1
-       && ip >= edi->di_debug.start_ip && ip < edi->di_debug.end_ip))
+	  || (edi->di_debug.format != -1
+	      && ip >= edi->di_debug.start_ip && ip < edi->di_debug.end_ip)))
     return 0;
 
+  /* The tables are usually already known, either to this _UPT_info or
+     (when caching is enabled) to another thread using the same address
+     space.  */
+  if (as->caching_policy == UNW_CACHE_NONE)
+    cache = &ui->edi_cache;
+  else
+    cache = unwi_edi_cache_get (as);
+
   invalidate_edi(edi);
+  ui->edi_generation = generation;
 
-  /* ANDROID support update. */
-  if (tdep_get_elf_image (as, &ei, pid, ip, &segbase, &mapoff, &path, as_arg) < 0)
+  if (cache && unwi_edi_cache_lookup (as, cache, ip, edi) == 0)
+    return 0;
+
+  if (tdep_get_elf_image (as, &ei, ui->pid, ip, &segbase, &mapoff, &path, ui) < 0)
     return -UNW_ENOINFO;
 
   ret = tdep_find_unwind_table (edi, &ei, as, path, segbase, mapoff, ip);
   free(path);
   if (ret < 0)
     return ret;
-  /* End of ANDROID update. */
 
   /* This can happen in corner cases where dynamically generated
      code falls into the same page that contains the data-segment
@@ -91,8 +105,12 @@ get_unwind_info (struct elf_dyn_info *edi, pid_t pid, unw_addr_space_t as, unw_w
       && edi->di_debug.format == -1)
     return -UNW_ENOINFO;
 
+  if (cache)
+    unwi_edi_cache_insert (as, cache, edi, generation);
+
   return 0;
 }
+/* End of ANDROID update. */
 
 int
 _UPT_find_proc_info (unw_addr_space_t as, unw_word_t ip, unw_proc_info_t *pi,
@@ -101,7 +119,9 @@ _UPT_find_proc_info (unw_addr_space_t as, unw_word_t ip, unw_proc_info_t *pi,
   struct UPT_info *ui = arg;
   int ret = -UNW_ENOINFO;
 
-  if (get_unwind_info (&ui->edi, ui->pid, as, ip, arg) < 0)
+  /* ANDROID support update. */
+  if (get_unwind_info (ui, as, ip) < 0)
+  /* End of ANDROID update. */
     return -UNW_ENOINFO;
 
 #if UNW_TARGET_IA64
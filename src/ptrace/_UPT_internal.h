@@ -48,12 +48,60 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
 
 #include "libunwind_i.h"
 
+/* ANDROID support update. */
+/* On Linux, the registers that PTRACE_PEEKUSER reads from the start of
+   the USER area are exactly the NT_PRSTATUS register set on the
+   targets below, so they can be served from a snapshot taken with a
+   single PTRACE_GETREGSET.  On x86 the same goes for the i387 part of
+   the USER area and NT_PRFPREG.  */
+#if defined(__linux__) && defined(PTRACE_GETREGSET) && defined(NT_PRSTATUS) \
+    && (UNW_TARGET_X86 || UNW_TARGET_X86_64 || UNW_TARGET_ARM \
+	|| UNW_TARGET_AARCH64 || UNW_TARGET_PPC32 || UNW_TARGET_PPC64)
+# define UPT_HAVE_REGSET 1
+# include <stddef.h>
+# include <sys/uio.h>
+# if UNW_TARGET_X86 || UNW_TARGET_X86_64
+#  include <sys/user.h>
+#  define UPT_FPREGS_USER_OFFSET	offsetof (struct user, i387)
+# endif
+#else
+# define UPT_HAVE_REGSET 0
+#endif
+
+#define UPT_REGSET_WORDS	128	/* enough for NT_PRSTATUS/NT_PRFPREG */
+
+struct UPT_regset
+  {
+    int valid;		/* DATA holds the set as last read */
+    int dirty;		/* snapshot modified, needs to be written back */
+    size_t size;	/* number of bytes supplied by the kernel */
+    unw_word_t data[UPT_REGSET_WORDS];
+  };
+/* End of ANDROID update. */
+
 struct UPT_info
   {
     pid_t pid;		/* the process-id of the child we're unwinding */
     struct elf_dyn_info edi;
+    /* ANDROID support update. */
+#if UPT_HAVE_REGSET
+    struct UPT_regset regs;	/* NT_PRSTATUS */
+    struct UPT_regset fpregs;	/* NT_PRFPREG */
+    int snapshot;		/* serve accesses from REGS/FPREGS */
+#endif
+    /* Tables seen by this _UPT_info, used when the address space does
+       not cache (UNW_CACHE_NONE).  Otherwise as->edi_cache is used, which
+       is shared with all other users of the address space.  */
+    struct elf_dyn_info_cache edi_cache;
+    unw_word_t edi_generation;	/* unwi_edi_cache_generation() for edi */
+    /* End of ANDROID update. */
   };
 
 extern const int _UPT_reg_offset[UNW_REG_LAST + 1];
 
+/* ANDROID support update. */
+extern int _UPT_regset_access (struct UPT_info *ui, unw_word_t off,
+			       void *val, size_t size, int write);
+/* End of ANDROID update. */
+
 #endif /* _UPT_internal_h */
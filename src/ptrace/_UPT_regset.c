@@ -0,0 +1,141 @@
+/* libunwind - a platform-independent unwind library
+   Copyright (C) 2014 The Android Open Source Project
+
+This file is part of libunwind.
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
+
+#include "_UPT_internal.h"
+
+#if UPT_HAVE_REGSET
+static int
+regset_write (struct UPT_info *ui, struct UPT_regset *rs, int type)
+{
+  struct iovec io;
+
+  io.iov_base = rs->data;
+  io.iov_len = rs->size;
+  if (ptrace (PTRACE_SETREGSET, ui->pid, (void *) (uintptr_t) type, &io) == -1)
+    {
+      Debug (1, "PTRACE_SETREGSET %d failed (error: %s)\n", type,
+	     strerror (errno));
+      return -1;
+    }
+  rs->dirty = 0;
+  return 0;
+}
+
+static void
+regset_read (struct UPT_info *ui, struct UPT_regset *rs, int type)
+{
+  struct iovec io;
+
+  io.iov_base = rs->data;
+  io.iov_len = sizeof (rs->data);
+  if (ptrace (PTRACE_GETREGSET, ui->pid, (void *) (uintptr_t) type, &io) == -1)
+    {
+      /* Leave the set empty; callers fall back to PTRACE_PEEKUSER.  */
+      Debug (2, "PTRACE_GETREGSET %d failed (error: %s)\n", type,
+	     strerror (errno));
+      io.iov_len = 0;
+    }
+  rs->size = io.iov_len;
+  rs->valid = 1;
+  rs->dirty = 0;
+}
+
+/* Read or write SIZE bytes at offset OFF of the USER area through a
+   register set.  Unless the caller took a snapshot with
+   _UPT_snapshot_regs(), the set is fetched again on every access and
+   writes go straight to the target, since we can't tell whether it
+   has been resumed in the meantime.  Returns -UNW_EBADREG if OFF isn't
+   covered by a register set, in which case the caller has to fall back
+   to PTRACE_PEEKUSER/PTRACE_POKEUSER.  */
+
+int
+_UPT_regset_access (struct UPT_info *ui, unw_word_t off, void *val,
+		    size_t size, int write)
+{
+  struct UPT_regset *rs = &ui->regs;
+  int type = NT_PRSTATUS;
+
+#ifdef UPT_FPREGS_USER_OFFSET
+  if (off >= UPT_FPREGS_USER_OFFSET)
+    {
+      rs = &ui->fpregs;
+      type = NT_PRFPREG;
+      off -= UPT_FPREGS_USER_OFFSET;
+    }
+#endif
+
+  if (!ui->snapshot || !rs->valid)
+    regset_read (ui, rs, type);
+
+  if (off + size > rs->size)
+    return -UNW_EBADREG;
+
+  if (write)
+    {
+      memcpy ((char *) rs->data + off, val, size);
+      rs->dirty = 1;
+      if (!ui->snapshot && regset_write (ui, rs, type) < 0)
+	return -UNW_EBADREG;
+    }
+  else
+    memcpy (val, (char *) rs->data + off, size);
+  return 0;
+}
+#endif /* UPT_HAVE_REGSET */
+
+int
+_UPT_snapshot_regs (void *arg)
+{
+#if UPT_HAVE_REGSET
+  struct UPT_info *ui = arg;
+  int ret;
+
+  if ((ret = _UPT_flush_regs (ui)) < 0)
+    return ret;
+
+  regset_read (ui, &ui->regs, NT_PRSTATUS);
+  regset_read (ui, &ui->fpregs, NT_PRFPREG);
+  ui->snapshot = 1;
+#endif
+  return 0;
+}
+
+int
+_UPT_flush_regs (void *arg)
+{
+  int ret = 0;
+#if UPT_HAVE_REGSET
+  struct UPT_info *ui = arg;
+
+  if (ui->regs.dirty && regset_write (ui, &ui->regs, NT_PRSTATUS) < 0)
+    ret = -UNW_EBADREG;
+  if (ui->fpregs.dirty && regset_write (ui, &ui->fpregs, NT_PRFPREG) < 0)
+    ret = -UNW_EBADREG;
+
+  ui->regs.valid = 0;
+  ui->fpregs.valid = 0;
+  ui->snapshot = 0;
+#endif
+  return ret;
+}
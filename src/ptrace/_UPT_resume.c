@@ -30,6 +30,12 @@ _UPT_resume (unw_addr_space_t as, unw_cursor_t *c, void *arg)
 {
   struct UPT_info *ui = arg;
 
+  /* ANDROID support update. */
+  /* Registers modified through the snapshot are only written back
+     here.  */
+  _UPT_flush_regs (ui);
+  /* End of ANDROID update. */
+
 #ifdef HAVE_TTRACE
 # warning No support for ttrace() yet.
 #elif HAVE_DECL_PTRACE_CONT
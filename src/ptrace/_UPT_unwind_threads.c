@@ -0,0 +1,440 @@
+/* libunwind - a platform-independent unwind library
+   Copyright (C) 2014 The Android Open Source Project
+
+This file is part of libunwind.
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
+
+#include <dirent.h>
+#include <string.h>
+#include <sys/wait.h>
+#ifdef __linux__
+# include <sys/syscall.h>
+# include <sys/uio.h>
+#endif
+
+#include "_UPT_internal.h"
+
+/* Unwind all threads of a process while keeping it stopped for as
+   short a time as possible: all threads are stopped first, and then
+   unwound concurrently by a pool of workers sharing one address space
+   (and therefore one map list, one rs cache and one set of cached ELF
+   images).
+
+   Only the thread that attached to a task may issue ptrace requests
+   for it, so the workers never use ptrace: registers are served from
+   the NT_PRSTATUS snapshot taken right after each thread stopped and
+   memory is read with process_vm_readv().  Without either of these,
+   everything is done by the calling thread.  */
+
+#pragma weak pthread_create
+#pragma weak pthread_join
+
+#if UPT_HAVE_REGSET && defined(__NR_process_vm_readv)
+# define UPT_HAVE_WORKERS 1
+#else
+# define UPT_HAVE_WORKERS 0
+#endif
+
+struct upt_thread
+  {
+    struct UPT_info *ui;	/* register snapshot of the stopped thread */
+    int attached;
+    int stopped;
+    int pending_sig;	/* signal to re-inject on detach */
+  };
+
+struct upt_unwind
+  {
+    unw_addr_space_t as;
+    pid_t pid;
+    size_t max_frames;
+    size_t num_threads;
+    struct upt_thread *threads;
+    _UPT_thread_frames_t *frames;
+    pthread_mutex_t lock;
+    size_t next;		/* next thread to be unwound */
+  };
+
+#if UPT_HAVE_WORKERS
+static int
+vm_access_mem (unw_addr_space_t as, unw_word_t addr, unw_word_t *val,
+	       int write, void *arg)
+{
+  struct UPT_info *ui = arg;
+  struct iovec local, remote;
+
+  if (write)
+    return -UNW_EINVAL;
+
+  local.iov_base = val;
+  local.iov_len = sizeof (*val);
+  remote.iov_base = (void *) (uintptr_t) addr;
+  remote.iov_len = sizeof (*val);
+  if (syscall (__NR_process_vm_readv, ui->pid, &local, 1, &remote, 1, 0)
+      != (ssize_t) sizeof (*val))
+    return -UNW_EINVAL;
+
+  Debug (16, "mem[%lx] -> %lx\n", (long) addr, (long) *val);
+  return 0;
+}
+#endif
+
+static int
+add_thread (struct upt_unwind *uw, pid_t tid, size_t *capacity)
+{
+  size_t i;
+
+  for (i = 0; i < uw->num_threads; ++i)
+    if (uw->frames[i].tid == tid)
+      return 0;
+
+  if (uw->num_threads == *capacity)
+    {
+      size_t n = *capacity ? 2 * *capacity : 16;
+      void *p;
+
+      if (!(p = realloc (uw->threads, n * sizeof (*uw->threads))))
+	return -UNW_ENOMEM;
+      uw->threads = p;
+      if (!(p = realloc (uw->frames, n * sizeof (*uw->frames))))
+	return -UNW_ENOMEM;
+      uw->frames = p;
+      *capacity = n;
+    }
+
+  memset (&uw->threads[uw->num_threads], 0, sizeof (*uw->threads));
+  memset (&uw->frames[uw->num_threads], 0, sizeof (*uw->frames));
+  uw->frames[uw->num_threads].tid = tid;
+  uw->frames[uw->num_threads].error = -UNW_EUNSPEC;
+  uw->num_threads++;
+  return 1;
+}
+
+/* Add the threads in /proc/PID/task that we haven't seen yet.  Returns
+   the number of new threads.  */
+
+static int
+scan_threads (struct upt_unwind *uw, size_t *capacity)
+{
+  char path[64];
+  struct dirent *de;
+  DIR *dir;
+  int ret, count = 0;
+
+  snprintf (path, sizeof (path), "/proc/%d/task", (int) uw->pid);
+  if (!(dir = opendir (path)))
+    return -UNW_EUNSPEC;
+
+  while ((de = readdir (dir)))
+    {
+      pid_t tid = atoi (de->d_name);
+
+      if (tid <= 0)
+	continue;
+      if ((ret = add_thread (uw, tid, capacity)) < 0)
+	{
+	  closedir (dir);
+	  return ret;
+	}
+      count += ret;
+    }
+  closedir (dir);
+  return count;
+}
+
+static void
+attach_thread (struct upt_thread *t, pid_t tid)
+{
+#ifdef PTRACE_SEIZE
+  if (ptrace (PTRACE_SEIZE, tid, 0, 0) == 0)
+    {
+      t->attached = 1;
+      if (ptrace (PTRACE_INTERRUPT, tid, 0, 0) < 0)
+	Debug (1, "PTRACE_INTERRUPT of %d failed (error: %s)\n", (int) tid,
+	       strerror (errno));
+    }
+#else
+  if (ptrace (PTRACE_ATTACH, tid, 0, 0) == 0)
+    t->attached = 1;
+#endif
+  if (!t->attached)
+    Debug (1, "can't attach to %d (error: %s)\n", (int) tid,
+	   strerror (errno));
+}
+
+static void
+wait_thread (struct upt_thread *t, pid_t tid)
+{
+  int status, sig;
+
+  while (waitpid (tid, &status, __WALL) < 0)
+    if (errno != EINTR)
+      return;
+
+  if (!WIFSTOPPED (status))
+    return;	/* the thread exited */
+
+  sig = WSTOPSIG (status);
+#ifdef PTRACE_SEIZE
+  if ((status >> 16) == PTRACE_EVENT_STOP)
+    sig = 0;
+#else
+  if (sig == SIGSTOP)
+    sig = 0;	/* the stop we asked for */
+#endif
+  if (sig == SIGTRAP)
+    sig = 0;
+  t->pending_sig = sig;
+  t->stopped = 1;
+}
+
+static void
+detach_thread (struct upt_thread *t, pid_t tid)
+{
+  if (t->attached)
+    ptrace (PTRACE_DETACH, tid, 0, (void *) (uintptr_t) t->pending_sig);
+}
+
+static void
+unwind_thread (struct upt_unwind *uw, struct UPT_info *ui, size_t i)
+{
+  _UPT_thread_frames_t *f = &uw->frames[i];
+  struct upt_thread *t = &uw->threads[i];
+  unw_word_t ip, sp;
+  unw_cursor_t c;
+  size_t n = 0;
+  int ret;
+
+  if (!t->stopped)
+    return;
+
+  f->ips = malloc (uw->max_frames * sizeof (*f->ips));
+  f->sps = malloc (uw->max_frames * sizeof (*f->sps));
+  if (!f->ips || !f->sps)
+    {
+      f->error = -UNW_ENOMEM;
+      return;
+    }
+
+  ui->pid = f->tid;
+#if UPT_HAVE_REGSET
+  /* Workers aren't the tracer, so any ptrace request of theirs fails:
+     serve both register sets from the snapshot only.  */
+  ui->regs = t->ui->regs;
+  ui->fpregs = t->ui->fpregs;
+  ui->snapshot = 1;
+#endif
+
+  if ((ret = unw_init_remote (&c, uw->as, ui)) < 0)
+    {
+      f->error = ret;
+      return;
+    }
+
+  do
+    {
+      if ((ret = unw_get_reg (&c, UNW_REG_IP, &ip)) < 0
+	  || (ret = unw_get_reg (&c, UNW_REG_SP, &sp)) < 0)
+	break;
+      /* Some targets report the end of the chain as a frame with IP 0.  */
+      if (ip == 0 && n > 0)
+	break;
+      f->ips[n] = ip;
+      f->sps[n] = sp;
+      ++n;
+    }
+  while (n < uw->max_frames && (ret = unw_step (&c)) > 0);
+
+  f->num_frames = n;
+  f->error = ret < 0 ? ret : 0;
+}
+
+static void *
+worker (void *arg)
+{
+  struct upt_unwind *uw = arg;
+  struct UPT_info *ui;
+  size_t i;
+
+  if (!(ui = _UPT_create (uw->pid)))
+    return NULL;
+
+  for (;;)
+    {
+      mutex_lock (&uw->lock);
+      i = uw->next++;
+      mutex_unlock (&uw->lock);
+
+      if (i >= uw->num_threads)
+	break;
+      unwind_thread (uw, ui, i);
+    }
+
+  /* Cached ELF images may still refer to UI, so it is released only
+     once the address space is gone; see _UPT_unwind_threads().  */
+  return ui;
+}
+
+int
+_UPT_unwind_threads (pid_t pid, size_t max_frames, unsigned int num_workers,
+		     _UPT_thread_frames_t **framesp, size_t *num_threadsp)
+{
+  struct upt_unwind uw;
+  unw_map_cursor_t map_cursor;
+  unw_accessors_t accessors = _UPT_accessors;
+  pthread_t *tids = NULL;
+  void **worker_ui = NULL;
+  size_t capacity = 0, done = 0, i;
+  unsigned int w, started = 0;
+  int ret, have_maps = 0;
+
+  *framesp = NULL;
+  *num_threadsp = 0;
+
+  if (max_frames == 0)
+    return -UNW_EINVAL;
+
+  memset (&uw, 0, sizeof (uw));
+  uw.pid = pid;
+  uw.max_frames = max_frames;
+  mutex_init (&uw.lock);
+
+  /* Stop every thread.  Threads created while we were busy stopping
+     the others show up on the next scan; once a scan finds nothing
+     new, nobody is left running that could create more.  */
+  while ((ret = scan_threads (&uw, &capacity)) > 0)
+    {
+      for (i = done; i < uw.num_threads; ++i)
+	attach_thread (&uw.threads[i], uw.frames[i].tid);
+      for (i = done; i < uw.num_threads; ++i)
+	if (uw.threads[i].attached)
+	  wait_thread (&uw.threads[i], uw.frames[i].tid);
+      done = uw.num_threads;
+    }
+  if (ret < 0)
+    goto out;
+
+  /* Take the register snapshots while we're still the only one
+     allowed to ptrace the threads.  */
+  for (i = 0; i < uw.num_threads; ++i)
+    {
+      if (!uw.threads[i].stopped)
+	continue;
+      if (!(uw.threads[i].ui = _UPT_create (uw.frames[i].tid)))
+	{
+	  ret = -UNW_ENOMEM;
+	  goto out;
+	}
+      _UPT_snapshot_regs (uw.threads[i].ui);
+    }
+
+  if (unw_map_cursor_create (&map_cursor, pid) != 0)
+    {
+      ret = -UNW_ENOMEM;
+      goto out;
+    }
+  have_maps = 1;
+
+#if UPT_HAVE_WORKERS
+  accessors.access_mem = vm_access_mem;
+#else
+  num_workers = 1;
+#endif
+  if (!pthread_create || !pthread_join || num_workers == 0)
+    num_workers = 1;
+  if (num_workers > uw.num_threads)
+    num_workers = uw.num_threads ? uw.num_threads : 1;
+
+  if (!(uw.as = unw_create_addr_space (&accessors, 0)))
+    {
+      ret = -UNW_ENOMEM;
+      goto out;
+    }
+  unw_set_caching_policy (uw.as, UNW_CACHE_GLOBAL);
+  unw_map_set (uw.as, &map_cursor);
+
+  tids = calloc (num_workers, sizeof (*tids));
+  worker_ui = calloc (num_workers, sizeof (*worker_ui));
+  if (!tids || !worker_ui)
+    {
+      ret = -UNW_ENOMEM;
+      goto out;
+    }
+
+  /* The calling thread is worker 0.  */
+  for (w = 1; w < num_workers; ++w, ++started)
+    if (pthread_create (&tids[w], NULL, worker, &uw) != 0)
+      break;
+  worker_ui[0] = worker (&uw);
+  for (w = 1; w <= started; ++w)
+    pthread_join (tids[w], &worker_ui[w]);
+
+  ret = 0;
+
+ out:
+  for (i = 0; i < uw.num_threads; ++i)
+    detach_thread (&uw.threads[i], uw.frames[i].tid);
+
+  if (uw.as)
+    {
+      unw_map_set (uw.as, NULL);
+      unw_destroy_addr_space (uw.as);
+    }
+  if (have_maps)
+    unw_map_cursor_destroy (&map_cursor);
+  if (worker_ui)
+    for (w = 0; w < num_workers; ++w)
+      if (worker_ui[w])
+	_UPT_destroy (worker_ui[w]);
+  free (worker_ui);
+  free (tids);
+
+  for (i = 0; i < uw.num_threads; ++i)
+    if (uw.threads[i].ui)
+      _UPT_destroy (uw.threads[i].ui);
+  free (uw.threads);
+
+  if (ret < 0)
+    {
+      _UPT_free_thread_frames (uw.frames, uw.num_threads);
+      return ret;
+    }
+
+  *framesp = uw.frames;
+  *num_threadsp = uw.num_threads;
+  return 0;
+}
+
+void
+_UPT_free_thread_frames (_UPT_thread_frames_t *frames, size_t num_threads)
+{
+  size_t i;
+
+  if (!frames)
+    return;
+
+  for (i = 0; i < num_threads; ++i)
+    {
+      free (frames[i].ips);
+      free (frames[i].sps);
+    }
+  free (frames);
+}
@@ -53,6 +53,13 @@ unw_init_local (unw_cursor_t *cursor, ucontext_t *uc)
   c->uc = uc;
   c->validate = 0;
 
+  /* ANDROID support update. */
+#ifdef UNW_LOCAL_ONLY
+  /* The stack is not the one the last unwind on this thread saw.  */
+  unwi_local_mem_flush ();
+#endif
+  /* End of ANDROID update. */
+
   return common_init (c, 1);
 }
 
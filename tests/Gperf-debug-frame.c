@@ -0,0 +1,194 @@
+/* libunwind - a platform-independent unwind library
+   Copyright (C) 2014 The Android Open Source Project
+
+This file is part of libunwind.
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
+
+/* Measure unw_get_proc_info_by_ip() for code that is only described by
+   .debug_frame, with hundreds of such objects loaded.  The object built
+   from perf-debug-frame-obj.c has no .eh_frame; it is copied to a
+   temporary directory as many times as needed and each copy is loaded
+   with dlopen(), so every copy is a separate object with its own
+   address range.  The copies stay in place while they are in use,
+   since .debug_frame is read from the file.  */
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <libunwind.h>
+
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#define panic(args...)							  \
+	do { fprintf (stderr, args); exit (-1); } while (0)
+
+static const char *object = ".libs/libperf-debug-frame.so";
+static long max_objects = 500;
+static long iterations = 100000;
+
+static char tmpdir[] = "/tmp/libunwind-perf-XXXXXX";
+static unw_word_t *funcs;
+static long num_objects;
+
+static inline double
+gettime (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec + 1e-6*tv.tv_usec;
+}
+
+static void
+copy_file (const char *from, const char *to)
+{
+  char buf[8192];
+  ssize_t n;
+  int in, out;
+
+  in = open (from, O_RDONLY);
+  if (in < 0)
+    panic ("can't open %s\n", from);
+  out = open (to, O_WRONLY | O_CREAT | O_TRUNC, 0755);
+  if (out < 0)
+    panic ("can't create %s\n", to);
+  while ((n = read (in, buf, sizeof (buf))) > 0)
+    if (write (out, buf, n) != n)
+      panic ("can't write %s\n", to);
+  close (in);
+  close (out);
+}
+
+/* Load copies of the object until there are COUNT of them.  */
+
+static void
+load_objects (long count)
+{
+  char path[sizeof (tmpdir) + 32];
+  void *handle, *func;
+
+  for (; num_objects < count; ++num_objects)
+    {
+      snprintf (path, sizeof (path), "%s/%ld.so", tmpdir, num_objects);
+      copy_file (object, path);
+      handle = dlopen (path, RTLD_NOW | RTLD_LOCAL);
+      if (!handle)
+	panic ("dlopen(%s) failed: %s\n", path, dlerror ());
+      func = dlsym (handle, "perf_debug_frame_func");
+      if (!func)
+	panic ("no perf_debug_frame_func in %s\n", path);
+      funcs[num_objects] = (unw_word_t) func;
+    }
+}
+
+static void
+remove_objects (void)
+{
+  char path[sizeof (tmpdir) + 32];
+  long i;
+
+  for (i = 0; i < num_objects; ++i)
+    {
+      snprintf (path, sizeof (path), "%s/%ld.so", tmpdir, i);
+      unlink (path);
+    }
+  rmdir (tmpdir);
+}
+
+static void
+lookup (unw_word_t func)
+{
+  unw_proc_info_t pi;
+
+  if (unw_get_proc_info_by_ip (unw_local_addr_space, func + 1, &pi, NULL) < 0)
+    panic ("unw_get_proc_info_by_ip(0x%lx) failed\n", (long) func);
+  if (pi.start_ip != func)
+    panic ("expected a procedure at 0x%lx, got 0x%lx\n",
+	   (long) func, (long) pi.start_ip);
+}
+
+static void
+doit (long count)
+{
+  double start, stop, cold, warm;
+  unsigned int seed = 1;
+  long i;
+
+  load_objects (count);
+  unw_flush_cache (unw_local_addr_space, 0, 0);
+
+  start = gettime ();
+  for (i = 0; i < count; ++i)
+    lookup (funcs[i]);
+  stop = gettime ();
+  cold = (stop - start) / count;
+
+  start = gettime ();
+  for (i = 0; i < iterations; ++i)
+    lookup (funcs[rand_r (&seed) % count]);
+  stop = gettime ();
+  warm = (stop - start) / iterations;
+
+  printf ("%4ld objects: cold avg=%10.3f usec, warm avg=%9.3f nsec\n",
+	  count, 1e6 * cold, 1e9 * warm);
+}
+
+int
+main (int argc, char **argv)
+{
+  unw_cursor_t cursor;
+  unw_context_t uc;
+  long count;
+
+  if (argc > 1)
+    {
+      object = argv[1];
+      if (argc > 2)
+	{
+	  max_objects = atol (argv[2]);
+	  if (argc > 3)
+	    iterations = atol (argv[3]);
+	}
+    }
+  if (max_objects < 1)
+    panic ("need at least one object\n");
+
+  /* Initialize the local address space.  */
+  unw_getcontext (&uc);
+  if (unw_init_local (&cursor, &uc) < 0)
+    panic ("unw_init_local() failed\n");
+
+  funcs = calloc (max_objects, sizeof (*funcs));
+  if (!funcs || !mkdtemp (tmpdir))
+    panic ("setup failed\n");
+
+  for (count = 1; count < max_objects; count *= 10)
+    doit (count);
+  doit (max_objects);
+
+  remove_objects ();
+  return 0;
+}
@@ -0,0 +1,194 @@
+/* libunwind - a platform-independent unwind library
+   Copyright (C) 2014 The Android Open Source Project
+
+This file is part of libunwind.
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
+
+/* Measure unw_get_proc_info_by_ip() on an executable with a large
+   .eh_frame_hdr search table.  The table gets one entry for each of
+   the tiny procedures below, which are generated with macros and
+   consist of a single instruction each.  With caching turned off, the
+   table is binary-searched on every call; otherwise libunwind builds a
+   directory for it on first use.  Turning off caching also skips the
+   other caches of the lookup path, so the two runs differ in more than
+   the table search; the number of table entries read per lookup, from
+   unw_get_stats(), only depends on how the table is searched.  "cold"
+   lookups run with the data cache flushed before each call.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libunwind.h>
+
+#include <sys/time.h>
+
+#define panic(args...)							  \
+	do { fprintf (stderr, args); exit (-1); } while (0)
+
+#define PROC(n)								  \
+  __asm__ (".pushsection .text\n"					  \
+	   "perf_proc_" #n ":\n"						  \
+	   "\t.cfi_startproc\n"						  \
+	   "\tnop\n"							  \
+	   "\t.cfi_endproc\n"						  \
+	   ".popsection\n");
+#define PROC_DECL(n)	extern char perf_proc_##n[];
+#define PROC_ADDR(n)	(unw_word_t) perf_proc_##n,
+
+#define GEN8(m, n)	m (n##0) m (n##1) m (n##2) m (n##3)		  \
+			m (n##4) m (n##5) m (n##6) m (n##7)
+#define GEN64(m, n)	GEN8 (m, n##0) GEN8 (m, n##1) GEN8 (m, n##2)	  \
+			GEN8 (m, n##3) GEN8 (m, n##4) GEN8 (m, n##5)	  \
+			GEN8 (m, n##6) GEN8 (m, n##7)
+#define GEN512(m, n)	GEN64 (m, n##0) GEN64 (m, n##1) GEN64 (m, n##2)	  \
+			GEN64 (m, n##3) GEN64 (m, n##4) GEN64 (m, n##5)	  \
+			GEN64 (m, n##6) GEN64 (m, n##7)
+#define GEN4096(m, n)	GEN512 (m, n##0) GEN512 (m, n##1) GEN512 (m, n##2) \
+			GEN512 (m, n##3) GEN512 (m, n##4) GEN512 (m, n##5) \
+			GEN512 (m, n##6) GEN512 (m, n##7)
+#define GEN32768(m, n)	GEN4096 (m, n##0) GEN4096 (m, n##1)		  \
+			GEN4096 (m, n##2) GEN4096 (m, n##3)		  \
+			GEN4096 (m, n##4) GEN4096 (m, n##5)		  \
+			GEN4096 (m, n##6) GEN4096 (m, n##7)
+#define GEN_ALL(m)	GEN32768 (m, 1) GEN32768 (m, 2)
+
+GEN_ALL (PROC)
+GEN_ALL (PROC_DECL)
+
+static const unw_word_t procs[] = { GEN_ALL (PROC_ADDR) };
+
+#define NUM_PROCS	(sizeof (procs) / sizeof (procs[0]))
+
+#define MB	(1024*1024)
+
+static long iterations = 1000000;
+static long cold_iterations = 100;
+
+static char big[64*MB];	/* should be >> max. cache size */
+long dummy;
+
+static inline double
+gettime (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec + 1e-6*tv.tv_usec;
+}
+
+static long
+sum (void *buf, size_t size)
+{
+  long s = 0;
+  char *cp = buf;
+  size_t i;
+
+  for (i = 0; i < size; i += 8)
+    s += cp[i];
+  return s;
+}
+
+static void
+lookup (unw_word_t proc)
+{
+  unw_proc_info_t pi;
+
+  /* The procedures are one instruction long, so look up their first
+     byte.  */
+  if (unw_get_proc_info_by_ip (unw_local_addr_space, proc, &pi, NULL) < 0)
+    panic ("unw_get_proc_info_by_ip(0x%lx) failed\n", (long) proc);
+  if (pi.start_ip != proc)
+    panic ("expected a procedure at 0x%lx, got 0x%lx\n",
+	   (long) proc, (long) pi.start_ip);
+}
+
+static void
+doit (const char *label)
+{
+  double start, stop, first, cold, warm, probes;
+  unsigned int seed = 1;
+  unw_stats_t stats;
+  size_t i;
+  long j;
+
+  unw_flush_cache (unw_local_addr_space, 0, 0);
+
+  start = gettime ();
+  lookup (procs[0]);
+  stop = gettime ();
+  first = stop - start;
+
+  /* Every procedure must be found, whichever way the table is searched.  */
+  for (i = 0; i < NUM_PROCS; ++i)
+    lookup (procs[i]);
+
+  cold = 0.0;
+  for (j = 0; j < cold_iterations; ++j)
+    {
+      dummy += sum (big, sizeof (big));	/* flush the cache */
+      start = gettime ();
+      lookup (procs[rand_r (&seed) % NUM_PROCS]);
+      stop = gettime ();
+      cold += stop - start;
+    }
+  cold /= cold_iterations;
+
+  unw_reset_stats ();
+  start = gettime ();
+  for (j = 0; j < iterations; ++j)
+    lookup (procs[rand_r (&seed) % NUM_PROCS]);
+  stop = gettime ();
+  warm = (stop - start) / iterations;
+  if (unw_get_stats (&stats) == 0)
+    probes = (double) stats.table_probes / iterations;
+  else
+    probes = 0.0;	/* statistics are disabled */
+
+  printf ("%s: 1st=%9.3f usec, cold avg=%9.3f nsec, warm avg=%9.3f nsec,"
+	  " %5.2f probes\n", label, 1e6 * first, 1e9 * cold, 1e9 * warm,
+	  probes);
+}
+
+int
+main (int argc, char **argv)
+{
+  memset (big, 0xaa, sizeof (big));
+
+  if (argc > 1)
+    {
+      iterations = atol (argv[1]);
+      if (argc > 2)
+	cold_iterations = atol (argv[2]);
+    }
+  if (iterations < 1 || cold_iterations < 1)
+    panic ("need at least one iteration\n");
+
+  printf ("%lu procedures\n", (unsigned long) NUM_PROCS);
+
+  unw_set_caching_policy (unw_local_addr_space, UNW_CACHE_NONE);
+  doit ("no cache    ");
+
+  unw_set_caching_policy (unw_local_addr_space, UNW_CACHE_GLOBAL);
+  doit ("global cache");
+
+  return 0;
+}
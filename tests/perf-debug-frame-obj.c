@@ -0,0 +1,11 @@
+/* An object for Gperf-debug-frame.c.  Its code must only be described
+   by .debug_frame, so the call frame information goes there instead of
+   .eh_frame.  */
+
+__asm__ (".cfi_sections .debug_frame");
+
+int
+perf_debug_frame_func (int x)
+{
+  return 3 * x + 1;
+}
@@ -0,0 +1,171 @@
+/* libunwind - a platform-independent unwind library
+   Copyright (C) 2014 The Android Open Source Project
+
+This file is part of libunwind.
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
+
+/* Check that unwinding through the rs cache stays correct while it is
+   resized with unw_set_cache_size() and while it grows by itself.
+   Each frame below returns to one of 256 call sites, so that the
+   working set is larger than the default cache.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNW_LOCAL_ONLY
+#include <libunwind.h>
+
+#define MAX_DEPTH	200
+#define MAX_FRAMES	(MAX_DEPTH + 16)
+#define ROUNDS		32
+
+int verbose;
+static int nerrors;
+static int seed;
+static int pass;
+
+static unw_word_t ips[2][ROUNDS][MAX_FRAMES];
+static int nips[2][ROUNDS];
+
+static int step (int depth, int site);
+
+#define S1(p)	case p: r = step (depth - 1, p) + p; break;
+#define S16(p)	S1(p##0) S1(p##1) S1(p##2) S1(p##3) S1(p##4) S1(p##5)	\
+		S1(p##6) S1(p##7) S1(p##8) S1(p##9) S1(p##a) S1(p##b)	\
+		S1(p##c) S1(p##d) S1(p##e) S1(p##f)
+
+static void
+do_backtrace (void)
+{
+  unw_cursor_t cursor;
+  unw_context_t uc;
+  int n = 0;
+
+  unw_getcontext (&uc);
+  if (unw_init_local (&cursor, &uc) < 0)
+    {
+      printf ("FAILURE: unw_init_local() failed\n");
+      ++nerrors;
+      return;
+    }
+  do
+    unw_get_reg (&cursor, UNW_REG_IP, &ips[pass][seed][n++]);
+  while (n < MAX_FRAMES && unw_step (&cursor) > 0);
+  nips[pass][seed] = n;
+}
+
+static int __attribute__((noinline))
+step (int depth, int site)
+{
+  volatile int r = 0;
+
+  if (depth == 0)
+    {
+      do_backtrace ();
+      return 0;
+    }
+
+  switch ((site * 37 + depth * 11 + seed) & 0xff)
+    {
+      S16(0x0) S16(0x1) S16(0x2) S16(0x3) S16(0x4) S16(0x5) S16(0x6)
+      S16(0x7) S16(0x8) S16(0x9) S16(0xa) S16(0xb) S16(0xc) S16(0xd)
+      S16(0xe) S16(0xf)
+    }
+  return r;
+}
+
+/* Take a backtrace from the bottom of each of ROUNDS different call
+   chains, first with the cache and then without it, and compare.  */
+static void
+run (const char *what)
+{
+  if (verbose)
+    printf ("%s\n", what);
+
+  for (pass = 0; pass < 2; ++pass)
+    {
+      unw_set_caching_policy (unw_local_addr_space,
+			      pass ? UNW_CACHE_NONE : UNW_CACHE_GLOBAL);
+      for (seed = 0; seed < ROUNDS; ++seed)
+	step (MAX_DEPTH, 0);
+    }
+  unw_set_caching_policy (unw_local_addr_space, UNW_CACHE_GLOBAL);
+
+  for (seed = 0; seed < ROUNDS; ++seed)
+    if (nips[0][seed] != nips[1][seed]
+	|| memcmp (ips[0][seed], ips[1][seed],
+		   nips[0][seed] * sizeof (ips[0][seed][0])) != 0)
+      {
+	printf ("FAILURE: %s: cached backtrace %d (%d frames) differs from "
+		"uncached one (%d frames)\n", what, seed, nips[0][seed],
+		nips[1][seed]);
+	++nerrors;
+      }
+}
+
+static void
+set_size (size_t size)
+{
+  int ret = unw_set_cache_size (unw_local_addr_space, size, 0);
+
+  if (ret != 0)
+    {
+      printf ("FAILURE: unw_set_cache_size(%lu) returned %d\n",
+	      (unsigned long) size, ret);
+      ++nerrors;
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  int ret;
+
+  if (argc > 1)
+    verbose = 1;
+
+  ret = unw_set_cache_size (unw_local_addr_space, 1024, 1);
+  if (ret != -UNW_EINVAL)
+    {
+      printf ("FAILURE: unw_set_cache_size() with flag 1 returned %d\n", ret);
+      ++nerrors;
+    }
+
+  run ("default size");
+  set_size (1);
+  run ("1 entry");
+  set_size (4096);
+  run ("4096 entries");
+  set_size ((size_t) 1 << 20);
+  run ("maximum size");
+  set_size (0);
+  run ("default size again");
+
+  if (nerrors)
+    {
+      printf ("FAILURE: detected %d errors\n", nerrors);
+      exit (-1);
+    }
+  if (verbose)
+    printf ("SUCCESS.\n");
+  return 0;
+}
@@ -0,0 +1,165 @@
+/* libunwind - a platform-independent unwind library
+   Copyright (C) 2014 The Android Open Source Project
+
+This file is part of libunwind.
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
+
+/* Check that consecutive lookups in the same procedure do not search
+   the unwind table again: walk a deep recursion, asking for the
+   procedure info of every frame, first without caching and then with
+   the global cache, and compare the number of table entries read.
+   Both walks must find the same procedures.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNW_LOCAL_ONLY
+#include <libunwind.h>
+#include "compiler.h"
+
+#define panic(args...)				\
+	{ fprintf (stderr, args); exit (-1); }
+
+#define DEPTH		64
+#define MAX_FRAMES	(DEPTH + 32)
+
+int verbose;
+
+static unw_word_t start_ips[MAX_FRAMES];
+static int num_frames;
+static volatile int returns;
+
+static void NOINLINE
+walk (int record)
+{
+  unw_cursor_t cursor;
+  unw_context_t uc;
+  unw_proc_info_t pi;
+  int ret, n = 0;
+
+  unw_getcontext (&uc);
+  if (unw_init_local (&cursor, &uc) < 0)
+    panic ("unw_init_local failed!\n");
+
+  do
+    {
+      if (unw_get_proc_info (&cursor, &pi) < 0)
+	panic ("unw_get_proc_info failed in frame %d\n", n);
+      if (n < MAX_FRAMES)
+	{
+	  if (record)
+	    start_ips[n] = pi.start_ip;
+	  else if (start_ips[n] != pi.start_ip)
+	    panic ("FAILURE: frame %d: procedure at 0x%lx, expected 0x%lx\n",
+		   n, (long) pi.start_ip, (long) start_ips[n]);
+	}
+      ++n;
+    }
+  while ((ret = unw_step (&cursor)) > 0);
+  if (ret < 0)
+    panic ("unw_step failed with %d\n", ret);
+
+  if (record)
+    num_frames = n;
+  else if (n != num_frames)
+    panic ("FAILURE: walked %d frames, expected %d\n", n, num_frames);
+}
+
+static int g (int, int);
+
+static int NOINLINE
+f (int depth, int record)
+{
+  int ret = 0;
+
+  if (depth == 0)
+    walk (record);
+  else
+    ret = g (depth - 1, record) + depth;
+  /* defeat last-call/sibcall optimization */
+  ++returns;
+  return ret;
+}
+
+static int NOINLINE
+g (int depth, int record)
+{
+  int ret = 0;
+
+  if (depth == 0)
+    walk (record);
+  else
+    ret = f (depth - 1, record) + depth;
+  /* defeat last-call/sibcall optimization */
+  ++returns;
+  return ret;
+}
+
+static unsigned long long
+count_probes (unw_caching_policy_t policy, int record)
+{
+  unw_stats_t stats;
+
+  unw_set_caching_policy (unw_local_addr_space, policy);
+  unw_flush_cache (unw_local_addr_space, 0, 0);
+  unw_reset_stats ();
+  f (DEPTH, record);
+  if (unw_get_stats (&stats) < 0)
+    panic ("unw_get_stats failed\n");
+  return stats.table_probes;
+}
+
+int
+main (int argc, char **argv)
+{
+  unsigned long long uncached, cached;
+  unw_stats_t stats;
+
+  verbose = argc > 1;
+
+  if (unw_get_stats (&stats) == -UNW_ENOINFO)
+    {
+      if (verbose)
+	printf ("statistics are disabled\n");
+      return 0;
+    }
+
+  uncached = count_probes (UNW_CACHE_NONE, 1);
+  cached = count_probes (UNW_CACHE_GLOBAL, 0);
+  if (verbose)
+    printf ("%d frames: %llu table probes without caching, %llu with\n",
+	    num_frames, uncached, cached);
+
+  if (num_frames <= DEPTH)
+    panic ("FAILURE: walked only %d frames\n", num_frames);
+  if (uncached == 0)
+    panic ("FAILURE: no table probes counted\n");
+  /* Nearly all frames are in f() or g(), which should be searched
+     for once each.  */
+  if (cached * 4 > uncached)
+    panic ("FAILURE: %llu table probes with caching, %llu without\n",
+	   cached, uncached);
+
+  if (verbose)
+    printf ("SUCCESS\n");
+  return 0;
+}
@@ -0,0 +1,168 @@
+/* libunwind - a platform-independent unwind library
+   Copyright (C) 2014 The Android Open Source Project
+
+This file is part of libunwind.
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
+
+/* Check the local access_mem() accessor: unreadable addresses must be
+   rejected, words that straddle the end of a readable page must not be
+   read in part, and values read before a write through the accessor or
+   before a new unw_init_local() must not be returned afterwards.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#define UNW_LOCAL_ONLY
+#include <libunwind.h>
+
+#define panic(args...)				\
+	{ fprintf (stderr, args); exit (-1); }
+
+int verbose;
+
+static unw_cursor_t cursor;
+static unw_context_t uc;
+static unw_accessors_t *a;
+
+static int
+read_word (unw_word_t addr, unw_word_t *val)
+{
+  return (*a->access_mem) (unw_local_addr_space, addr, val, 0, &cursor);
+}
+
+static int
+write_word (unw_word_t addr, unw_word_t val)
+{
+  return (*a->access_mem) (unw_local_addr_space, addr, &val, 1, &cursor);
+}
+
+/* Without process_vm_readv(), local reads are checked against a list
+   of mappings that does not see later mprotect() calls.  */
+static int
+have_process_vm_readv (void)
+{
+#ifdef __NR_process_vm_readv
+  struct iovec local, remote;
+  unw_word_t src = 1, dst = 0;
+
+  local.iov_base = &dst;
+  local.iov_len = sizeof (dst);
+  remote.iov_base = &src;
+  remote.iov_len = sizeof (src);
+  return syscall (__NR_process_vm_readv, getpid (), &local, 1, &remote, 1, 0)
+	 == sizeof (src);
+#else
+  return 0;
+#endif
+}
+
+static void
+reinit (void)
+{
+  unw_getcontext (&uc);
+  if (unw_init_local (&cursor, &uc) < 0)
+    panic ("unw_init_local failed!\n");
+}
+
+int
+main (int argc, char **argv)
+{
+  long page_size = sysconf (_SC_PAGESIZE);
+  unw_word_t *words, *last, val;
+  char *pages;
+  size_t i, n;
+
+  verbose = argc > 1;
+
+  reinit ();
+  a = unw_get_accessors (unw_local_addr_space);
+
+  /* Two readable pages followed by one that is not.  */
+  pages = mmap (NULL, 3 * page_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (pages == MAP_FAILED)
+    panic ("mmap failed!\n");
+  if (mprotect (pages + 2 * page_size, page_size, PROT_NONE) < 0)
+    panic ("mprotect failed!\n");
+
+  words = (unw_word_t *) pages;
+  n = 2 * page_size / sizeof (unw_word_t);
+  for (i = 0; i < n; ++i)
+    words[i] = i * 0x01010101;
+
+  /* Every word of the readable pages, in both directions.  */
+  for (i = 0; i < n; ++i)
+    if (read_word ((unw_word_t) &words[i], &val) < 0 || val != words[i])
+      panic ("FAILURE: bad read of word %zu\n", i);
+  for (i = n; i-- > 0; )
+    if (read_word ((unw_word_t) &words[i], &val) < 0 || val != words[i])
+      panic ("FAILURE: bad backward read of word %zu\n", i);
+
+  /* Nothing past them.  */
+  last = &words[n - 1];
+  if (read_word ((unw_word_t) (pages + 2 * page_size), &val) >= 0)
+    panic ("FAILURE: read of an unreadable page succeeded\n");
+  if (read_word ((unw_word_t) last + 1, &val) >= 0)
+    panic ("FAILURE: read of a straddling word succeeded\n");
+  if (read_word (0, &val) >= 0)
+    panic ("FAILURE: read of address 0 succeeded\n");
+
+  /* Still there afterwards.  */
+  if (read_word ((unw_word_t) last, &val) < 0 || val != *last)
+    panic ("FAILURE: bad read of the last word\n");
+
+  /* A write through the accessor is seen by the next read.  */
+  if (write_word ((unw_word_t) &words[1], 0x1234) < 0)
+    panic ("FAILURE: write failed\n");
+  if (read_word ((unw_word_t) &words[0], &val) < 0 || val != words[0])
+    panic ("FAILURE: bad read of word 0\n");
+  if (read_word ((unw_word_t) &words[1], &val) < 0 || val != 0x1234)
+    panic ("FAILURE: write not seen\n");
+
+  /* So is any change made before unw_init_local().  */
+  words[2] = 0x5678;
+  reinit ();
+  if (read_word ((unw_word_t) &words[2], &val) < 0 || val != 0x5678)
+    panic ("FAILURE: change before unw_init_local not seen\n");
+
+  /* And a page that became unreadable.  */
+  if (have_process_vm_readv ())
+    {
+      if (read_word ((unw_word_t) &words[n / 2 + 1], &val) < 0)
+	panic ("FAILURE: bad read of the second page\n");
+      if (mprotect (pages + page_size, page_size, PROT_NONE) < 0)
+	panic ("mprotect failed!\n");
+      reinit ();
+      if (read_word ((unw_word_t) &words[n / 2 + 1], &val) >= 0)
+	panic ("FAILURE: read of a protected page succeeded\n");
+    }
+
+  munmap (pages, 3 * page_size);
+
+  if (verbose)
+    printf ("SUCCESS\n");
+  return 0;
+}
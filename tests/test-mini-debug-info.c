@@ -0,0 +1,103 @@
+/* libunwind - a platform-independent unwind library
+   Copyright (C) 2014 The Android Open Source Project
+
+This file is part of libunwind.
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
+
+/* Look up the name of a function through the MiniDebugInfo of this
+   program in a local unwind.  run-mini-debug-info strips the symbol
+   table from a copy of the program and stores it, compressed, in the
+   .gnu_debugdata section, which local unwinds only use once a budget
+   has been set with unw_set_mini_debug_info_budget().  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNW_LOCAL_ONLY
+#include <libunwind.h>
+
+#define panic(args...)				\
+	{ fprintf (stderr, args); exit (-1); }
+
+int verbose;
+
+static int __attribute__((noinline))
+get_caller_name (char *buf, size_t len)
+{
+  unw_cursor_t cursor;
+  unw_context_t uc;
+  unw_word_t off;
+
+  unw_getcontext (&uc);
+  if (unw_init_local (&cursor, &uc) < 0)
+    panic ("unw_init_local failed!\n");
+  if (unw_step (&cursor) <= 0)
+    panic ("unw_step failed!\n");
+  return unw_get_proc_name (&cursor, buf, len, &off);
+}
+
+static int __attribute__((noinline))
+function_without_symbol (char *buf, size_t len)
+{
+  int ret = get_caller_name (buf, len);
+
+  /* Keep the call from becoming a tail call.  */
+  asm volatile ("");
+  return ret;
+}
+
+static void
+check_name (const char *what)
+{
+  char buf[256];
+  int ret;
+
+  buf[0] = '\0';
+  ret = function_without_symbol (buf, sizeof (buf));
+  if (verbose)
+    printf ("%s: ret=%d name=\"%s\"\n", what, ret, buf);
+  if (ret < 0 || strcmp (buf, "function_without_symbol") != 0)
+    panic ("%s: expected function_without_symbol, got \"%s\" (%d)\n",
+	   what, buf, ret);
+}
+
+int
+main (int argc, char **argv)
+{
+  verbose = (argc > 1);
+
+  if (unw_set_mini_debug_info_budget (1024 * 1024) != 0)
+    panic ("unw_set_mini_debug_info_budget failed!\n");
+  check_name ("1MB budget");
+
+  /* With a budget too small to keep anything, the image is freed after
+     each lookup and decompressed again for the next one.  */
+  unw_set_mini_debug_info_budget (1);
+  check_name ("1 byte budget");
+  check_name ("1 byte budget, again");
+
+  unw_set_mini_debug_info_budget (0);
+
+  if (verbose)
+    printf ("SUCCESS\n");
+  return 0;
+}
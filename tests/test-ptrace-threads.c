@@ -0,0 +1,148 @@
+/* libunwind - a platform-independent unwind library
+   Copyright (C) 2014 The Android Open Source Project
+
+This file is part of libunwind.
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
+
+/* Check that _UPT_unwind_threads() stops and unwinds every thread of
+   a multi-threaded child.  There are many more threads than workers,
+   so that the calling thread (the tracer) can't unwind them all before
+   the other workers start.  */
+
+#include <errno.h>
+#include <libunwind-ptrace.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <sys/wait.h>
+
+#define NTHREADS	64
+
+#define panic(args...)						\
+	do { fprintf (stderr, args); ++nerrors; } while (0)
+
+int nerrors;
+int verbose;
+
+static void *
+sleeper (void *arg)
+{
+  for (;;)
+    pause ();
+  return NULL;
+}
+
+static void
+child (int fd)
+{
+  pthread_t t;
+  int i;
+
+  for (i = 1; i < NTHREADS; ++i)
+    if (pthread_create (&t, NULL, sleeper, NULL) != 0)
+      _exit (1);
+  /* Tell the parent that all threads are up.  */
+  if (write (fd, "x", 1) != 1)
+    _exit (1);
+  sleeper (NULL);
+}
+
+int
+main (int argc, char **argv)
+{
+  _UPT_thread_frames_t *frames;
+  size_t n, i, j;
+  int fds[2], ret, status;
+  pid_t pid;
+  char c;
+
+  if (argc > 1)
+    verbose = 1;
+
+  if (pipe (fds) < 0)
+    {
+      perror ("pipe");
+      return -1;
+    }
+
+  pid = fork ();
+  if (pid < 0)
+    {
+      perror ("fork");
+      return -1;
+    }
+  if (pid == 0)
+    child (fds[1]);
+
+  if (read (fds[0], &c, 1) != 1)
+    {
+      panic ("child failed to start its threads\n");
+      goto out;
+    }
+
+  ret = _UPT_unwind_threads (pid, 64, 4, &frames, &n);
+  if (ret < 0)
+    {
+      panic ("_UPT_unwind_threads() failed: ret=%d\n", ret);
+      goto out;
+    }
+
+  if (n != NTHREADS)
+    panic ("expected %d threads, got %lu\n", NTHREADS, (unsigned long) n);
+
+  for (i = 0; i < n; ++i)
+    {
+      if (verbose)
+	printf ("thread %d: error=%d, %lu frames\n", (int) frames[i].tid,
+		frames[i].error, (unsigned long) frames[i].num_frames);
+      if (frames[i].error < 0)
+	panic ("thread %d: unwind failed: ret=%d\n",
+	       (int) frames[i].tid, frames[i].error);
+      if (frames[i].num_frames < 2)
+	panic ("thread %d: only %lu frames\n", (int) frames[i].tid,
+	       (unsigned long) frames[i].num_frames);
+      if (verbose)
+	for (j = 0; j < frames[i].num_frames; ++j)
+	  printf ("\t%016lx (sp=%016lx)\n", (long) frames[i].ips[j],
+		  (long) frames[i].sps[j]);
+    }
+  _UPT_free_thread_frames (frames, n);
+
+  /* The child must still be alive and running after we detached.  */
+  if (waitpid (pid, &status, WNOHANG) != 0)
+    panic ("child did not survive the unwind\n");
+
+ out:
+  kill (pid, SIGKILL);
+  waitpid (pid, &status, 0);
+
+  if (nerrors)
+    {
+      printf ("FAILURE: detected %d errors\n", nerrors);
+      exit (-1);
+    }
+  if (verbose)
+    printf ("SUCCESS\n");
+  return 0;
+}
@@ -0,0 +1,150 @@
+/* libunwind - a platform-independent unwind library
+   Copyright (C) 2014 The Android Open Source Project
+
+This file is part of libunwind.
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
+
+/* Check unw_get_stats() and unw_reset_stats(): unwinding must be
+   counted, counts of threads that have exited must be kept, and a
+   reset must bring the counters back to zero.  */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNW_LOCAL_ONLY
+#include <libunwind.h>
+
+#define panic(args...)				\
+	{ fprintf (stderr, args); exit (-1); }
+
+int verbose;
+
+static int
+do_backtrace (void)
+{
+  unw_cursor_t cursor;
+  unw_context_t uc;
+  int ret, depth = 0;
+
+  unw_getcontext (&uc);
+  if (unw_init_local (&cursor, &uc) < 0)
+    panic ("unw_init_local failed!\n");
+
+  while ((ret = unw_step (&cursor)) > 0)
+    ++depth;
+  if (ret < 0)
+    panic ("unw_step failed with %d\n", ret);
+  return depth;
+}
+
+static void *
+thread_func (void *arg)
+{
+  do_backtrace ();
+  return NULL;
+}
+
+static void
+print_stats (const char *what, const unw_stats_t *s)
+{
+  if (!verbose)
+    return;
+  printf ("%s: rs %llu/%llu, trace %llu, maps %llu, phdr %llu, linear %llu,"
+	  " probes %llu, mem %llu, internal %llu/%llu\n", what,
+	  s->rs_cache_misses, s->rs_cache_lookups, s->trace_cache_expansions,
+	  s->map_rebuilds, s->dl_iterate_phdr_calls, s->fde_linear_searches,
+	  s->table_probes, s->access_mem_bytes, s->internal_in_use_bytes,
+	  s->internal_mapped_bytes);
+}
+
+int
+main (int argc, char **argv)
+{
+  unw_stats_t before, after;
+  pthread_t thread;
+  int ret;
+
+  verbose = argc > 1;
+
+  if (unw_get_stats (NULL) != -UNW_EINVAL)
+    panic ("FAILURE: unw_get_stats (NULL) did not fail\n");
+
+  ret = unw_get_stats (&before);
+  if (ret == -UNW_ENOINFO)
+    {
+      if (verbose)
+	printf ("statistics are disabled\n");
+      return 0;
+    }
+  if (ret < 0)
+    panic ("FAILURE: unw_get_stats failed with %d\n", ret);
+
+  unw_reset_stats ();
+  do_backtrace ();
+  do_backtrace ();
+  if (unw_get_stats (&after) < 0)
+    panic ("FAILURE: unw_get_stats failed\n");
+  print_stats ("main thread", &after);
+
+  if (after.rs_cache_lookups == 0)
+    panic ("FAILURE: no rs cache lookups counted\n");
+  if (after.rs_cache_misses > after.rs_cache_lookups)
+    panic ("FAILURE: more misses than lookups\n");
+  if (after.access_mem_bytes == 0)
+    panic ("FAILURE: no memory reads counted\n");
+  if (after.table_probes == 0)
+    panic ("FAILURE: no unwind-table searches counted\n");
+  if (after.internal_mapped_bytes == 0
+      || after.internal_in_use_bytes > after.internal_mapped_bytes)
+    panic ("FAILURE: bad internal memory usage\n");
+
+  /* The thread is gone by the time the counters are read.  */
+  before = after;
+  if (pthread_create (&thread, NULL, thread_func, NULL) != 0)
+    panic ("pthread_create failed\n");
+  pthread_join (thread, NULL);
+  if (unw_get_stats (&after) < 0)
+    panic ("FAILURE: unw_get_stats failed\n");
+  print_stats ("after thread", &after);
+
+  if (after.rs_cache_lookups <= before.rs_cache_lookups
+      || after.access_mem_bytes <= before.access_mem_bytes)
+    panic ("FAILURE: unwinding in an exited thread not counted\n");
+
+  unw_reset_stats ();
+  if (unw_get_stats (&after) < 0)
+    panic ("FAILURE: unw_get_stats failed\n");
+  print_stats ("after reset", &after);
+
+  if (after.rs_cache_lookups || after.rs_cache_misses
+      || after.trace_cache_expansions || after.map_rebuilds
+      || after.dl_iterate_phdr_calls || after.fde_linear_searches
+      || after.table_probes || after.access_mem_bytes)
+    panic ("FAILURE: counters not reset\n");
+  if (after.internal_mapped_bytes == 0)
+    panic ("FAILURE: internal memory usage was reset\n");
+
+  if (verbose)
+    printf ("SUCCESS\n");
+  return 0;
+}
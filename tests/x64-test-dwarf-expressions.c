@@ -0,0 +1,324 @@
+/* libunwind - a platform-independent unwind library
+   Copyright (C) 2014 The Android Open Source Project
+
+This file is part of libunwind.
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
+
+/* Check that the DWARF expressions evaluated without the stack machine
+   (see dwarf/Gexpr.c) give the same results as with it.  The functions
+   below describe their frames with such expressions:
+
+     expr_breg:	CFA is DW_OP_breg7 16, %rbx is saved at DW_OP_breg7 0
+     expr_deref:	CFA is DW_OP_breg7 8; DW_OP_deref; DW_OP_plus_uconst 16
+     expr_reg:	%rbx is in DW_OP_reg12, %rbp in DW_OP_regx 13
+     expr_plt:	CFA is the expression GCC emits for PLT entries
+
+   They are unwound without caching, which always uses the stack
+   machine, and then twice with the global cache, which compiles the
+   expressions and then uses the cached result.  All walks must agree,
+   must find the CFA of the functions and must recover the callee-saved
+   registers they clobber.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNW_LOCAL_ONLY
+#include <libunwind.h>
+#include "compiler.h"
+
+#define panic(args...)						\
+	do { fprintf (stderr, args); ++nerrors; } while (0)
+
+#define MAX_FRAMES	8
+
+struct frame
+  {
+    unw_word_t ip, sp, rbx, rbp;
+  };
+
+struct walk
+  {
+    struct frame frames[MAX_FRAMES];
+    int num_frames;
+    struct frame entry;
+  };
+
+extern void expr_breg (void (*) (void));
+extern void expr_deref (void (*) (void));
+extern void expr_reg (void (*) (void));
+extern void expr_plt (void (*) (void));
+
+#define CHECK_RBX	1
+#define CHECK_RBP	2
+
+/* The CFA and the callee-saved registers when the functions above
+   were entered.  */
+unw_word_t entry_cfa, entry_rbx, entry_rbp;
+
+int nerrors;
+int verbose;
+
+static struct walk *current;
+
+asm (
+"	.text\n"
+
+"	.globl expr_breg\n"
+"	.type expr_breg, @function\n"
+"expr_breg:\n"
+"	.cfi_startproc\n"
+"	lea 8(%rsp), %rax\n"
+"	mov %rax, entry_cfa(%rip)\n"
+"	sub $8, %rsp\n"
+	/* DW_CFA_def_cfa_expression: DW_OP_breg7 16 */
+"	.cfi_escape 0x0f, 0x02, 0x77, 0x10\n"
+"	mov %rbx, (%rsp)\n"
+	/* DW_CFA_expression %rbx: DW_OP_breg7 0 */
+"	.cfi_escape 0x10, 0x03, 0x02, 0x77, 0x00\n"
+"	mov %rbx, entry_rbx(%rip)\n"
+"	xor %ebx, %ebx\n"
+"	call *%rdi\n"
+"	mov (%rsp), %rbx\n"
+"	.cfi_restore %rbx\n"
+"	add $8, %rsp\n"
+"	.cfi_def_cfa %rsp, 8\n"
+"	ret\n"
+"	.cfi_endproc\n"
+"	.size expr_breg, .-expr_breg\n"
+
+"	.globl expr_deref\n"
+"	.type expr_deref, @function\n"
+"expr_deref:\n"
+"	.cfi_startproc\n"
+"	lea 8(%rsp), %rax\n"
+"	mov %rax, entry_cfa(%rip)\n"
+"	sub $24, %rsp\n"
+"	.cfi_def_cfa_offset 32\n"
+"	lea 16(%rsp), %rax\n"
+"	mov %rax, 8(%rsp)\n"
+	/* DW_CFA_def_cfa_expression: DW_OP_breg7 8; DW_OP_deref;
+	   DW_OP_plus_uconst 16 */
+"	.cfi_escape 0x0f, 0x05, 0x77, 0x08, 0x06, 0x23, 0x10\n"
+"	call *%rdi\n"
+"	add $24, %rsp\n"
+"	.cfi_def_cfa %rsp, 8\n"
+"	ret\n"
+"	.cfi_endproc\n"
+"	.size expr_deref, .-expr_deref\n"
+
+"	.globl expr_reg\n"
+"	.type expr_reg, @function\n"
+"expr_reg:\n"
+"	.cfi_startproc\n"
+"	lea 8(%rsp), %rax\n"
+"	mov %rax, entry_cfa(%rip)\n"
+"	push %r12\n"
+"	.cfi_def_cfa_offset 16\n"
+"	.cfi_offset %r12, -16\n"
+"	push %r13\n"
+"	.cfi_def_cfa_offset 24\n"
+"	.cfi_offset %r13, -24\n"
+"	sub $8, %rsp\n"
+"	.cfi_def_cfa_offset 32\n"
+"	mov %rbx, %r12\n"
+"	mov %rbp, %r13\n"
+	/* DW_CFA_expression %rbx: DW_OP_reg12 */
+"	.cfi_escape 0x10, 0x03, 0x01, 0x5c\n"
+	/* DW_CFA_expression %rbp: DW_OP_regx 13 */
+"	.cfi_escape 0x10, 0x06, 0x02, 0x90, 0x0d\n"
+"	mov %rbx, entry_rbx(%rip)\n"
+"	mov %rbp, entry_rbp(%rip)\n"
+"	xor %ebx, %ebx\n"
+"	xor %ebp, %ebp\n"
+"	call *%rdi\n"
+"	mov %r12, %rbx\n"
+"	.cfi_restore %rbx\n"
+"	mov %r13, %rbp\n"
+"	.cfi_restore %rbp\n"
+"	add $8, %rsp\n"
+"	.cfi_def_cfa_offset 24\n"
+"	pop %r13\n"
+"	.cfi_def_cfa_offset 16\n"
+"	.cfi_restore %r13\n"
+"	pop %r12\n"
+"	.cfi_def_cfa_offset 8\n"
+"	.cfi_restore %r12\n"
+"	ret\n"
+"	.cfi_endproc\n"
+"	.size expr_reg, .-expr_reg\n"
+
+	/* Like a PLT entry, the CFA depends on where in the 16-byte block
+	   the IP is: %rsp + 8 before offset 11, %rsp + 16 from there on.
+	   The call returns to offset 12 of the second block, so the
+	   IP of the frame is past offset 11 even if it is taken to be
+	   the address of the call's last byte.  */
+"	.p2align 4\n"
+"	.globl expr_plt\n"
+"	.type expr_plt, @function\n"
+"expr_plt:\n"
+"	.cfi_startproc\n"
+	/* DW_CFA_def_cfa_expression: DW_OP_breg7 8; DW_OP_breg16 0;
+	   DW_OP_lit15; DW_OP_and; DW_OP_lit11; DW_OP_ge; DW_OP_lit3;
+	   DW_OP_shl; DW_OP_plus */
+"	.cfi_escape 0x0f, 0x0b, 0x77, 0x08, 0x80, 0x00, 0x3f, 0x1a, 0x3b, 0x2a, 0x33, 0x24, 0x22\n"
+"	sub $8, %rsp\n"
+"	lea 16(%rsp), %rax\n"
+"	mov %rax, entry_cfa(%rip)\n"
+"	.fill 10, 1, 0x90\n"
+"	call *%rdi\n"
+"	add $8, %rsp\n"
+"	ret\n"
+"	.cfi_endproc\n"
+"	.size expr_plt, .-expr_plt\n"
+);
+
+static void NOINLINE
+walk (void)
+{
+  unw_cursor_t cursor;
+  unw_context_t uc;
+  struct frame *f;
+  int ret, n = 0;
+
+  memset (current, 0, sizeof (*current));
+  current->entry.sp = entry_cfa;
+  current->entry.rbx = entry_rbx;
+  current->entry.rbp = entry_rbp;
+  unw_getcontext (&uc);
+  if ((ret = unw_init_local (&cursor, &uc)) < 0)
+    {
+      panic ("unw_init_local failed: ret=%d\n", ret);
+      return;
+    }
+
+  do
+    {
+      f = &current->frames[n];
+      if ((ret = unw_get_reg (&cursor, UNW_REG_IP, &f->ip)) < 0
+	  || (ret = unw_get_reg (&cursor, UNW_REG_SP, &f->sp)) < 0
+	  || (ret = unw_get_reg (&cursor, UNW_X86_64_RBX, &f->rbx)) < 0
+	  || (ret = unw_get_reg (&cursor, UNW_X86_64_RBP, &f->rbp)) < 0)
+	{
+	  panic ("frame %d: unw_get_reg failed: ret=%d\n", n, ret);
+	  return;
+	}
+      ++n;
+    }
+  while (n < MAX_FRAMES && (ret = unw_step (&cursor)) > 0);
+  if (ret < 0)
+    panic ("frame %d: unw_step failed: ret=%d\n", n, ret);
+  current->num_frames = n;
+}
+
+/* Keep the call in a function of its own, so that it returns to the
+   same address in every walk.  */
+static void NOINLINE
+run (void (*fn) (void (*) (void)), unw_caching_policy_t policy,
+     struct walk *w)
+{
+  unw_set_caching_policy (unw_local_addr_space, policy);
+  current = w;
+  (*fn) (walk);
+}
+
+static void NOINLINE
+check (const char *name, void (*fn) (void (*) (void)), int flags)
+{
+  static const unw_caching_policy_t policies[] =
+    {
+      UNW_CACHE_NONE, UNW_CACHE_GLOBAL, UNW_CACHE_GLOBAL
+    };
+  struct walk walks[3];
+  unsigned int i;
+  int j;
+
+  for (i = 0; i < 3; ++i)
+    run (fn, policies[i], &walks[i]);
+
+  /* Frame 0 is walk(), frame 1 the function under test, frame 2 run().
+     The registers differ between the walks (they hold pointers to the
+     walk), only the frames must be the same.  */
+  for (i = 0; i < 3; ++i)
+    {
+      const struct walk *w = &walks[i];
+
+      if (w->num_frames < 3)
+	{
+	  panic ("%s: walk %u found only %d frames\n", name, i,
+		 w->num_frames);
+	  return;
+	}
+      if (w->frames[2].sp != w->entry.sp)
+	panic ("%s: walk %u: CFA is 0x%lx, expected 0x%lx\n", name, i,
+	       (long) w->frames[2].sp, (long) w->entry.sp);
+      if ((flags & CHECK_RBX) && w->frames[2].rbx != w->entry.rbx)
+	panic ("%s: walk %u: %%rbx is 0x%lx, expected 0x%lx\n", name, i,
+	       (long) w->frames[2].rbx, (long) w->entry.rbx);
+      if ((flags & CHECK_RBP) && w->frames[2].rbp != w->entry.rbp)
+	panic ("%s: walk %u: %%rbp is 0x%lx, expected 0x%lx\n", name, i,
+	       (long) w->frames[2].rbp, (long) w->entry.rbp);
+
+      if (i == 0)
+	continue;
+      if (w->num_frames != walks[0].num_frames)
+	{
+	  panic ("%s: walk %u found %d frames, expected %d\n", name, i,
+		 w->num_frames, walks[0].num_frames);
+	  continue;
+	}
+      /* check() calls run() from a different place every time.  */
+      for (j = 0; j < 3; ++j)
+	if (w->frames[j].ip != walks[0].frames[j].ip
+	    || w->frames[j].sp != walks[0].frames[j].sp)
+	  panic ("%s: walk %u differs in frame %d: ip=0x%lx sp=0x%lx, "
+		 "expected ip=0x%lx sp=0x%lx\n", name, i, j,
+		 (long) w->frames[j].ip, (long) w->frames[j].sp,
+		 (long) walks[0].frames[j].ip, (long) walks[0].frames[j].sp);
+    }
+
+  if (verbose)
+    for (j = 0; j < walks[0].num_frames; ++j)
+      printf ("%s: %d: ip=0x%lx sp=0x%lx rbx=0x%lx rbp=0x%lx\n", name, j,
+	      (long) walks[0].frames[j].ip, (long) walks[0].frames[j].sp,
+	      (long) walks[0].frames[j].rbx, (long) walks[0].frames[j].rbp);
+}
+
+int
+main (int argc, char **argv)
+{
+  if (argc > 1)
+    verbose = 1;
+
+  check ("expr_breg", expr_breg, CHECK_RBX);
+  check ("expr_deref", expr_deref, 0);
+  check ("expr_reg", expr_reg, CHECK_RBX | CHECK_RBP);
+  check ("expr_plt", expr_plt, 0);
+
+  if (nerrors)
+    {
+      printf ("FAILURE: detected %d errors\n", nerrors);
+      exit (-1);
+    }
+  if (verbose)
+    printf ("SUCCESS\n");
+  return 0;
+}